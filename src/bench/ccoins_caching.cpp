@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
 
@@ -49,4 +50,82 @@ static void CCoinsCaching(benchmark::Bench& bench)
     });
 }
 
+static constexpr size_t NUM_CACHED_COINS{10'000};
+
+static std::vector<COutPoint> RandomOutPoints(FastRandomContext& rng, size_t count)
+{
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(count);
+    for (size_t i{0}; i < count; ++i) {
+        outpoints.emplace_back(Txid::FromUint256(rng.rand256()), rng.randbits(4));
+    }
+    return outpoints;
+}
+
+static Coin DummyCoin()
+{
+    return Coin{CTxOut{COIN, CScript{} << OP_1}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false};
+}
+
+// Microbenchmarks for the map of the coins cache: inserting coins in an empty
+// cache, looking up coins that are or are not cached, and writing the flagged
+// coins of a cache to its parent.
+static void CCoinsCacheInsert(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    const auto outpoints{RandomOutPoints(rng, NUM_CACHED_COINS)};
+    CCoinsView coins_dummy;
+
+    bench.batch(outpoints.size()).unit("coin").run([&] {
+        CCoinsViewCache coins{&coins_dummy, /*deterministic=*/true};
+        for (const auto& outpoint : outpoints) {
+            coins.AddCoin(outpoint, DummyCoin(), /*possible_overwrite=*/false);
+        }
+        assert(coins.GetCacheSize() == outpoints.size());
+    });
+}
+
+static void CCoinsCacheLookup(benchmark::Bench& bench, bool hit)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    const auto outpoints{RandomOutPoints(rng, NUM_CACHED_COINS)};
+    const auto lookups{hit ? outpoints : RandomOutPoints(rng, NUM_CACHED_COINS)};
+    CCoinsView coins_dummy;
+    CCoinsViewCache coins{&coins_dummy, /*deterministic=*/true};
+    for (const auto& outpoint : outpoints) {
+        coins.AddCoin(outpoint, DummyCoin(), /*possible_overwrite=*/false);
+    }
+
+    bench.batch(lookups.size()).unit("coin").run([&] {
+        for (const auto& outpoint : lookups) {
+            const bool cached{coins.HaveCoinInCache(outpoint)};
+            assert(cached == hit);
+        }
+    });
+}
+
+static void CCoinsCacheLookupHit(benchmark::Bench& bench) { CCoinsCacheLookup(bench, /*hit=*/true); }
+static void CCoinsCacheLookupMiss(benchmark::Bench& bench) { CCoinsCacheLookup(bench, /*hit=*/false); }
+
+static void CCoinsCacheSync(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    const auto outpoints{RandomOutPoints(rng, NUM_CACHED_COINS)};
+    CCoinsView coins_dummy;
+    CCoinsViewCache parent{&coins_dummy, /*deterministic=*/true};
+    CCoinsViewCache coins{&parent, /*deterministic=*/true};
+
+    bench.batch(outpoints.size()).unit("coin").run([&] {
+        for (const auto& outpoint : outpoints) {
+            coins.AddCoin(outpoint, DummyCoin(), /*possible_overwrite=*/true);
+        }
+        const bool success{coins.Sync()};
+        assert(success);
+    });
+}
+
 BENCHMARK(CCoinsCaching, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheInsert, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheLookupHit, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheLookupMiss, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCoinsCacheSync, benchmark::PriorityLevel::HIGH);
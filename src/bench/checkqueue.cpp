@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <checkqueue.h>
 #include <common/system.h>
+#include <crypto/sha256.h>
 #include <key.h>
 #include <prevector.h>
 #include <pubkey.h>
@@ -63,4 +64,38 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
         control.Wait();
     });
 }
+
+// This Benchmark adds checks the way ConnectBlock does, one small batch per
+// transaction, with checks that take a few microseconds each. The master
+// should spend its time adding checks, not handing them out to the workers.
+static void CCheckQueueSmallBatchesJob(benchmark::Bench& bench)
+{
+    if (GetNumCores() <= 1) return;
+
+    static const size_t SMALL_BATCHES = 2000;
+    static const size_t SMALL_BATCH_SIZE = 2;
+
+    struct HashJob {
+        unsigned char data[64]{};
+        bool operator()()
+        {
+            for (int i = 0; i < 16; ++i) {
+                CSHA256().Write(data, sizeof(data)).Finalize(data);
+            }
+            return true;
+        }
+    };
+
+    int worker_threads_num{GetNumCores() - 1};
+    CCheckQueue<HashJob> queue{QUEUE_BATCH_SIZE, worker_threads_num};
+
+    bench.minEpochIterations(10).batch(SMALL_BATCH_SIZE * SMALL_BATCHES).unit("job").run([&] {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (size_t i = 0; i < SMALL_BATCHES; ++i) {
+            control.Add(std::vector<HashJob>(SMALL_BATCH_SIZE));
+        }
+        control.Wait();
+    });
+}
 BENCHMARK(CCheckQueueSpeedPrevectorJob, benchmark::PriorityLevel::HIGH);
+BENCHMARK(CCheckQueueSmallBatchesJob, benchmark::PriorityLevel::HIGH);
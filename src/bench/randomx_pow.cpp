@@ -0,0 +1,246 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <common/args.h>
+#include <consensus/randomx.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <util/chaintype.h>
+#include <util/check.h>
+#include <util/time.h>
+
+#include <randomx.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Benchmarks of the RandomX proof-of-work and ASERT difficulty adjustment in pow.cpp.
+//
+// Benchmarks at HIGH priority need at most a light mode cache (256 MiB), so that they can run on CI-sized
+// machines, e.g. with -sanity-check. Benchmarks which allocate the 2 GiB fast mode dataset, or build caches
+// repeatedly, are at LOW priority.
+
+//! Dataset items initialized per iteration of RandomXDatasetInitSlice
+static constexpr unsigned long RANDOMX_BENCH_DATASET_SLICE_ITEMS{1024};
+//! How long RandomXCheckPoWFast waits for the fast mode dataset to be built before skipping
+static constexpr auto RANDOMX_BENCH_DATASET_TIMEOUT{std::chrono::minutes{5}};
+
+static std::unique_ptr<const CChainParams> RandomXChainParams()
+{
+    ArgsManager bench_args;
+    return CreateChainParams(bench_args, ChainType::SNAILCOINREGTEST);
+}
+
+/** Header of the given epoch, with a null hashRandomX and the easiest target */
+static CBlockHeader RandomXHeader(const Consensus::Params& params, uint32_t epoch)
+{
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = uint256::ONE;
+    header.hashMerkleRoot = uint256::ONE;
+    header.nTime = epoch * params.nRandomXEpochDuration + 1;
+    header.nBits = UintToArith256(params.powLimit).GetCompact();
+    header.nNonce = 0;
+    return header;
+}
+
+/** Set the nonce and hashRandomX of a header to a solution, computing the RandomX hash if full is set */
+static void SolveRandomXHeader(CBlockHeader& header, const Consensus::Params& params, bool full)
+{
+    arith_uint256 target;
+    target.SetCompact(header.nBits);
+    for (;; ++header.nNonce) {
+        header.hashRandomX = full ? *Assert(CalculateRandomXHash(header, params)) : uint256::ONE;
+        if (UintToArith256(GetRandomXCommitment(header)) <= target) return;
+    }
+}
+
+static void RandomXSeedHash(benchmark::Bench& bench)
+{
+    uint32_t epoch{0};
+    bench.run([&] {
+        const uint256 seed_hash{GetSeedHash(epoch++)};
+        ankerl::nanobench::doNotOptimizeAway(seed_hash);
+    });
+}
+
+static void RandomXCommitment(benchmark::Bench& bench)
+{
+    const auto chain_params{RandomXChainParams()};
+    CBlockHeader header{RandomXHeader(chain_params->GetConsensus(), 1)};
+    header.hashRandomX = uint256::ONE;
+    bench.run([&] {
+        ++header.nNonce;
+        const uint256 commitment{GetRandomXCommitment(header)};
+        ankerl::nanobench::doNotOptimizeAway(commitment);
+    });
+}
+
+static void RandomXCheckPoWCommitmentOnly(benchmark::Bench& bench)
+{
+    const auto chain_params{RandomXChainParams()};
+    const Consensus::Params& params{chain_params->GetConsensus()};
+    CBlockHeader header{RandomXHeader(params, 1)};
+    SolveRandomXHeader(header, params, /*full=*/false);
+    bench.run([&] {
+        const bool ok{CheckProofOfWorkRandomX(header, params, POW_VERIFY_COMMITMENT_ONLY)};
+        assert(ok);
+    });
+}
+
+/** Full verification of headers which were not verified before. Mining mode does the same work, but bypasses the hash cache. */
+static void RandomXCheckPoW(benchmark::Bench& bench, const Consensus::Params& params, CBlockHeader& header)
+{
+    bench.run([&] {
+        ++header.nNonce;
+        uint256 hash;
+        CheckProofOfWorkRandomX(header, params, POW_VERIFY_MINING, &hash);
+        ankerl::nanobench::doNotOptimizeAway(hash);
+    });
+}
+
+static void RandomXCheckPoWLight(benchmark::Bench& bench)
+{
+    const auto chain_params{RandomXChainParams()};
+    const Consensus::Params& params{chain_params->GetConsensus()};
+    CBlockHeader header{RandomXHeader(params, 2)};
+    // Create the light mode VMs of the epoch
+    Assert(CalculateRandomXHash(header, params));
+    RandomXCheckPoW(bench, params, header);
+}
+
+static void RandomXCheckPoWFast(benchmark::Bench& bench)
+{
+    const auto chain_params{RandomXChainParams()};
+    const Consensus::Params& params{chain_params->GetConsensus()};
+    CBlockHeader header{RandomXHeader(params, 3)};
+
+    // Fast mode VMs are built in the background once IBD has finished
+    const bool was_ibd_finished{g_isIBDFinished};
+    gArgs.ForceSetArg("-randomxfastmode", "1");
+    g_isIBDFinished = true;
+    Assert(CalculateRandomXHash(header, params));
+    const auto deadline{SteadyClock::now() + RANDOMX_BENCH_DATASET_TIMEOUT};
+    while (GetRandomXMemoryInfo().datasets == 0 && SteadyClock::now() < deadline) {
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    if (GetRandomXMemoryInfo().datasets == 0) {
+        // E.g. the dataset could not be allocated, and verification fell back to light mode
+        tfm::format(std::cerr, "RandomXCheckPoWFast: skipped, the fast mode dataset was not built within %d seconds\n",
+                    count_seconds(RANDOMX_BENCH_DATASET_TIMEOUT));
+    } else {
+        RandomXCheckPoW(bench, params, header);
+    }
+
+    g_isIBDFinished = was_ibd_finished;
+    gArgs.ForceSetArg("-randomxfastmode", "0");
+}
+
+static void RandomXCheckPoWCached(benchmark::Bench& bench)
+{
+    const auto chain_params{RandomXChainParams()};
+    const Consensus::Params& params{chain_params->GetConsensus()};
+    CBlockHeader header{RandomXHeader(params, 4)};
+    SolveRandomXHeader(header, params, /*full=*/true);
+    // Verify the header once, so that its hash is cached
+    Assert(CheckProofOfWorkRandomX(header, params, POW_VERIFY_FULL));
+    bench.run([&] {
+        const bool ok{CheckProofOfWorkRandomX(header, params, POW_VERIFY_FULL)};
+        assert(ok);
+    });
+}
+
+static void RandomXCacheInit(benchmark::Bench& bench)
+{
+    const randomx_flags flags{randomx_get_flags()};
+    uint32_t epoch{0};
+    bench.unit("cache").run([&] {
+        randomx_cache* cache{Assert(randomx_alloc_cache(flags))};
+        const uint256 seed_hash{GetSeedHash(epoch++)};
+        randomx_init_cache(cache, seed_hash.data(), seed_hash.size());
+        randomx_release_cache(cache);
+    });
+}
+
+static void RandomXDatasetInitSlice(benchmark::Bench& bench)
+{
+    const randomx_flags flags{randomx_get_flags()};
+    randomx_cache* cache{Assert(randomx_alloc_cache(flags))};
+    const uint256 seed_hash{GetSeedHash(0)};
+    randomx_init_cache(cache, seed_hash.data(), seed_hash.size());
+    // The whole 2 GiB dataset is reserved, though only the pages of the initialized items are touched
+    randomx_dataset* dataset{Assert(randomx_alloc_dataset(flags))};
+    const unsigned long item_count{randomx_dataset_item_count()};
+    const unsigned long slice_items{std::min(RANDOMX_BENCH_DATASET_SLICE_ITEMS, item_count)};
+
+    bench.batch(slice_items).unit("item").run([&] {
+        randomx_init_dataset(dataset, cache, 0, slice_items);
+    });
+
+    randomx_release_dataset(dataset);
+    randomx_release_cache(cache);
+}
+
+static void ASERTCalculate(benchmark::Bench& bench)
+{
+    const auto chain_params{CreateChainParams(ArgsManager{}, ChainType::SNAILCOINMAIN)};
+    const Consensus::Params& params{chain_params->GetConsensus()};
+    const arith_uint256 pow_limit{UintToArith256(params.powLimit)};
+    const arith_uint256 ref_target{pow_limit >> 8};
+    int64_t height_diff{0};
+    bench.run([&] {
+        ++height_diff;
+        // Alternate between blocks ahead of and behind schedule
+        const int64_t time_diff{params.nPowTargetSpacing * (height_diff + 1) + ((height_diff % 2) ? 1000 : -1000)};
+        const arith_uint256 target{CalculateASERT(ref_target, params.nPowTargetSpacing, time_diff, height_diff, pow_limit, params.nASERTHalfLife)};
+        ankerl::nanobench::doNotOptimizeAway(target);
+    });
+}
+
+static void ASERTNextWorkRequired(benchmark::Bench& bench)
+{
+    const auto chain_params{CreateChainParams(ArgsManager{}, ChainType::SNAILCOINMAIN)};
+    const Consensus::Params& params{chain_params->GetConsensus()};
+    const Consensus::Params::ASERTAnchor& anchor{*Assert(params.asertAnchorParams)};
+
+    // Chain of blocks after the anchor block, with solve times around the target spacing
+    std::vector<CBlockIndex> blocks(4096);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i].pprev = i > 0 ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = anchor.nHeight + i;
+        blocks[i].nTime = anchor.nPrevBlockTime + (i + 1) * params.nPowTargetSpacing + ((i % 2) ? 100 : -100);
+        blocks[i].nBits = anchor.nBits;
+    }
+    CBlockHeader header;
+    size_t i{0};
+    bench.run([&] {
+        i = i % (blocks.size() - 1) + 1;
+        header.nTime = blocks[i].nTime + params.nPowTargetSpacing;
+        const uint32_t bits{GetNextASERTWorkRequired(&blocks[i], &header, params, nullptr)};
+        ankerl::nanobench::doNotOptimizeAway(bits);
+    });
+}
+
+BENCHMARK(RandomXSeedHash, benchmark::PriorityLevel::HIGH);
+BENCHMARK(RandomXCommitment, benchmark::PriorityLevel::HIGH);
+BENCHMARK(RandomXCheckPoWCommitmentOnly, benchmark::PriorityLevel::HIGH);
+BENCHMARK(RandomXCheckPoWLight, benchmark::PriorityLevel::HIGH);
+BENCHMARK(RandomXCheckPoWFast, benchmark::PriorityLevel::LOW);
+BENCHMARK(RandomXCheckPoWCached, benchmark::PriorityLevel::HIGH);
+BENCHMARK(RandomXCacheInit, benchmark::PriorityLevel::LOW);
+BENCHMARK(RandomXDatasetInitSlice, benchmark::PriorityLevel::LOW);
+BENCHMARK(ASERTCalculate, benchmark::PriorityLevel::HIGH);
+BENCHMARK(ASERTNextWorkRequired, benchmark::PriorityLevel::HIGH);
@@ -13,11 +13,16 @@
 #include <common/system.h>
 #include <compat/compat.h>
 #include <core_io.h>
+#include <pow.h>
+#include <primitives/block.h>
 #include <streams.h>
 #include <util/exception.h>
 #include <util/strencodings.h>
 #include <util/translation.h>
 
+#include <randomx.h>
+
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <functional>
@@ -33,6 +38,7 @@ static void SetupBitcoinUtilArgs(ArgsManager &argsman)
     SetupHelpOptions(argsman);
 
     argsman.AddArg("-version", "Print version and exit", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxfastmode", strprintf("Grind RandomX headers with the full dataset, which is faster but uses more than 2 GiB of memory (default: %u)", DEFAULT_RANDOMX_FAST_MODE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     argsman.AddCommand("grind", "Perform proof of work on hex header string");
 
@@ -74,6 +80,8 @@ static int AppInitUtil(ArgsManager& args, int argc, char* argv[])
     // Check for chain settings (Params() calls are only valid after this clause)
     try {
         SelectParams(args.GetChainType());
+        // Headers of RandomX chains are serialized with hashRandomX
+        g_isRandomX = Params().GetConsensus().fPowRandomX;
     } catch (const std::exception& e) {
         tfm::format(std::cerr, "Error: %s\n", e.what());
         return EXIT_FAILURE;
@@ -107,39 +115,148 @@ static void grind_task(uint32_t nBits, CBlockHeader header, uint32_t offset, uin
     }
 }
 
-static int Grind(const std::vector<std::string>& args, std::string& strPrint)
+// Grind nonces offset, offset + step, ... with a RandomX VM, pipelining the hash of the next nonce with the check of the current one.
+static void grind_task_randomx(randomx_vm* vm, CBlockHeader header, uint32_t offset, uint32_t step, std::atomic<bool>& found, uint32_t& proposed_nonce, uint256& proposed_hash)
 {
-    if (args.size() != 1) {
-        strPrint = "Must specify block header to grind";
-        return EXIT_FAILURE;
+    arith_uint256 target;
+    bool neg, over;
+    target.SetCompact(header.nBits, &neg, &over);
+    if (target == 0 || neg || over) return;
+    header.hashRandomX.SetNull();
+    header.nNonce = offset;
+
+    uint32_t finish = std::numeric_limits<uint32_t>::max() - step;
+    finish = finish - (finish % step) + offset;
+
+    CBlockHeader next{header};
+    randomx_calculate_hash_first(vm, &header, sizeof(header));
+    while (!found) {
+        uint256 hash;
+        const bool last{header.nNonce >= finish};
+        if (last) {
+            randomx_calculate_hash_last(vm, hash.data());
+        } else {
+            next.nNonce = header.nNonce + step;
+            randomx_calculate_hash_next(vm, &next, sizeof(next), hash.data());
+        }
+        if (UintToArith256(GetRandomXCommitment(header, &hash)) <= target) {
+            if (!found.exchange(true)) {
+                proposed_nonce = header.nNonce;
+                proposed_hash = hash;
+            }
+            return;
+        }
+        if (last) return;
+        header.nNonce = next.nNonce;
     }
+}
 
-    CBlockHeader header;
-    if (!DecodeHexBlockHeader(header, args[0])) {
-        strPrint = "Could not decode block header";
-        return EXIT_FAILURE;
+// Grind a RandomX header with one VM per thread, keyed by the epoch of the header's nTime.
+static bool GrindRandomX(CBlockHeader& header, int n_tasks, bool fast_mode, std::string& strPrint)
+{
+    const Consensus::Params& consensus{Params().GetConsensus()};
+    const uint256 seed_hash{GetSeedHash(GetEpoch(header.nTime, consensus.nRandomXEpochDuration))};
+
+    randomx_flags flags{randomx_get_flags()};
+    std::unique_ptr<randomx_cache, decltype(&randomx_release_cache)> cache{randomx_alloc_cache(flags), randomx_release_cache};
+    if (!cache) {
+        strPrint = "Could not allocate RandomX cache";
+        return false;
+    }
+    randomx_init_cache(cache.get(), seed_hash.data(), seed_hash.size());
+
+    std::unique_ptr<randomx_dataset, decltype(&randomx_release_dataset)> dataset{nullptr, randomx_release_dataset};
+    if (fast_mode) {
+        flags |= RANDOMX_FLAG_FULL_MEM;
+        dataset.reset(randomx_alloc_dataset(flags));
+        if (!dataset) {
+            strPrint = "Could not allocate RandomX dataset";
+            return false;
+        }
+        const unsigned long n_items{randomx_dataset_item_count()};
+        std::vector<std::thread> threads;
+        threads.reserve(n_tasks);
+        unsigned long start{0};
+        for (int i = 0; i < n_tasks; ++i) {
+            const unsigned long count{n_items / n_tasks + (static_cast<unsigned long>(i) < n_items % n_tasks ? 1 : 0)};
+            threads.emplace_back(randomx_init_dataset, dataset.get(), cache.get(), start, count);
+            start += count;
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    std::vector<std::unique_ptr<randomx_vm, decltype(&randomx_destroy_vm)>> vms;
+    vms.reserve(n_tasks);
+    for (int i = 0; i < n_tasks; ++i) {
+        vms.emplace_back(randomx_create_vm(flags, cache.get(), dataset.get()), randomx_destroy_vm);
+        if (!vms.back()) {
+            strPrint = "Could not create RandomX VM";
+            return false;
+        }
     }
 
-    uint32_t nBits = header.nBits;
     std::atomic<bool> found{false};
     uint32_t proposed_nonce{};
+    uint256 proposed_hash;
 
     std::vector<std::thread> threads;
-    int n_tasks = std::max(1u, std::thread::hardware_concurrency());
     threads.reserve(n_tasks);
     for (int i = 0; i < n_tasks; ++i) {
-        threads.emplace_back(grind_task, nBits, header, i, n_tasks, std::ref(found), std::ref(proposed_nonce));
+        threads.emplace_back(grind_task_randomx, vms[i].get(), header, i, n_tasks, std::ref(found), std::ref(proposed_nonce), std::ref(proposed_hash));
     }
     for (auto& t : threads) {
         t.join();
     }
-    if (found) {
-        header.nNonce = proposed_nonce;
-    } else {
+    if (!found) {
         strPrint = "Could not satisfy difficulty target";
+        return false;
+    }
+    header.nNonce = proposed_nonce;
+    header.hashRandomX = proposed_hash;
+    return true;
+}
+
+static int Grind(const std::vector<std::string>& args, std::string& strPrint)
+{
+    if (args.size() != 1) {
+        strPrint = "Must specify block header to grind";
+        return EXIT_FAILURE;
+    }
+
+    CBlockHeader header;
+    if (!DecodeHexBlockHeader(header, args[0])) {
+        strPrint = "Could not decode block header";
         return EXIT_FAILURE;
     }
 
+    int n_tasks = std::max(1u, std::thread::hardware_concurrency());
+    if (g_isRandomX) {
+        if (!GrindRandomX(header, n_tasks, gArgs.GetBoolArg("-randomxfastmode", DEFAULT_RANDOMX_FAST_MODE), strPrint)) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        uint32_t nBits = header.nBits;
+        std::atomic<bool> found{false};
+        uint32_t proposed_nonce{};
+
+        std::vector<std::thread> threads;
+        threads.reserve(n_tasks);
+        for (int i = 0; i < n_tasks; ++i) {
+            threads.emplace_back(grind_task, nBits, header, i, n_tasks, std::ref(found), std::ref(proposed_nonce));
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        if (found) {
+            header.nNonce = proposed_nonce;
+        } else {
+            strPrint = "Could not satisfy difficulty target";
+            return EXIT_FAILURE;
+        }
+    }
+
     DataStream ss{};
     ss << header;
     strPrint = HexStr(ss);
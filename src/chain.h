@@ -132,6 +132,8 @@ enum BlockStatus : uint32_t {
 
     BLOCK_STATUS_RESERVED    =   256, //!< Unused flag that was previously set on assumeutxo snapshot blocks and their
                                       //!< ancestors before they were validated, and unset when they were validated.
+
+    BLOCK_POW_VERIFIED       =   512, //!< RandomX hash of the header was fully verified, only its commitment needs to be checked again
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -8,9 +8,17 @@
 #include <sync.h>
 #include <tinyformat.h>
 #include <util/threadnames.h>
+#include <util/time.h>
 
 #include <algorithm>
-#include <iterator>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
 #include <vector>
 
 /**
@@ -22,119 +30,248 @@
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Work is scheduled by work stealing. Batches added by the master are pushed
+  * onto a lock-free list, which an idle thread takes as a whole into its own
+  * deque of check ranges. Each thread runs chunks off the back of its own
+  * deque, and threads which run out of work steal half of a range from the
+  * front of another thread's deque. Chunk sizes adapt to the measured cost of
+  * the checks, up to the batch size, so that cheap checks are not scheduled
+  * one at a time and expensive ones remain spread over all threads.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
-    Mutex m_mutex;
+    //! Checks added at once. Destroyed by the thread finishing its last check.
+    struct Batch {
+        std::vector<T> checks;
+        //! Number of checks not yet run (or skipped)
+        std::atomic<size_t> remaining;
+        //! Next batch in the list of added batches
+        Batch* next{nullptr};
+
+        explicit Batch(std::vector<T>&& checks_in) : checks{std::move(checks_in)}, remaining{checks.size()} {}
+    };
+
+    //! Checks [begin, end) of a batch
+    struct Range {
+        Batch* batch;
+        size_t begin;
+        size_t end;
+    };
+
+    //! Deque of check ranges owned by one thread, and stolen from by the others
+    struct alignas(64) Slot {
+        Mutex m_mutex;
+        std::deque<Range> ranges GUARDED_BY(m_mutex);
+    };
 
-    //! Worker threads block on this when out of work
-    std::condition_variable m_worker_cv;
+    //! Target run time of one chunk of checks
+    static constexpr std::chrono::nanoseconds CHUNK_TARGET_TIME{std::chrono::microseconds{100}};
 
-    //! Master thread blocks on this when out of work
-    std::condition_variable m_master_cv;
+    //! The maximum number of checks to be processed in one chunk
+    const size_t nBatchSize;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue GUARDED_BY(m_mutex);
+    //! Deques of the worker threads, followed by the deque of the master
+    const size_t m_num_slots;
+    const std::unique_ptr<Slot[]> m_slots;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle GUARDED_BY(m_mutex){0};
+    //! Batches added and not yet taken into a deque, newest first
+    std::atomic<Batch*> m_added{nullptr};
 
-    //! The total number of workers (including the master).
-    int nTotal GUARDED_BY(m_mutex){0};
+    //! Number of ranges in all deques
+    std::atomic<size_t> m_queued_ranges{0};
 
-    //! The temporary evaluation result.
-    bool fAllOk GUARDED_BY(m_mutex){true};
+    //! Number of batches that haven't been destroyed yet. The master waits on this.
+    std::atomic<size_t> m_batches_todo{0};
 
-    /**
-     * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
-     */
-    unsigned int nTodo GUARDED_BY(m_mutex){0};
+    //! Incremented whenever work is made available. Idle workers wait on this.
+    std::atomic<uint32_t> m_work_signal{0};
 
-    //! The maximum number of elements to be processed in one batch
-    const unsigned int nBatchSize;
+    //! Number of idle workers waiting on m_work_signal
+    std::atomic<int> m_idle_workers{0};
+
+    //! Set once a check failed. Remaining checks are skipped, and the result reset by Wait().
+    std::atomic<bool> m_failed{false};
+
+    //! Moving average of the time taken by a single check, in nanoseconds
+    std::atomic<int64_t> m_check_time_ns{1000};
 
     std::vector<std::thread> m_worker_threads;
-    bool m_request_stop GUARDED_BY(m_mutex){false};
+    std::atomic<bool> m_request_stop{false};
+
+    size_t ChunkSize() const
+    {
+        const int64_t check_time_ns{std::max<int64_t>(m_check_time_ns.load(std::memory_order_relaxed), 1)};
+        return std::clamp<size_t>(CHUNK_TARGET_TIME.count() / check_time_ns, 1, nBatchSize);
+    }
+
+    /** Wake idle workers, after work was made available. */
+    void SignalWork(bool all)
+    {
+        m_work_signal.fetch_add(1);
+        if (m_idle_workers.load() > 0) {
+            if (all) {
+                m_work_signal.notify_all();
+            } else {
+                m_work_signal.notify_one();
+            }
+        }
+    }
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    bool HasWork() const
     {
-        std::condition_variable& cond = fMaster ? m_master_cv : m_worker_cv;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
+        return m_added.load() != nullptr || m_queued_ranges.load() > 0;
+    }
+
+    /** Take a chunk off the back of a thread's own deque. */
+    std::optional<Range> PopLocal(size_t self)
+    {
+        Slot& slot{m_slots[self]};
+        LOCK(slot.m_mutex);
+        if (slot.ranges.empty()) return std::nullopt;
+        Range& back{slot.ranges.back()};
+        // Leave a share of the range to each thread, so that all threads finish at about the same time
+        const size_t chunk_size{std::clamp<size_t>((back.end - back.begin) / m_num_slots, 1, ChunkSize())};
+        if (back.end - back.begin > chunk_size) {
+            // Leave the rest of the range to this thread, or to thieves
+            const Range chunk{back.batch, back.end - chunk_size, back.end};
+            back.end = chunk.begin;
+            return chunk;
+        }
+        const Range chunk{back};
+        slot.ranges.pop_back();
+        m_queued_ranges.fetch_sub(1);
+        return chunk;
+    }
+
+    /** Move all added batches into a thread's own deque. */
+    bool TakeAdded(size_t self)
+    {
+        Batch* batch{m_added.exchange(nullptr)};
+        if (batch == nullptr) return false;
+        size_t num_batches{0};
+        {
+            Slot& slot{m_slots[self]};
+            LOCK(slot.m_mutex);
+            // The list is newest first. Pushing to the front leaves the oldest batch at the back, to be run first.
+            for (; batch != nullptr; batch = batch->next) {
+                slot.ranges.push_front(Range{batch, 0, batch->checks.size()});
+                ++num_batches;
+            }
+        }
+        m_queued_ranges.fetch_add(num_batches);
+        SignalWork(/*all=*/true);
+        return true;
+    }
+
+    /** Move half of a range at the front of another thread's deque into a thread's own deque. */
+    bool Steal(size_t self)
+    {
+        for (size_t i = 1; i < m_num_slots; ++i) {
+            if (m_queued_ranges.load() == 0) return false;
+            Slot& victim{m_slots[(self + i) % m_num_slots]};
+            std::optional<Range> stolen;
             {
-                WAIT_LOCK(m_mutex, lock);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        m_master_cv.notify_one();
+                LOCK(victim.m_mutex);
+                if (victim.ranges.empty()) continue;
+                Range& front{victim.ranges.front()};
+                const size_t size{front.end - front.begin};
+                if (size > 1) {
+                    stolen = Range{front.batch, front.begin, front.begin + size / 2};
+                    front.begin = stolen->end;
+                    m_queued_ranges.fetch_add(1);
                 } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty() && !m_request_stop) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                if (m_request_stop) {
-                    return false;
+                    stolen = front;
+                    victim.ranges.pop_front();
                 }
+            }
+            {
+                Slot& slot{m_slots[self]};
+                LOCK(slot.m_mutex);
+                slot.ranges.push_back(*stolen);
+            }
+            // Wake another idle worker, which may steal from here next
+            SignalWork(/*all=*/false);
+            return true;
+        }
+        return false;
+    }
+
+    /** Run the checks of a range, skipping them after a failure, and destroy its batch if they were its last checks. */
+    void Run(const Range& range)
+    {
+        const size_t count{range.end - range.begin};
+        if (!m_failed.load(std::memory_order_relaxed)) {
+            const auto start{SteadyClock::now()};
+            bool ok{true};
+            for (size_t i = range.begin; ok && i < range.end; ++i) {
+                ok = range.batch->checks[i]();
+            }
+            if (!ok) {
+                m_failed.store(true);
+            } else {
+                const int64_t check_time_ns{std::chrono::nanoseconds{SteadyClock::now() - start}.count() / int64_t(count)};
+                const int64_t average_ns{m_check_time_ns.load(std::memory_order_relaxed)};
+                m_check_time_ns.store((average_ns * 7 + check_time_ns) / 8, std::memory_order_relaxed);
+            }
+        }
+        Finish(range.batch, count);
+    }
+
+    /** Account for checks of a batch that were run or skipped. */
+    void Finish(Batch* batch, size_t count)
+    {
+        if (batch->remaining.fetch_sub(count) != count) return;
+        // The checks must be destroyed before the master is done waiting.
+        delete batch;
+        if (m_batches_todo.fetch_sub(1) == 1) {
+            m_batches_todo.notify_all();
+        }
+    }
+
+    /** Find and run a chunk of checks. Returns false if none were found. */
+    bool RunChunk(size_t self)
+    {
+        std::optional<Range> range{PopLocal(self)};
+        if (!range && (TakeAdded(self) || Steal(self))) {
+            range = PopLocal(self);
+        }
+        if (!range) return false;
+        Run(*range);
+        return true;
+    }
 
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                auto start_it = queue.end() - nNow;
-                vChecks.assign(std::make_move_iterator(start_it), std::make_move_iterator(queue.end()));
-                queue.erase(start_it, queue.end());
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+    void WorkerLoop(size_t self)
+    {
+        while (true) {
+            const uint32_t signal{m_work_signal.load()};
+            if (m_request_stop.load()) return;
+            if (RunChunk(self)) continue;
+            m_idle_workers.fetch_add(1);
+            if (!HasWork() && !m_request_stop.load()) {
+                m_work_signal.wait(signal);
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+            m_idle_workers.fetch_sub(1);
+        }
     }
 
 public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     Mutex m_control_mutex;
 
-    //! Create a new check queue
-    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num)
-        : nBatchSize(batch_size)
+    //! Create a new check queue, whose worker threads are named after thread_name
+    explicit CCheckQueue(unsigned int batch_size, int worker_threads_num, const std::string& thread_name = "scriptch")
+        : nBatchSize(std::max(batch_size, 1U)),
+          m_num_slots(std::max(worker_threads_num, 0) + 1),
+          m_slots(std::make_unique<Slot[]>(m_num_slots))
     {
         m_worker_threads.reserve(worker_threads_num);
         for (int n = 0; n < worker_threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                Loop(false /* worker thread */);
+            m_worker_threads.emplace_back([this, n, thread_name]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
+                WorkerLoop(n);
             });
         }
     }
@@ -147,38 +284,55 @@ public:
     CCheckQueue& operator=(CCheckQueue&&) = delete;
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
-    bool Wait() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    bool Wait()
     {
-        return Loop(true /* master thread */);
+        const size_t self{m_num_slots - 1};
+        while (true) {
+            if (RunChunk(self)) continue;
+            // All remaining checks are being run by worker threads.
+            const size_t todo{m_batches_todo.load()};
+            if (todo == 0) break;
+            m_batches_todo.wait(todo);
+        }
+        // reset the status for new work later
+        return !m_failed.exchange(false);
     }
 
     //! Add a batch of checks to the queue
-    void Add(std::vector<T>&& vChecks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    void Add(std::vector<T>&& vChecks)
     {
         if (vChecks.empty()) {
             return;
         }
 
-        {
-            LOCK(m_mutex);
-            queue.insert(queue.end(), std::make_move_iterator(vChecks.begin()), std::make_move_iterator(vChecks.end()));
-            nTodo += vChecks.size();
-        }
-
-        if (vChecks.size() == 1) {
-            m_worker_cv.notify_one();
-        } else {
-            m_worker_cv.notify_all();
-        }
+        const bool single{vChecks.size() == 1};
+        Batch* batch{new Batch{std::move(vChecks)}};
+        m_batches_todo.fetch_add(1);
+        batch->next = m_added.load(std::memory_order_relaxed);
+        while (!m_added.compare_exchange_weak(batch->next, batch)) {}
+        SignalWork(/*all=*/!single);
     }
 
     ~CCheckQueue()
     {
-        WITH_LOCK(m_mutex, m_request_stop = true);
-        m_worker_cv.notify_all();
+        m_request_stop.store(true);
+        m_work_signal.fetch_add(1);
+        m_work_signal.notify_all();
         for (std::thread& t : m_worker_threads) {
             t.join();
         }
+        // Destroy checks that were added, but never waited for
+        for (Batch* batch{m_added.exchange(nullptr)}; batch != nullptr;) {
+            Batch* next{batch->next};
+            Finish(batch, batch->remaining.load());
+            batch = next;
+        }
+        for (size_t i = 0; i < m_num_slots; ++i) {
+            LOCK(m_slots[i].m_mutex);
+            for (const Range& range : m_slots[i].ranges) {
+                Finish(range.batch, range.end - range.begin);
+            }
+        }
     }
 
     bool HasThreads() const { return !m_worker_threads.empty(); }
@@ -35,7 +35,9 @@ CCoinsViewCache::CCoinsViewCache(CCoinsView* baseIn, bool deterministic) :
     CCoinsViewBacked(baseIn), m_deterministic(deterministic),
     cacheCoins(0, SaltedOutpointHasher(/*deterministic=*/deterministic), CCoinsMap::key_equal{}, &m_cache_coins_memory_resource)
 {
+#ifndef USE_FLAT_COINS_MAP
     m_sentinel.second.SelfRef(m_sentinel);
+#endif
 }
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
@@ -51,7 +53,7 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
         }
         if (ret->second.coin.IsSpent()) {
             // The parent only has an empty entry for this outpoint; we can consider our version as fresh.
-            ret->second.AddFlags(CCoinsCacheEntry::FRESH, *ret, m_sentinel);
+            AddFlags(*ret, CCoinsCacheEntry::FRESH);
         }
         cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
     }
@@ -97,7 +99,7 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
         fresh = !it->second.IsDirty();
     }
     it->second.coin = std::move(coin);
-    it->second.AddFlags(CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0), *it, m_sentinel);
+    AddFlags(*it, CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0));
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
     TRACE5(utxocache, add,
            outpoint.hash.data(),
@@ -114,7 +116,15 @@ void CCoinsViewCache::EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coi
         std::forward_as_tuple(std::move(outpoint)),
         std::forward_as_tuple(std::move(coin)));
     if (inserted) {
-        it->second.AddFlags(CCoinsCacheEntry::DIRTY, *it, m_sentinel);
+        AddFlags(*it, CCoinsCacheEntry::DIRTY);
+    }
+}
+
+void CCoinsViewCache::EmplaceBaseCoin(const COutPoint& outpoint, Coin&& coin) {
+    if (coin.IsSpent()) return;
+    const auto [it, inserted] = cacheCoins.try_emplace(outpoint, std::move(coin));
+    if (inserted) {
+        cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
     }
 }
 
@@ -145,7 +155,7 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
     if (it->second.IsFresh()) {
         cacheCoins.erase(it);
     } else {
-        it->second.AddFlags(CCoinsCacheEntry::DIRTY, *it, m_sentinel);
+        AddFlags(*it, CCoinsCacheEntry::DIRTY);
         it->second.coin.Clear();
     }
     return true;
@@ -172,6 +182,12 @@ bool CCoinsViewCache::HaveCoinInCache(const COutPoint &outpoint) const {
     return (it != cacheCoins.end() && !it->second.coin.IsSpent());
 }
 
+const Coin* CCoinsViewCache::PeekCoin(const COutPoint& outpoint) const
+{
+    CCoinsMap::const_iterator it = cacheCoins.find(outpoint);
+    return it != cacheCoins.end() ? &it->second.coin : nullptr;
+}
+
 uint256 CCoinsViewCache::GetBestBlock() const {
     if (hashBlock.IsNull())
         hashBlock = base->GetBestBlock();
@@ -205,12 +221,12 @@ bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &ha
                     entry.coin = it->second.coin;
                 }
                 cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
-                entry.AddFlags(CCoinsCacheEntry::DIRTY, *itUs, m_sentinel);
+                AddFlags(*itUs, CCoinsCacheEntry::DIRTY);
                 // We can mark it FRESH in the parent if it was FRESH in the child
                 // Otherwise it might have just been flushed from the parent's cache
                 // and already exist in the grandparent
                 if (it->second.IsFresh()) {
-                    entry.AddFlags(CCoinsCacheEntry::FRESH, *itUs, m_sentinel);
+                    AddFlags(*itUs, CCoinsCacheEntry::FRESH);
                 }
             }
         } else {
@@ -239,7 +255,7 @@ bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &ha
                     itUs->second.coin = it->second.coin;
                 }
                 cachedCoinsUsage += itUs->second.coin.DynamicMemoryUsage();
-                itUs->second.AddFlags(CCoinsCacheEntry::DIRTY, *itUs, m_sentinel);
+                AddFlags(*itUs, CCoinsCacheEntry::DIRTY);
                 // NOTE: It isn't safe to mark the coin as FRESH in the parent
                 // cache. If it already existed and was spent in the parent
                 // cache then marking it FRESH would prevent that spentness
@@ -251,8 +267,17 @@ bool CCoinsViewCache::BatchWrite(CoinsViewCacheCursor& cursor, const uint256 &ha
     return true;
 }
 
+CoinsViewCacheCursor CCoinsViewCache::FlaggedEntries(bool will_erase) const
+{
+#ifdef USE_FLAT_COINS_MAP
+    return CoinsViewCacheCursor(cachedCoinsUsage, cacheCoins, will_erase);
+#else
+    return CoinsViewCacheCursor(cachedCoinsUsage, m_sentinel, cacheCoins, will_erase);
+#endif
+}
+
 bool CCoinsViewCache::Flush() {
-    auto cursor{CoinsViewCacheCursor(cachedCoinsUsage, m_sentinel, cacheCoins, /*will_erase=*/true)};
+    auto cursor{FlaggedEntries(/*will_erase=*/true)};
     bool fOk = base->BatchWrite(cursor, hashBlock);
     if (fOk) {
         cacheCoins.clear();
@@ -264,10 +289,10 @@ bool CCoinsViewCache::Flush() {
 
 bool CCoinsViewCache::Sync()
 {
-    auto cursor{CoinsViewCacheCursor(cachedCoinsUsage, m_sentinel, cacheCoins, /*will_erase=*/false)};
+    auto cursor{FlaggedEntries(/*will_erase=*/false)};
     bool fOk = base->BatchWrite(cursor, hashBlock);
     if (fOk) {
-        if (m_sentinel.second.Next() != &m_sentinel) {
+        if (cursor.Begin() != cursor.End()) {
             /* BatchWrite must clear flags of all entries */
             throw std::logic_error("Not all unspent flagged entries were cleared");
         }
@@ -275,6 +300,19 @@ bool CCoinsViewCache::Sync()
     return fOk;
 }
 
+bool CCoinsViewCache::WriteFlagged() const
+{
+    // The cursor leaves the map and the usage untouched when will_erase is set.
+    auto cursor{FlaggedEntries(/*will_erase=*/true)};
+    return base->BatchWrite(cursor, hashBlock);
+}
+
+void CCoinsViewCache::ClearFlagged()
+{
+    auto cursor{FlaggedEntries(/*will_erase=*/false)};
+    for (auto it{cursor.Begin()}; it != cursor.End(); it = cursor.NextAndMaybeErase(*it)) {}
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -334,6 +372,17 @@ void CCoinsViewCache::SanityCheck() const
         // Count the number of entries we expect in the linked list.
         if (entry.IsDirty() || entry.IsFresh()) ++count_flagged;
     }
+#ifdef USE_FLAT_COINS_MAP
+    // Iterate over the index of flagged entries.
+    for (size_t pos = 0; pos < cacheCoins.FlaggedCount(); ++pos) {
+        const auto& entry{cacheCoins.Flagged(pos).second};
+        // Verify the index integrity.
+        assert(entry.FlaggedPos() == pos);
+        // Verify they are actually flagged.
+        assert(entry.IsDirty() || entry.IsFresh());
+    }
+    assert(cacheCoins.FlaggedCount() == count_flagged);
+#else
     // Iterate over the linked list of flagged entries.
     size_t count_linked = 0;
     for (auto it = m_sentinel.second.Next(); it != &m_sentinel; it = it->second.Next()) {
@@ -346,6 +395,7 @@ void CCoinsViewCache::SanityCheck() const
         ++count_linked;
     }
     assert(count_linked == count_flagged);
+#endif
     assert(recomputed_usage == cachedCoinsUsage);
 }
 
@@ -363,6 +413,24 @@ const Coin& AccessByTxid(const CCoinsViewCache& view, const Txid& txid)
     return coinEmpty;
 }
 
+bool CCoinsViewFrozenCache::GetCoin(const COutPoint& outpoint, Coin& coin) const
+{
+    if (const Coin* cached{m_cache.PeekCoin(outpoint)}) {
+        if (cached->IsSpent()) return false;
+        coin = *cached;
+        return true;
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewFrozenCache::HaveCoin(const COutPoint& outpoint) const
+{
+    if (const Coin* cached{m_cache.PeekCoin(outpoint)}) return !cached->IsSpent();
+    return base->HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewFrozenCache::GetBestBlock() const { return m_cache.GetBestBlock(); }
+
 template <typename Func>
 static bool ExecuteBackedWrapper(Func func, const std::vector<std::function<void()>>& err_callbacks)
 {
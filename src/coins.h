@@ -6,6 +6,8 @@
 #ifndef BITCOIN_COINS_H
 #define BITCOIN_COINS_H
 
+#include <config/bitcoin-config.h> // IWYU pragma: keep
+
 #include <compressor.h>
 #include <core_memusage.h>
 #include <memusage.h>
@@ -16,6 +18,10 @@
 #include <util/check.h>
 #include <util/hasher.h>
 
+#ifdef USE_FLAT_COINS_MAP
+#include <coinsflatmap.h>
+#endif
+
 #include <assert.h>
 #include <stdint.h>
 
@@ -108,6 +114,18 @@ using CoinsCachePair = std::pair<const COutPoint, CCoinsCacheEntry>;
 struct CCoinsCacheEntry
 {
 private:
+#ifdef USE_FLAT_COINS_MAP
+    /**
+     * Flagged entries are indexed by the CCoinsMap instead (see CoinsFlatMap),
+     * which sets the flags and the position of the entry in its index of
+     * flagged entries.
+     */
+    uint32_t m_flagged_pos{0};
+    uint8_t m_flags{0};
+
+    template <typename, typename, typename, typename>
+    friend class CoinsFlatMap;
+#else
     /**
      * These are used to create a doubly linked list of flagged entries.
      * They are set in AddFlags and unset in ClearFlags.
@@ -127,6 +145,7 @@ private:
     CoinsCachePair* m_prev{nullptr};
     CoinsCachePair* m_next{nullptr};
     uint8_t m_flags{0};
+#endif
 
 public:
     Coin coin; // The actual cached data.
@@ -154,6 +173,17 @@ public:
 
     CCoinsCacheEntry() noexcept = default;
     explicit CCoinsCacheEntry(Coin&& coin_) noexcept : coin(std::move(coin_)) {}
+#ifdef USE_FLAT_COINS_MAP
+    inline uint8_t GetFlags() const noexcept { return m_flags; }
+    inline bool IsDirty() const noexcept { return m_flags & DIRTY; }
+    inline bool IsFresh() const noexcept { return m_flags & FRESH; }
+
+    //! Position of the entry in the index of flagged entries of the map. Only call this when the entry is DIRTY, FRESH, or both.
+    inline uint32_t FlaggedPos() const noexcept {
+        Assume(m_flags);
+        return m_flagged_pos;
+    }
+#else
     ~CCoinsCacheEntry()
     {
         ClearFlags();
@@ -205,8 +235,14 @@ public:
         // Set sentinel to DIRTY so we can call Next on it
         m_flags = DIRTY;
     }
+#endif
 };
 
+#ifdef USE_FLAT_COINS_MAP
+using CCoinsMap = CoinsFlatMap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>>;
+
+using CCoinsMapMemoryResource = CCoinsMap::ResourceType;
+#else
 /**
  * PoolAllocator's MAX_BLOCK_SIZE_BYTES parameter here uses sizeof the data, and adds the size
  * of 4 pointers. We do not know the exact node size used in the std::unordered_node implementation
@@ -223,6 +259,7 @@ using CCoinsMap = std::unordered_map<COutPoint,
                                                    sizeof(CoinsCachePair) + sizeof(void*) * 4>>;
 
 using CCoinsMapMemoryResource = CCoinsMap::allocator_type::ResourceType;
+#endif
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -258,6 +295,41 @@ private:
  */
 struct CoinsViewCacheCursor
 {
+#ifdef USE_FLAT_COINS_MAP
+    //! See below for will_erase. The flagged entries are iterated from the last position of the index of
+    //! flagged entries of the map to the first one, so that removing the current entry from the index,
+    //! which moves the last flagged entry into its position, does not skip any entry.
+    CoinsViewCacheCursor(size_t& usage LIFETIMEBOUND,
+                        CCoinsMap& map LIFETIMEBOUND,
+                        bool will_erase) noexcept
+        : m_usage(usage), m_map(map), m_will_erase(will_erase) {}
+
+    inline CoinsCachePair* Begin() const noexcept { return Before(m_map.FlaggedCount()); }
+    inline CoinsCachePair* End() const noexcept { return nullptr; }
+
+    //! Return the next entry after current, possibly erasing current
+    inline CoinsCachePair* NextAndMaybeErase(CoinsCachePair& current) noexcept
+    {
+        const auto next_entry{Before(current.second.FlaggedPos())};
+        if (!m_will_erase) {
+            if (current.second.coin.IsSpent()) {
+                m_usage -= current.second.coin.DynamicMemoryUsage();
+                m_map.erase(current.first);
+            } else {
+                m_map.ClearFlags(current);
+            }
+        }
+        return next_entry;
+    }
+
+    inline bool WillErase(CoinsCachePair& current) const noexcept { return m_will_erase || current.second.coin.IsSpent(); }
+private:
+    inline CoinsCachePair* Before(size_t pos) const noexcept { return pos > 0 ? &m_map.Flagged(pos - 1) : nullptr; }
+
+    size_t& m_usage;
+    CCoinsMap& m_map;
+    bool m_will_erase;
+#else
     //! If will_erase is not set, iterating through the cursor will erase spent coins from the map,
     //! and other coins will be unflagged (removing them from the linked list).
     //! If will_erase is set, the underlying map and linked list will not be modified,
@@ -297,6 +369,7 @@ private:
     CoinsCachePair& m_sentinel;
     CCoinsMap& m_map;
     bool m_will_erase;
+#endif
 };
 
 /** Abstract view on the open txout dataset. */
@@ -368,8 +441,10 @@ protected:
      */
     mutable uint256 hashBlock;
     mutable CCoinsMapMemoryResource m_cache_coins_memory_resource{};
+#ifndef USE_FLAT_COINS_MAP
     /* The starting sentinel of the flagged entry circular doubly linked list. */
     mutable CoinsCachePair m_sentinel;
+#endif
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -400,6 +475,13 @@ public:
      */
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
+    /**
+     * Return the coin cached for the given outpoint, without calling the
+     * backing CCoinsView or modifying the cache. A spent coin is returned if
+     * the outpoint is cached as spent, and nullptr if it is not cached.
+     */
+    const Coin* PeekCoin(const COutPoint& outpoint) const;
+
     /**
      * Return a reference to Coin in the cache, or coinEmpty if not found. This is
      * more efficient than GetCoin.
@@ -427,6 +509,17 @@ public:
      */
     void EmplaceCoinInternalDANGER(COutPoint&& outpoint, Coin&& coin);
 
+    /**
+     * Add a coin which was read from the backing view to the cache, unless the
+     * outpoint is already cached. The coin is not marked dirty or fresh, as if it
+     * had been fetched by this cache.
+     *
+     * Used to warm the cache with coins read from the backing view on other threads.
+     * The backing view must not have changed since the coin was read.
+     * @sa Chainstate::PrefetchCoins()
+     */
+    void EmplaceBaseCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -451,6 +544,18 @@ public:
      */
     bool Sync();
 
+    /**
+     * Push the modifications applied to this cache to its base like Sync(),
+     * but without modifying this cache, so that it can still be read (through
+     * a CCoinsViewFrozenCache) from other threads while the coins are written.
+     * Call ClearFlagged() once the write succeeded.
+     * If false is returned, the state of the backing view will be undefined.
+     */
+    bool WriteFlagged() const;
+
+    //! Erase spent coins and clear the flags of the other coins after WriteFlagged() succeeded
+    void ClearFlagged();
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
@@ -482,6 +587,19 @@ private:
      * memory usage.
      */
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
+
+    //! Add flags to an entry of cacheCoins, tracking it as a flagged entry
+    void AddFlags(CoinsCachePair& entry, uint8_t flags) const
+    {
+#ifdef USE_FLAT_COINS_MAP
+        cacheCoins.AddFlags(entry, flags);
+#else
+        entry.second.AddFlags(flags, entry, m_sentinel);
+#endif
+    }
+
+    //! Cursor over the flagged entries of cacheCoins
+    CoinsViewCacheCursor FlaggedEntries(bool will_erase) const;
 };
 
 //! Utility function to add all of a transaction's outputs to a cache.
@@ -498,6 +616,31 @@ void AddCoins(CCoinsViewCache& cache, const CTransaction& tx, int nHeight, bool
 //! lookups to database, so it should be used with care.
 const Coin& AccessByTxid(const CCoinsViewCache& cache, const Txid& txid);
 
+/**
+ * Read-only view of a CCoinsViewCache whose modified coins are being written to
+ * the backing view by another thread (see CCoinsViewCache::WriteFlagged()).
+ * Coins that are not cached are read from the backing view without adding
+ * them to the cache, so that the cache is not modified during the write.
+ */
+class CCoinsViewFrozenCache final : public CCoinsViewBacked
+{
+public:
+    CCoinsViewFrozenCache(CCoinsView* view, const CCoinsViewCache& cache) : CCoinsViewBacked(view), m_cache(cache) {}
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
+    bool HaveCoin(const COutPoint& outpoint) const override;
+    uint256 GetBestBlock() const override;
+    bool BatchWrite(CoinsViewCacheCursor& cursor, const uint256& hashBlock) override {
+        throw std::logic_error("CCoinsViewFrozenCache cannot be written to.");
+    }
+    std::unique_ptr<CCoinsViewCursor> Cursor() const override {
+        throw std::logic_error("CCoinsViewFrozenCache cursor iteration not supported.");
+    }
+
+private:
+    const CCoinsViewCache& m_cache;
+};
+
 /**
  * This is a minimally invasive approach to shutdown on LevelDB read errors from the
  * chainstate, while keeping user interface out of the common library, which is shared
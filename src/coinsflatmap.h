@@ -0,0 +1,393 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSFLATMAP_H
+#define BITCOIN_COINSFLATMAP_H
+
+#include <memusage.h>
+#include <util/check.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Open addressing hash map used as CCoinsMap when configured with
+ * --enable-flat-coins-map.
+ *
+ * Buckets are 8 bytes: a 32 bit fingerprint of the hash of the key and the
+ * index of the entry. They are probed linearly, so that looking up a missing
+ * outpoint usually reads a single cache line of buckets and no entry at all.
+ *
+ * Entries (std::pair<const Key, T>, with the coin inline) are stored in chunks
+ * which are never moved or freed before the map is cleared, so that, as for
+ * std::unordered_map, references to entries stay valid until they are erased.
+ * Erased entries are reused by later insertions.
+ *
+ * Instead of a linked list through the entries, the entries with flags set
+ * (see CCoinsCacheEntry) are indexed by a vector of pointers, and each flagged
+ * entry stores its position in that vector. T must have uint8_t m_flags and
+ * uint32_t m_flagged_pos members accessible by this class.
+ */
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+class CoinsFlatMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using size_type = size_t;
+
+    //! No memory resource is used, the map allocates its own chunks of entries.
+    struct ResourceType {};
+
+private:
+    static constexpr uint32_t BUCKET_EMPTY{0};
+    static constexpr uint32_t BUCKET_DELETED{1};
+    static constexpr size_t MIN_BUCKETS{16};
+    static constexpr uint32_t NO_FREE_SLOT{std::numeric_limits<uint32_t>::max()};
+    //! Entries in the first chunk. Each further chunk is twice as large, up to MAX_CHUNK_SLOTS.
+    static constexpr uint32_t FIRST_CHUNK_SLOTS{64};
+    static constexpr int GROWING_CHUNKS{7};
+    static constexpr uint32_t MAX_CHUNK_SLOTS{FIRST_CHUNK_SLOTS << (GROWING_CHUNKS - 1)};
+    static constexpr uint32_t GROWING_CHUNKS_SLOTS{FIRST_CHUNK_SLOTS * ((1 << GROWING_CHUNKS) - 1)};
+
+    struct Bucket {
+        //! BUCKET_EMPTY, BUCKET_DELETED, or the fingerprint of the hash of the key of the entry
+        uint32_t fingerprint{BUCKET_EMPTY};
+        uint32_t index{0};
+    };
+
+    //! Storage of one entry, which holds the index of the next free slot while unused
+    union Slot {
+        Slot() noexcept {}
+        ~Slot() {}
+        uint32_t next_free;
+        value_type value;
+    };
+
+    Hash m_hash;
+    KeyEqual m_equal;
+    //! Power of two number of buckets, or none before the first insertion
+    std::vector<Bucket> m_buckets;
+    size_t m_size{0};
+    size_t m_deleted{0};
+    std::vector<std::unique_ptr<Slot[]>> m_chunks;
+    size_t m_chunks_usage{0};
+    uint32_t m_slots_allocated{0};
+    //! Number of slots which were ever used since the map was cleared
+    uint32_t m_slots_used{0};
+    uint32_t m_free_slot{NO_FREE_SLOT};
+    std::vector<value_type*> m_flagged;
+
+    static uint32_t Fingerprint(size_t hash) noexcept
+    {
+        const uint32_t fingerprint{static_cast<uint32_t>((uint64_t{hash} * 0x9E3779B97F4A7C15ULL) >> 32)};
+        return fingerprint > BUCKET_DELETED ? fingerprint : fingerprint + 2;
+    }
+
+    static uint32_t ChunkSlots(size_t chunk) noexcept
+    {
+        return chunk < GROWING_CHUNKS ? FIRST_CHUNK_SLOTS << chunk : MAX_CHUNK_SLOTS;
+    }
+
+    Slot& SlotAt(uint32_t index) const noexcept
+    {
+        if (index < GROWING_CHUNKS_SLOTS) {
+            const auto chunk{static_cast<size_t>(std::bit_width(index / FIRST_CHUNK_SLOTS + 1) - 1)};
+            return m_chunks[chunk][index + FIRST_CHUNK_SLOTS - (FIRST_CHUNK_SLOTS << chunk)];
+        }
+        const uint32_t rest{index - GROWING_CHUNKS_SLOTS};
+        return m_chunks[GROWING_CHUNKS + rest / MAX_CHUNK_SLOTS][rest % MAX_CHUNK_SLOTS];
+    }
+
+    value_type& ValueAt(size_t pos) const noexcept { return SlotAt(m_buckets[pos].index).value; }
+
+    size_t NextFull(size_t pos) const noexcept
+    {
+        while (pos < m_buckets.size() && m_buckets[pos].fingerprint <= BUCKET_DELETED) ++pos;
+        return pos;
+    }
+
+    uint32_t AllocateSlot()
+    {
+        if (m_free_slot != NO_FREE_SLOT) {
+            const uint32_t index{m_free_slot};
+            m_free_slot = SlotAt(index).next_free;
+            return index;
+        }
+        if (m_slots_used == m_slots_allocated) {
+            const uint32_t slots{ChunkSlots(m_chunks.size())};
+            if (m_slots_allocated > NO_FREE_SLOT - slots) throw std::bad_alloc{};
+            m_chunks.emplace_back(new Slot[slots]);
+            m_chunks_usage += memusage::MallocUsage(slots * sizeof(Slot));
+            m_slots_allocated += slots;
+        }
+        return m_slots_used++;
+    }
+
+    void FreeSlot(uint32_t index) noexcept
+    {
+        Slot& slot{SlotAt(index)};
+        slot.value.~value_type();
+        slot.next_free = m_free_slot;
+        m_free_slot = index;
+    }
+
+    void Rehash(size_t bucket_count)
+    {
+        std::vector<Bucket> buckets(bucket_count);
+        const size_t mask{bucket_count - 1};
+        for (const Bucket& bucket : m_buckets) {
+            if (bucket.fingerprint <= BUCKET_DELETED) continue;
+            size_t pos{m_hash(SlotAt(bucket.index).value.first) & mask};
+            while (buckets[pos].fingerprint != BUCKET_EMPTY) pos = (pos + 1) & mask;
+            buckets[pos] = bucket;
+        }
+        m_buckets = std::move(buckets);
+        m_deleted = 0;
+    }
+
+    //! Make sure that a bucket can be used by an insertion, keeping the load of the buckets at most 7/8
+    void ReserveBucket()
+    {
+        if (m_buckets.empty()) {
+            m_buckets.resize(MIN_BUCKETS);
+        } else if ((m_size + m_deleted + 1) * 8 > m_buckets.size() * 7) {
+            // Grow if the entries alone would load the buckets more than 7/16, otherwise only drop the deleted buckets
+            Rehash((m_size + 1) * 16 > m_buckets.size() * 7 ? m_buckets.size() * 2 : m_buckets.size());
+        }
+    }
+
+    void DestroyEntries() noexcept
+    {
+        for (const Bucket& bucket : m_buckets) {
+            if (bucket.fingerprint > BUCKET_DELETED) SlotAt(bucket.index).value.~value_type();
+        }
+    }
+
+    template <bool Const>
+    class Iterator
+    {
+        using Map = std::conditional_t<Const, const CoinsFlatMap, CoinsFlatMap>;
+        Map* m_map{nullptr};
+        size_t m_pos{0};
+
+        friend class CoinsFlatMap;
+        Iterator(Map* map, size_t pos) noexcept : m_map{map}, m_pos{pos} {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = CoinsFlatMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+        Iterator() noexcept = default;
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        Iterator(const Iterator<false>& other) noexcept : m_map{other.m_map}, m_pos{other.m_pos} {}
+
+        reference operator*() const noexcept { return m_map->ValueAt(m_pos); }
+        pointer operator->() const noexcept { return &m_map->ValueAt(m_pos); }
+        Iterator& operator++() noexcept
+        {
+            m_pos = m_map->NextFull(m_pos + 1);
+            return *this;
+        }
+        Iterator operator++(int) noexcept
+        {
+            Iterator copy{*this};
+            ++*this;
+            return copy;
+        }
+        friend bool operator==(const Iterator& a, const Iterator& b) noexcept { return a.m_pos == b.m_pos; }
+
+        friend class Iterator<true>;
+    };
+
+public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    explicit CoinsFlatMap(size_t bucket_count = 0, const Hash& hash = Hash{}, const KeyEqual& equal = KeyEqual{}, ResourceType* = nullptr)
+        : m_hash{hash}, m_equal{equal}
+    {
+        if (bucket_count > 0) reserve(bucket_count);
+    }
+    ~CoinsFlatMap() { DestroyEntries(); }
+
+    CoinsFlatMap(const CoinsFlatMap&) = delete;
+    CoinsFlatMap& operator=(const CoinsFlatMap&) = delete;
+
+    iterator begin() noexcept { return {this, NextFull(0)}; }
+    const_iterator begin() const noexcept { return {this, NextFull(0)}; }
+    iterator end() noexcept { return {this, m_buckets.size()}; }
+    const_iterator end() const noexcept { return {this, m_buckets.size()}; }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+
+    //! Make room for count entries without rehashing
+    void reserve(size_t count)
+    {
+        size_t bucket_count{std::max(MIN_BUCKETS, m_buckets.size())};
+        while (count * 16 > bucket_count * 7) bucket_count *= 2;
+        if (bucket_count > m_buckets.size()) Rehash(bucket_count);
+    }
+
+    iterator find(const Key& key) noexcept
+    {
+        if (m_buckets.empty()) return end();
+        const size_t hash{m_hash(key)};
+        const uint32_t fingerprint{Fingerprint(hash)};
+        const size_t mask{m_buckets.size() - 1};
+        for (size_t pos{hash & mask};; pos = (pos + 1) & mask) {
+            const Bucket& bucket{m_buckets[pos]};
+            if (bucket.fingerprint == BUCKET_EMPTY) return end();
+            if (bucket.fingerprint == fingerprint && m_equal(SlotAt(bucket.index).value.first, key)) return {this, pos};
+        }
+    }
+    const_iterator find(const Key& key) const noexcept { return const_cast<CoinsFlatMap*>(this)->find(key); }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    {
+        ReserveBucket();
+        const size_t hash{m_hash(key)};
+        const uint32_t fingerprint{Fingerprint(hash)};
+        const size_t mask{m_buckets.size() - 1};
+        size_t insert_pos{m_buckets.size()};
+        size_t pos{hash & mask};
+        for (;; pos = (pos + 1) & mask) {
+            const Bucket& bucket{m_buckets[pos]};
+            if (bucket.fingerprint == BUCKET_EMPTY) break;
+            if (bucket.fingerprint == BUCKET_DELETED) {
+                if (insert_pos == m_buckets.size()) insert_pos = pos;
+            } else if (bucket.fingerprint == fingerprint && m_equal(SlotAt(bucket.index).value.first, key)) {
+                return {iterator{this, pos}, false};
+            }
+        }
+        if (insert_pos == m_buckets.size()) insert_pos = pos;
+
+        const uint32_t index{AllocateSlot()};
+        ::new (&SlotAt(index).value) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+        Bucket& bucket{m_buckets[insert_pos]};
+        if (bucket.fingerprint == BUCKET_DELETED) --m_deleted;
+        bucket = Bucket{fingerprint, index};
+        ++m_size;
+        return {iterator{this, insert_pos}, true};
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(std::piecewise_construct_t, std::tuple<const Key&> key, std::tuple<Args...> args)
+    {
+        return std::apply([&](auto&&... a) { return try_emplace(std::get<0>(key), std::forward<decltype(a)>(a)...); }, std::move(args));
+    }
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(std::piecewise_construct_t, std::tuple<Key&&> key, std::tuple<Args...> args)
+    {
+        return std::apply([&](auto&&... a) { return try_emplace(std::get<0>(key), std::forward<decltype(a)>(a)...); }, std::move(args));
+    }
+    template <typename V>
+    std::pair<iterator, bool> emplace(const Key& key, V&& value)
+    {
+        return try_emplace(key, std::forward<V>(value));
+    }
+
+    T& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+    iterator erase(const_iterator it) noexcept
+    {
+        const size_t mask{m_buckets.size() - 1};
+        Bucket& bucket{m_buckets[it.m_pos]};
+        ClearFlags(SlotAt(bucket.index).value);
+        FreeSlot(bucket.index);
+        --m_size;
+        if (m_buckets[(it.m_pos + 1) & mask].fingerprint == BUCKET_EMPTY) {
+            // No probe sequence continues past this bucket, nor past the deleted buckets before it
+            bucket.fingerprint = BUCKET_EMPTY;
+            for (size_t pos{(it.m_pos - 1) & mask}; m_buckets[pos].fingerprint == BUCKET_DELETED; pos = (pos - 1) & mask) {
+                m_buckets[pos].fingerprint = BUCKET_EMPTY;
+                --m_deleted;
+            }
+        } else {
+            bucket.fingerprint = BUCKET_DELETED;
+            ++m_deleted;
+        }
+        return {this, NextFull(it.m_pos + 1)};
+    }
+    iterator erase(iterator it) noexcept { return erase(const_iterator{it}); }
+    size_t erase(const Key& key) noexcept
+    {
+        const auto it{find(key)};
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    //! Erase all entries, keeping the allocated buckets and chunks of entries
+    void clear() noexcept
+    {
+        DestroyEntries();
+        std::fill(m_buckets.begin(), m_buckets.end(), Bucket{});
+        m_size = 0;
+        m_deleted = 0;
+        m_slots_used = 0;
+        m_free_slot = NO_FREE_SLOT;
+        m_flagged.clear();
+    }
+
+    //! Add flags to an entry of the map, indexing it as flagged if it was not
+    void AddFlags(value_type& entry, uint8_t flags)
+    {
+        if (!entry.second.m_flags && flags) {
+            entry.second.m_flagged_pos = m_flagged.size();
+            m_flagged.push_back(&entry);
+        }
+        entry.second.m_flags |= flags;
+    }
+
+    //! Clear the flags of an entry of the map, removing it from the flagged index
+    void ClearFlags(value_type& entry) noexcept
+    {
+        if (!entry.second.m_flags) return;
+        const uint32_t pos{entry.second.m_flagged_pos};
+        Assume(m_flagged[pos] == &entry);
+        m_flagged[pos] = m_flagged.back();
+        m_flagged[pos]->second.m_flagged_pos = pos;
+        m_flagged.pop_back();
+        entry.second.m_flags = 0;
+    }
+
+    //! Number of entries with flags set
+    size_t FlaggedCount() const noexcept { return m_flagged.size(); }
+    //! Flagged entry at a position of the flagged index. Clearing the flags of an entry only moves the last flagged entry.
+    value_type& Flagged(size_t pos) const noexcept { return *m_flagged[pos]; }
+
+    size_t DynamicMemoryUsage() const noexcept
+    {
+        return memusage::DynamicUsage(m_buckets) + memusage::DynamicUsage(m_chunks) + m_chunks_usage + memusage::DynamicUsage(m_flagged);
+    }
+};
+
+namespace memusage {
+template <typename Key, typename T, typename Hash, typename KeyEqual>
+static inline size_t DynamicUsage(const CoinsFlatMap<Key, T, Hash, KeyEqual>& m)
+{
+    return m.DynamicMemoryUsage();
+}
+} // namespace memusage
+
+#endif // BITCOIN_COINSFLATMAP_H
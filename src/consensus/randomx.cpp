@@ -0,0 +1,42 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <consensus/randomx.h>
+
+#include <crypto/sha256.h>
+#include <primitives/block.h>
+#include <tinyformat.h>
+
+#include <randomx.h>
+
+#include <string>
+#include <vector>
+
+// Seed string contains an epoch integer and is sha256d hashed to derive the seed hash (RandomX key).
+static const char *RANDOMX_EPOCH_SEED_STRING = "Snailcoin/RandomX/Epoch/%d";
+
+// Epoch is Unix time stamp in seconds divided by epoch duration in seconds.
+uint32_t GetEpoch(uint32_t nTimestamp, uint32_t nDuration) {
+    return nTimestamp / nDuration;
+}
+
+// Compute seed hash (the RandomX key) for an epoch. Applies sha256d to the seed string.
+uint256 GetSeedHash(uint32_t nEpoch)
+{
+    std::string s = strprintf(RANDOMX_EPOCH_SEED_STRING, nEpoch);
+    uint256 h1, h2;
+    CSHA256().Write((const unsigned char*)s.data(), s.size()).Finalize(h1.begin());
+    CSHA256().Write(h1.begin(), 32).Finalize(h2.begin());
+    return h2;
+}
+
+// Compute randomx commitment from block header. If inHash parameter is not provided, use hash from block header.
+uint256 GetRandomXCommitment(const CBlockHeader& block, uint256 *inHash) {
+    uint256 rx_hash = inHash==nullptr ? block.hashRandomX : *inHash;
+    CBlockHeader rx_blockHeader(block);
+    rx_blockHeader.hashRandomX.SetNull();   // set to null when hashing
+    char rx_cm[RANDOMX_HASH_SIZE];
+    randomx_calculate_commitment(&rx_blockHeader, sizeof(rx_blockHeader), rx_hash.data(), rx_cm);
+    return uint256(std::vector<unsigned char>(rx_cm, rx_cm + sizeof(rx_cm)));
+}
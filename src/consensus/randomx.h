@@ -0,0 +1,23 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CONSENSUS_RANDOMX_H
+#define BITCOIN_CONSENSUS_RANDOMX_H
+
+#include <uint256.h>
+
+#include <cstdint>
+
+class CBlockHeader;
+
+/** Calculate epoch from timestamp */
+uint32_t GetEpoch(uint32_t nTime, uint32_t nDuration);
+
+/** Calculate RandomX key for a given epoch */
+uint256 GetSeedHash(uint32_t nEpoch);
+
+/** Calculate RandomX commitment of block */
+uint256 GetRandomXCommitment(const CBlockHeader& block, uint256 *inHash = nullptr);
+
+#endif // BITCOIN_CONSENSUS_RANDOMX_H
@@ -35,6 +35,7 @@
 #include <interfaces/node.h>
 #include <kernel/context.h>
 #include <key.h>
+#include <key_io.h>
 #include <logging.h>
 #include <mapport.h>
 #include <net.h>
@@ -48,6 +49,7 @@
 #include <node/chainstate.h>
 #include <node/chainstatemanager_args.h>
 #include <node/context.h>
+#include <node/cpuminer.h>
 #include <node/interface_ui.h>
 #include <node/kernel_notifications.h>
 #include <node/mempool_args.h>
@@ -55,11 +57,13 @@
 #include <node/mempool_persist_args.h>
 #include <node/miner.h>
 #include <node/peerman_args.h>
+#include <node/stratum.h>
 #include <policy/feerate.h>
 #include <policy/fees.h>
 #include <policy/fees_args.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <powverifyqueue.h>
 #include <protocol.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
@@ -287,12 +291,21 @@ void Shutdown(NodeContext& node)
     StopHTTPRPC();
     StopREST();
     StopRPC();
+    // The Stratum server runs on the event base of the HTTP server. It is only destroyed once the
+    // scheduler has been stopped, because its UpdatedBlockTip callback may still be running.
+    if (node.stratum) {
+        if (node.validation_signals) node.validation_signals->UnregisterValidationInterface(node.stratum.get());
+        node.stratum->Stop();
+    }
     StopHTTPServer();
     for (const auto& client : node.chain_clients) {
         client->flush();
     }
     StopMapPort();
 
+    // Stop mining before the chainstate it builds on is torn down
+    node.cpu_miner.reset();
+
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
     if (node.peerman && node.validation_signals) node.validation_signals->UnregisterValidationInterface(node.peerman.get());
@@ -308,6 +321,8 @@ void Shutdown(NodeContext& node)
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
+    node.stratum.reset();
+    node.block_template_cache.reset();
     node.peerman.reset();
     node.connman.reset();
     node.banman.reset();
@@ -481,6 +496,8 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-alertnotify=<cmd>", "Execute command when an alert is raised (%s in cmd is replaced by message)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet3: %s, testnet4: %s, signet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnet4ChainParams->GetConsensus().defaultAssumeValid.GetHex(), signetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-backgroundcoinsflush", strprintf("Write the coins cache to disk from a background thread while blocks keep being connected, when it is flushed because it is full or periodically. "
+        "The coins being written count towards -dbcache until they are written (default: %u)", DEFAULT_BACKGROUND_COINS_FLUSH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksxor",
                    strprintf("Whether an XOR-key applies to blocksdir *.dat files. "
@@ -509,6 +526,10 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet3: %s, testnet4: %s, signet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnet4ChainParams->GetConsensus().nMinimumChainWork.GetHex(), signetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (0 = auto, up to %d, <0 = leave that many cores free, default: %d)",
         MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-prefetchthreads=<n>", strprintf("Set the number of threads reading the coins spent by a block from the chainstate database before connecting it (0 = disabled, up to %d, default: %d)",
+        MAX_COINS_PREFETCH_THREADS, DEFAULT_COINS_PREFETCH_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-scriptcheckpipeline=<n>", strprintf("During initial block download, connect up to <n> blocks while the script checks of the blocks before them are still running (0 = wait for the script checks of each block, up to %d, default: %d)",
+        MAX_SCRIPT_CHECK_PIPELINE_BLOCKS, DEFAULT_SCRIPT_CHECK_PIPELINE_BLOCKS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempoolv1",
                    strprintf("Whether a mempool.dat file created by -persistmempool or the savemempool RPC will be written in the legacy format "
@@ -532,7 +553,15 @@ void SetupServerArgs(ArgsManager& argsman)
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-randomxfastmode", strprintf("Enable fast mode for RandomX VM, but with greatly increased memory usage. Use 1 to enable. (default: %u)", DEFAULT_RANDOMX_FAST_MODE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxinitthreads=<n>", strprintf("Number of threads used to create the RandomX dataset in fast mode (0 = one thread per core, default: %d)", DEFAULT_RANDOMX_INIT_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxlargepages", strprintf("Allocate RandomX memory with large pages if available, which speeds up hashing. Large pages must be reserved by the operating system. (default: %u)", DEFAULT_RANDOMX_LARGE_PAGES), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxmaxmem=<n>", strprintf("Maximum memory in MiB used by cached RandomX caches, datasets and VMs. Epochs other than the chain tip's are dropped to stay within it, and fast mode datasets are not created if they do not fit. (0 = no limit, default: %d)", DEFAULT_RANDOMX_MAX_MEM), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxnuma", strprintf("In fast mode, keep a copy of the RandomX dataset on each NUMA node, used by VMs running on the node. Uses 2080 MiB of memory per node. (default: %u)", DEFAULT_RANDOMX_NUMA), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxpersistdataset", strprintf("Write the RandomX fast mode dataset to the data directory and read it back after a restart instead of creating it again. Uses about 2 GiB of disk space per epoch. (default: %u)", DEFAULT_RANDOMX_PERSIST_DATASET), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxprebuildlead=<n>", strprintf("Create the RandomX VMs for the next epoch this many minutes before it starts, so that its first blocks are verified without delay (0 to disable, default: %d)", DEFAULT_RANDOMX_PREBUILD_LEAD), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-randomxvmcachesize=<n>", strprintf("Cache RandomX VMs used for each epoch, but this greatly increases memory usage. (minimum: 1, default: %d).", DEFAULT_RANDOMX_VM_CACHE_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxverifythreads=<n>", strprintf("Set the number of threads verifying RandomX hashes of batches of downloaded headers in parallel (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)", MAX_RANDOMX_VERIFY_THREADS, DEFAULT_RANDOMX_VERIFY_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-randomxvmpoolsize=<n>", strprintf("Number of RandomX VMs per epoch, allowing blocks to be verified concurrently. Each VM uses 2 MiB of additional memory. (0 = one VM per core, default: %d)", DEFAULT_RANDOMX_VM_POOL_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-suspiciousreorgdepth=<n>", strprintf("Reorg depth considered suspicious by node. Upon detection, node shuts down. Use 0 to disable. (minimum: 2, default: %d blocks)", DEFAULT_SUSPICIOUS_REORG_DEPTH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-adddnsseed=<ip>", "Add address of DNS seed to query for addresses of nodes via DNS lookup. This option can be specified multiple times to connect to multiple DNS seeds.", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::CONNECTION);
 
@@ -662,6 +691,7 @@ void SetupServerArgs(ArgsManager& argsman)
                              "is of this size or less (default: %u)",
                              MAX_OP_RETURN_RELAY),
                    ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
+    argsman.AddArg("-fastcmpctblockrelay", strprintf("Relay compact blocks extending the tip, received from peers with 'noban' permission, to high-bandwidth peers once reconstructed, before their RandomX hash is verified. A peer which sent a block failing that check is disconnected despite its 'noban' permission, and its blocks are verified before relaying from then on. Peers receiving such a block from this node disconnect it in turn, so only enable this between nodes which grant each other 'noban' permission (default: %u)", DEFAULT_FAST_CMPCTBLOCK_RELAY), ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
     argsman.AddArg("-mempoolfullrbf", strprintf("(DEPRECATED) Accept transaction replace-by-fee without requiring replaceability signaling (default: %u)", DEFAULT_MEMPOOL_FULL_RBF), ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
     argsman.AddArg("-permitbaremultisig", strprintf("Relay transactions creating non-P2SH multisig outputs (default: %u)", DEFAULT_PERMIT_BAREMULTISIG), ArgsManager::ALLOW_ANY,
                    OptionsCategory::NODE_RELAY);
@@ -673,6 +703,12 @@ void SetupServerArgs(ArgsManager& argsman)
 
     argsman.AddArg("-blockmaxweight=<n>", strprintf("Set maximum BIP141 block weight (default: %d)", DEFAULT_BLOCK_MAX_WEIGHT), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockmintxfee=<amt>", strprintf("Set lowest fee rate (in %s/kvB) for transactions to be included in block creation. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-genproclimit=<n>", strprintf("Number of threads mining blocks with the generate and setgenerate RPCs (-1 = one per core, default: %d)", node::DEFAULT_GENPROCLIMIT), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratum", strprintf("Accept Stratum mining connections, for jobs paying to -stratumaddress. Requires -server (default: %u)", node::DEFAULT_STRATUM), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratumaddress=<address>", "Address paid by the coinbase of Stratum jobs", ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratumbind=<addr>[:port]", "Bind to given address to listen for Stratum connections. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1)", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratumport=<port>", strprintf("Listen for Stratum connections on <port> (default: %u)", node::DEFAULT_STRATUM_PORT), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-stratumsharediff=<n>", strprintf("Difficulty of Stratum shares relative to the proof-of-work limit, capped at the block difficulty. 0 means shares must solve the block (default: %d)", node::DEFAULT_STRATUM_SHARE_DIFFICULTY), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::BLOCK_CREATION);
 
     argsman.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
@@ -1095,6 +1131,18 @@ bool AppInitParameterInteraction(const ArgsManager& args)
         }
     }
 
+    if (args.GetBoolArg("-stratum", node::DEFAULT_STRATUM)) {
+        if (!args.GetBoolArg("-server", false)) {
+            return InitError(Untranslated("-stratum requires -server."));
+        }
+        if (!IsValidDestination(DecodeDestination(args.GetArg("-stratumaddress", "")))) {
+            return InitError(Untranslated("-stratum requires a valid -stratumaddress."));
+        }
+        if (args.GetIntArg("-stratumsharediff", node::DEFAULT_STRATUM_SHARE_DIFFICULTY) < 0) {
+            return InitError(Untranslated("stratumsharediff must be 0 or a positive integer."));
+        }
+    }
+
     if (chain == ChainType::SNAILCOINMAIN || chain == ChainType::SNAILCOINREGTEST || chain == ChainType::SNAILCOINTESTNET) {
         if (args.GetBoolArg("-datacarrier", DEFAULT_ACCEPT_DATACARRIER)) {
             return InitError(Untranslated("Data carrier is not supported."));
@@ -1102,6 +1150,22 @@ bool AppInitParameterInteraction(const ArgsManager& args)
         if (args.GetIntArg("-randomxvmcachesize", DEFAULT_RANDOMX_VM_CACHE_SIZE) <= 0) {
             return InitError(Untranslated("randomxvmcachesize must be a positive integer."));
         }
+        if (args.GetIntArg("-randomxinitthreads", DEFAULT_RANDOMX_INIT_THREADS) < 0) {
+            return InitError(Untranslated("randomxinitthreads must be 0 or a positive integer."));
+        }
+        if (args.GetIntArg("-randomxvmpoolsize", DEFAULT_RANDOMX_VM_POOL_SIZE) < 0) {
+            return InitError(Untranslated("randomxvmpoolsize must be 0 or a positive integer."));
+        }
+        if (args.GetIntArg("-randomxmaxmem", DEFAULT_RANDOMX_MAX_MEM) < 0) {
+            return InitError(Untranslated("randomxmaxmem must be 0 or a positive integer."));
+        }
+        if (args.GetIntArg("-randomxprebuildlead", DEFAULT_RANDOMX_PREBUILD_LEAD) < 0) {
+            return InitError(Untranslated("randomxprebuildlead must be 0 or a positive integer."));
+        }
+        const int64_t genproclimit{args.GetIntArg("-genproclimit", node::DEFAULT_GENPROCLIMIT)};
+        if (genproclimit < -1 || genproclimit == 0) {
+            return InitError(Untranslated("genproclimit must be -1 or a positive integer."));
+        }
         int nDepth = args.GetIntArg("-suspiciousreorgdepth", DEFAULT_SUSPICIOUS_REORG_DEPTH);
         if (nDepth < 2 && nDepth != 0) {
             return InitError(Untranslated("suspiciousreorgdepth must be a positive integer, 2 or greater (use 0 to disable)."));
@@ -1194,6 +1258,9 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         } else {
             LogPrintf("- light memory mode (256 MiB)\n");
         }
+        if (gArgs.GetBoolArg("-randomxlargepages", DEFAULT_RANDOMX_LARGE_PAGES)) {
+            LogPrintf("- large pages requested\n");
+        }
     }
 
     auto opt_max_upload = ParseByteUnits(args.GetArg("-maxuploadtarget", DEFAULT_MAX_UPLOAD_TARGET), ByteUnit::M);
@@ -1245,6 +1312,19 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         }
     }, std::chrono::minutes{5});
 
+    // Build the RandomX VMs of the next epoch ahead of time, once the node has caught up. The previous epoch is
+    // evicted from the cache to make room, so this is skipped unless at least two epochs are cached.
+    const int64_t nPrebuildLead{args.GetIntArg("-randomxprebuildlead", DEFAULT_RANDOMX_PREBUILD_LEAD)};
+    if (g_isRandomX && nPrebuildLead > 0 && args.GetIntArg("-randomxvmcachesize", DEFAULT_RANDOMX_VM_CACHE_SIZE) >= 2) {
+        const uint32_t nDuration = chainparams.GetConsensus().nRandomXEpochDuration;
+        scheduler.scheduleEvery([nDuration, nPrebuildLead]{
+            if (!g_isIBDFinished) return;
+            if (const auto nNextEpoch{GetRandomXPrebuildEpoch(GetTime(), nPrebuildLead, nDuration)}) {
+                PrebuildRandomXEpoch(*nNextEpoch);
+            }
+        }, std::chrono::minutes{1});
+    }
+
     assert(!node.validation_signals);
     node.validation_signals = std::make_unique<ValidationSignals>(std::make_unique<SerialTaskRunner>(scheduler));
     auto& validation_signals = *node.validation_signals;
@@ -1716,6 +1796,33 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                                      peerman_opts);
     validation_signals.RegisterValidationInterface(node.peerman.get());
 
+    node::BlockAssembler::Options block_template_options;
+    ApplyArgsManOptions(args, block_template_options);
+    node.block_template_cache = std::make_unique<node::BlockTemplateCache>(chainman, *node.mempool, block_template_options, &validation_signals);
+
+    node.cpu_miner = std::make_unique<node::CPUMiner>(*Assert(node.mining), chainman.GetConsensus());
+
+    if (args.GetBoolArg("-stratum", node::DEFAULT_STRATUM)) {
+        const uint16_t stratum_port{static_cast<uint16_t>(args.GetIntArg("-stratumport", node::DEFAULT_STRATUM_PORT))};
+        std::vector<std::string> stratum_bind_args{args.GetArgs("-stratumbind")};
+        if (stratum_bind_args.empty()) stratum_bind_args = {"::1", "127.0.0.1"};
+        std::vector<CService> stratum_binds;
+        for (const std::string& bind_arg : stratum_bind_args) {
+            const std::optional<CService> bind_addr{Lookup(bind_arg, stratum_port, false)};
+            if (!bind_addr) {
+                return InitError(ResolveErrMsg("stratumbind", bind_arg));
+            }
+            stratum_binds.push_back(*bind_addr);
+        }
+        node.stratum = std::make_unique<node::StratumServer>(*node.mining, chainman.GetConsensus(), EventBase(),
+                                                             GetScriptForDestination(DecodeDestination(args.GetArg("-stratumaddress", ""))),
+                                                             args.GetIntArg("-stratumsharediff", node::DEFAULT_STRATUM_SHARE_DIFFICULTY));
+        if (!node.stratum->Start(stratum_binds)) {
+            return InitError(Untranslated("Unable to bind any endpoint for the Stratum server. See debug log for details."));
+        }
+        validation_signals.RegisterValidationInterface(node.stratum.get());
+    }
+
     // ********************************************************* Step 8: start indexers
 
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
@@ -23,6 +23,7 @@ class ValidationSignals;
 
 static constexpr bool DEFAULT_CHECKPOINTS_ENABLED{true};
 static constexpr auto DEFAULT_MAX_TIP_AGE{24h};
+static constexpr bool DEFAULT_BACKGROUND_COINS_FLUSH{false};
 
 namespace kernel {
 
@@ -49,6 +50,14 @@ struct ChainstateManagerOpts {
     ValidationSignals* signals{nullptr};
     //! Number of script check worker threads. Zero means no parallel verification.
     int worker_threads_num{0};
+    //! Number of RandomX verification worker threads for batches of new headers. Zero means none.
+    int randomx_verify_threads_num{0};
+    //! Number of threads reading the coins spent by a block before it is connected. Zero means no prefetching.
+    int coins_prefetch_threads_num{0};
+    //! Maximum number of blocks connected at once during initial block download while their script checks are run. One or less means the checks of each block are waited for.
+    int script_check_pipeline_blocks{0};
+    //! Whether the coins cache is written to disk from a background thread when it is flushed because it is full or periodically.
+    bool background_coins_flush{DEFAULT_BACKGROUND_COINS_FLUSH};
     size_t script_execution_cache_bytes{DEFAULT_SCRIPT_EXECUTION_CACHE_BYTES};
     size_t signature_cache_bytes{DEFAULT_SIGNATURE_CACHE_BYTES};
 };
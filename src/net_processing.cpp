@@ -841,6 +841,16 @@ private:
      */
     std::map<uint256, std::pair<NodeId, bool>> mapBlockSource GUARDED_BY(cs_main);
 
+    /**
+     * Headers accepted with -fastcmpctblockrelay before their RandomX hash was
+     * verified, and the peers which sent them. The peer is disconnected if the
+     * hash fails when the block is processed, despite its noban permission.
+     */
+    std::map<uint256, NodeId> m_deferred_pow_sources GUARDED_BY(cs_main);
+
+    /** Addresses of peers which sent a block failing its deferred RandomX check. Their hashes are no longer deferred. */
+    std::set<CNetAddr> m_deferred_pow_offenders GUARDED_BY(cs_main);
+
     /** Number of peers with wtxid relay. */
     std::atomic<int> m_wtxid_relay_peers{0};
 
@@ -1087,6 +1097,13 @@ private:
     /** Process a new block. Perform any post-processing housekeeping */
     void ProcessBlock(CNode& node, const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked);
 
+    /**
+     * With -fastcmpctblockrelay, relay a reconstructed compact block whose header was accepted without verifying
+     * its RandomX hash, if it extends the tip. The hash is verified when the block is processed afterwards.
+     */
+    void MaybeRelayCompactBlockEarly(const std::shared_ptr<const CBlock>& block)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex);
+
     /** Process compact block txns  */
     void ProcessCompactBlockTxns(CNode& pfrom, Peer& peer, const BlockTransactions& block_transactions)
         EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex, !m_most_recent_block_mutex);
@@ -1795,6 +1812,7 @@ void PeerManagerImpl::FinalizeNode(const CNode& node)
         m_txrequest.DisconnectedPeer(nodeid);
     }
     if (m_txreconciliation) m_txreconciliation->ForgetPeer(nodeid);
+    std::erase_if(m_deferred_pow_sources, [&](const auto& entry) { return entry.second == nodeid; });
     m_num_preferred_download_peers -= state->fPreferredDownload;
     m_peers_downloading_from -= (!state->vBlocksInFlight.empty());
     assert(m_peers_downloading_from >= 0);
@@ -2312,6 +2330,21 @@ void PeerManagerImpl::BlockChecked(const CBlock& block, const BlockValidationSta
     }
     if (it != mapBlockSource.end())
         mapBlockSource.erase(it);
+
+    // A peer whose block fails the RandomX check it was allowed to defer is disconnected, as it would not be
+    // punished for it with noban permission, and its hashes are verified before relaying from then on.
+    const auto deferred{m_deferred_pow_sources.find(hash)};
+    if (deferred != m_deferred_pow_sources.end()) {
+        if (state.GetResult() == BlockValidationResult::BLOCK_INVALID_HEADER && state.GetRejectReason() == "high-hash") {
+            m_connman.ForNode(deferred->second, [&](CNode* node) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+                LogPrintf("Disconnecting peer=%d, which sent block %s failing its deferred RandomX check\n", node->GetId(), hash.ToString());
+                m_deferred_pow_offenders.insert(node->addr);
+                node->fDisconnect = true;
+                return true;
+            });
+        }
+        m_deferred_pow_sources.erase(deferred);
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2530,7 +2563,7 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
     } else {
         // Send block from disk
         std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-        if (!m_chainman.m_blockman.ReadBlockFromDisk(*pblockRead, block_pos)) {
+        if (!m_chainman.m_blockman.ReadBlockFromDisk(*pblockRead, block_pos, /*check_pow=*/false)) {
             if (WITH_LOCK(m_chainman.GetMutex(), return m_chainman.m_blockman.IsBlockPruned(*pindex))) {
                 LogPrint(BCLog::NET, "Block was pruned before it could be read, disconnect peer=%s\n", pfrom.GetId());
             } else {
@@ -3626,6 +3659,21 @@ void PeerManagerImpl::ProcessBlock(CNode& node, const std::shared_ptr<const CBlo
     }
 }
 
+void PeerManagerImpl::MaybeRelayCompactBlockEarly(const std::shared_ptr<const CBlock>& block)
+{
+    if (!m_opts.fast_cmpctblock_relay) return;
+
+    const CBlockIndex* pindex{nullptr};
+    {
+        LOCK(cs_main);
+        pindex = m_chainman.m_blockman.LookupBlockIndex(block->GetHash());
+        if (!pindex || (pindex->nStatus & (BLOCK_POW_VERIFIED | BLOCK_HAVE_DATA | BLOCK_FAILED_MASK))) return;
+        if (m_chainman.IsInitialBlockDownload() || pindex->pprev != m_chainman.ActiveChain().Tip()) return;
+    }
+    LogPrint(BCLog::NET, "Relaying compact block %s before verifying its RandomX hash\n", block->GetHash().ToString());
+    NewPoWValidBlock(pindex, block);
+}
+
 void PeerManagerImpl::ProcessCompactBlockTxns(CNode& pfrom, Peer& peer, const BlockTransactions& block_transactions)
 {
     std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
@@ -3655,7 +3703,8 @@ void PeerManagerImpl::ProcessCompactBlockTxns(CNode& pfrom, Peer& peer, const Bl
         }
 
         PartiallyDownloadedBlock& partialBlock = *range_flight.first->second.second->partialBlock;
-        ReadStatus status = partialBlock.FillBlock(*pblock, block_transactions.txn);
+        // With -fastcmpctblockrelay, the RandomX hash is not verified until the block is processed, after relaying it
+        ReadStatus status = partialBlock.FillBlock(*pblock, block_transactions.txn, /*check_pow=*/!m_opts.fast_cmpctblock_relay);
         if (status == READ_STATUS_INVALID) {
             RemoveBlockRequest(block_transactions.blockhash, pfrom.GetId()); // Reset in-flight state in case Misbehaving does not result in a disconnect
             Misbehaving(peer, "invalid compact block/non-matching block transactions");
@@ -3707,6 +3756,7 @@ void PeerManagerImpl::ProcessCompactBlockTxns(CNode& pfrom, Peer& peer, const Bl
         // disk-space attacks), but this should be safe due to the
         // protections in the compact block handler -- see related comment
         // in compact block optimistic reconstruction handling.
+        MaybeRelayCompactBlockEarly(pblock);
         ProcessBlock(pfrom, pblock, /*force_processing=*/true, /*min_pow_checked=*/true);
     }
     return;
@@ -4434,7 +4484,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
 
         if (!block_pos.IsNull()) {
             CBlock block;
-            const bool ret{m_chainman.m_blockman.ReadBlockFromDisk(block, block_pos)};
+            const bool ret{m_chainman.m_blockman.ReadBlockFromDisk(block, block_pos, /*check_pow=*/false)};
             // If height is above MAX_BLOCKTXN_DEPTH then this block cannot get
             // pruned after we release cs_main above, so this read should never fail.
             assert(ret);
@@ -4739,6 +4789,10 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         vRecv >> cmpctblock;
 
         bool received_new_header = false;
+        // With -fastcmpctblockrelay, a new header extending the tip from a peer with noban permission is accepted
+        // without verifying its RandomX hash, so that the block can be relayed once reconstructed. The hash is
+        // verified when the block is accepted, and the header does not become the best header before.
+        bool defer_pow = false;
         const auto blockhash = cmpctblock.header.GetHash();
 
         {
@@ -4759,12 +4813,15 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
 
         if (!m_chainman.m_blockman.LookupBlockIndex(blockhash)) {
             received_new_header = true;
+            defer_pow = m_opts.fast_cmpctblock_relay && pfrom.HasPermission(NetPermissionFlags::NoBan) &&
+                        !m_deferred_pow_offenders.count(pfrom.addr) &&
+                        !m_chainman.IsInitialBlockDownload() && prev_block == m_chainman.ActiveChain().Tip();
         }
         }
 
         const CBlockIndex *pindex = nullptr;
         BlockValidationState state;
-        if (!m_chainman.ProcessNewBlockHeaders({cmpctblock.header}, /*min_pow_checked=*/true, state, &pindex)) {
+        if (!m_chainman.ProcessNewBlockHeaders({cmpctblock.header}, /*min_pow_checked=*/true, state, &pindex, defer_pow)) {
             if (state.IsInvalid()) {
                 MaybePunishNodeForBlock(pfrom.GetId(), state, /*via_compact_block=*/true, "invalid header via cmpctblock");
                 return;
@@ -4792,6 +4849,9 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         // If AcceptBlockHeader returned true, it set pindex
         assert(pindex);
         UpdateBlockAvailability(pfrom.GetId(), pindex->GetBlockHash());
+        if (defer_pow && !(pindex->nStatus & BLOCK_POW_VERIFIED)) {
+            m_deferred_pow_sources.emplace(blockhash, pfrom.GetId());
+        }
 
         CNodeState *nodestate = State(pfrom.GetId());
 
@@ -4910,7 +4970,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                     return;
                 }
                 std::vector<CTransactionRef> dummy;
-                status = tempBlock.FillBlock(*pblock, dummy);
+                status = tempBlock.FillBlock(*pblock, dummy, /*check_pow=*/!m_opts.fast_cmpctblock_relay);
                 if (status == READ_STATUS_OK) {
                     fBlockReconstructed = true;
                 }
@@ -4961,6 +5021,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             // we have a chain with at least the minimum chain work), and we ignore
             // compact blocks with less work than our tip, it is safe to treat
             // reconstructed compact blocks as having been requested.
+            MaybeRelayCompactBlockEarly(pblock);
             ProcessBlock(pfrom, pblock, /*force_processing=*/true, /*min_pow_checked=*/true);
             LOCK(cs_main); // hold cs_main for CBlockIndex::IsValid()
             if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS)) {
@@ -6052,7 +6113,7 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                         PushMessage(*pto, std::move(cached_cmpctblock_msg.value()));
                     } else {
                         CBlock block;
-                        const bool ret{m_chainman.m_blockman.ReadBlockFromDisk(block, *pBestIndex)};
+                        const bool ret{m_chainman.m_blockman.ReadBlockFromDisk(block, *pBestIndex, /*check_pow=*/false)};
                         assert(ret);
                         CBlockHeaderAndShortTxIDs cmpctblock{block, m_rng.rand64()};
                         MakeAndPushMessage(*pto, NetMsgType::CMPCTBLOCK, cmpctblock);
@@ -31,6 +31,8 @@ static const bool DEFAULT_PEERBLOOMFILTERS = false;
 static const bool DEFAULT_PEERBLOCKFILTERS = false;
 /** Maximum number of outstanding CMPCTBLOCK requests for the same block. */
 static const unsigned int MAX_CMPCTBLOCKS_INFLIGHT_PER_BLOCK = 3;
+/** Default for -fastcmpctblockrelay, relaying compact blocks at the tip before their RandomX hash is verified. */
+static constexpr bool DEFAULT_FAST_CMPCTBLOCK_RELAY{false};
 
 struct CNodeStateStats {
     int nSyncHeight = -1;
@@ -68,6 +70,9 @@ public:
         uint32_t max_extra_txs{DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN};
         //! Whether all P2P messages are captured to disk
         bool capture_messages{false};
+        //! Whether compact blocks extending the tip are relayed before their
+        //! RandomX hash is verified
+        bool fast_cmpctblock_relay{DEFAULT_FAST_CMPCTBLOCK_RELAY};
         //! Whether or not the internal RNG behaves deterministically (this is
         //! a test-only option).
         bool deterministic_rng{false};
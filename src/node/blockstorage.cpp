@@ -8,6 +8,8 @@
 
 #include <arith_uint256.h>
 #include <chain.h>
+#include <checkqueue.h>
+#include <common/system.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <dbwrapper.h>
@@ -35,9 +37,12 @@
 #include <util/fs.h>
 #include <util/signalinterrupt.h>
 #include <util/strencodings.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <chrono>
 #include <map>
 #include <ranges>
 #include <unordered_map>
@@ -53,6 +58,33 @@ static constexpr uint8_t DB_LAST_BLOCK{'l'};
 // BlockTreeDB::DB_TXINDEX{'t'}
 // BlockTreeDB::ReadFlag("txindex")
 
+/** Maximum number of threads checking proof of work commitments while loading the block index. */
+static constexpr int MAX_BLOCK_INDEX_CHECK_THREADS{15};
+/** Number of block index entries handed to the check queue at once. */
+static constexpr size_t BLOCK_INDEX_CHECK_BATCH{1024};
+
+/** Check of the RandomX commitment of a block index entry, run by a CCheckQueue. */
+class PowCommitmentCheck
+{
+private:
+    CBlockHeader m_header;
+    int m_height;
+    const Consensus::Params* m_consensus_params;
+
+public:
+    PowCommitmentCheck(const CBlockHeader& header, int height, const Consensus::Params& consensus_params)
+        : m_header{header}, m_height{height}, m_consensus_params{&consensus_params} {}
+
+    bool operator()() const
+    {
+        if (!CheckProofOfWorkRandomX(m_header, *m_consensus_params, POW_VERIFY_COMMITMENT_ONLY)) {
+            LogError("%s: CheckProofOfWork failed: height=%d hash=%s\n", __func__, m_height, m_header.GetHash().ToString());
+            return false;
+        }
+        return true;
+    }
+};
+
 bool BlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo& info)
 {
     return Read(std::make_pair(DB_BLOCK_FILES, nFile), info);
@@ -108,9 +140,19 @@ bool BlockTreeDB::ReadFlag(const std::string& name, bool& fValue)
 bool BlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, const util::SignalInterrupt& interrupt)
 {
     AssertLockHeld(::cs_main);
+    const auto time_start{SteadyClock::now()};
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // Proof of work commitments are checked by worker threads while the database is scanned, and the
+    // results joined below, before the block index is used.
+    const int worker_threads{std::clamp(GetNumCores() - 1, 0, MAX_BLOCK_INDEX_CHECK_THREADS)};
+    CCheckQueue<PowCommitmentCheck> check_queue{/*batch_size=*/128, worker_threads, "loadblkidx"};
+    CCheckQueueControl<PowCommitmentCheck> control{&check_queue};
+    std::vector<PowCommitmentCheck> checks;
+    checks.reserve(BLOCK_INDEX_CHECK_BATCH);
+    size_t num_entries{0};
+
     // Load m_block_index
     while (pcursor->Valid()) {
         if (interrupt) return false;
@@ -135,10 +177,12 @@ bool BlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, s
 
                 pindexNew->hashRandomX    = diskindex.hashRandomX;
 
-                if (!CheckProofOfWorkRandomX(pindexNew->GetBlockHeader(), consensusParams, POW_VERIFY_COMMITMENT_ONLY)) {
-                    LogError("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-                    return false;
+                checks.emplace_back(pindexNew->GetBlockHeader(), pindexNew->nHeight, consensusParams);
+                if (checks.size() == BLOCK_INDEX_CHECK_BATCH) {
+                    control.Add(std::move(checks));
+                    checks.clear();
                 }
+                ++num_entries;
 
                 pcursor->Next();
             } else {
@@ -149,6 +193,17 @@ bool BlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, s
             break;
         }
     }
+    control.Add(std::move(checks));
+
+    const auto time_scanned{SteadyClock::now()};
+    if (!control.Wait()) {
+        return false;
+    }
+    const auto time_checked{SteadyClock::now()};
+    LogInfo("Loaded %u block index entries in %dms (scan %dms, waiting for proof of work checks %dms, %d threads)\n",
+            num_entries, Ticks<std::chrono::milliseconds>(time_checked - time_start),
+            Ticks<std::chrono::milliseconds>(time_scanned - time_start),
+            Ticks<std::chrono::milliseconds>(time_checked - time_scanned), worker_threads + 1);
 
     return true;
 }
@@ -1038,7 +1093,7 @@ bool BlockManager::WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValid
     return true;
 }
 
-bool BlockManager::ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) const
+bool BlockManager::ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, bool check_pow) const
 {
     block.SetNull();
 
@@ -1058,7 +1113,7 @@ bool BlockManager::ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) cons
     }
 
     // Check the header
-    if (!CheckProofOfWorkRandomX(block.GetBlockHeader(), GetConsensus(), POW_VERIFY_COMMITMENT_ONLY)) {
+    if (check_pow && !CheckProofOfWorkRandomX(block.GetBlockHeader(), GetConsensus(), POW_VERIFY_COMMITMENT_ONLY)) {
         LogError("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
         return false;
     }
@@ -1072,11 +1127,11 @@ bool BlockManager::ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) cons
     return true;
 }
 
-bool BlockManager::ReadBlockFromDisk(CBlock& block, const CBlockIndex& index) const
+bool BlockManager::ReadBlockFromDisk(CBlock& block, const CBlockIndex& index, bool check_pow) const
 {
     const FlatFilePos block_pos{WITH_LOCK(cs_main, return index.GetBlockPos())};
 
-    if (!ReadBlockFromDisk(block, block_pos)) {
+    if (!ReadBlockFromDisk(block, block_pos, check_pow)) {
         return false;
     }
     if (block.GetHash() != index.GetBlockHash()) {
@@ -419,9 +419,15 @@ public:
      */
     void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune) const;
 
-    /** Functions for disk access for blocks */
-    bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) const;
-    bool ReadBlockFromDisk(CBlock& block, const CBlockIndex& index) const;
+    /**
+     * Functions for disk access for blocks.
+     *
+     * Blocks are only stored after being validated, so callers which trust the block files may set
+     * check_pow=false to skip re-checking the RandomX commitment of the header, leaving only I/O and
+     * deserialization. Reading by index still checks that the block hash matches the index.
+     */
+    bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, bool check_pow = true) const;
+    bool ReadBlockFromDisk(CBlock& block, const CBlockIndex& index, bool check_pow = true) const;
     bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos) const;
 
     bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& index) const;
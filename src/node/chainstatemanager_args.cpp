@@ -10,6 +10,7 @@
 #include <logging.h>
 #include <node/coins_view_args.h>
 #include <node/database_args.h>
+#include <powverifyqueue.h>
 #include <tinyformat.h>
 #include <uint256.h>
 #include <util/result.h>
@@ -42,6 +43,8 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManage
 
     if (auto value{args.GetIntArg("-maxtipage")}) opts.max_tip_age = std::chrono::seconds{*value};
 
+    if (auto value{args.GetBoolArg("-backgroundcoinsflush")}) opts.background_coins_flush = *value;
+
     ReadDatabaseArgs(args, opts.block_tree_db);
     ReadDatabaseArgs(args, opts.coins_db);
     ReadCoinsViewArgs(args, opts.coins_view);
@@ -56,6 +59,23 @@ util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManage
     opts.worker_threads_num = std::clamp(script_threads - 1, 0, MAX_SCRIPTCHECK_THREADS);
     LogPrintf("Script verification uses %d additional threads\n", opts.worker_threads_num);
 
+    opts.script_check_pipeline_blocks = std::clamp<int64_t>(args.GetIntArg("-scriptcheckpipeline", DEFAULT_SCRIPT_CHECK_PIPELINE_BLOCKS), 0, MAX_SCRIPT_CHECK_PIPELINE_BLOCKS);
+
+    // Reads are latency bound rather than CPU bound, so this is not tied to the number of cores.
+    opts.coins_prefetch_threads_num = std::clamp<int64_t>(args.GetIntArg("-prefetchthreads", DEFAULT_COINS_PREFETCH_THREADS), 0, MAX_COINS_PREFETCH_THREADS);
+    LogPrintf("Coins prefetch uses %d threads\n", opts.coins_prefetch_threads_num);
+
+    if (opts.chainparams.GetConsensus().fPowRandomX) {
+        int randomx_threads = args.GetIntArg("-randomxverifythreads", DEFAULT_RANDOMX_VERIFY_THREADS);
+        if (randomx_threads <= 0) {
+            // -randomxverifythreads=0 means autodetect (number of cores)
+            // -randomxverifythreads=-n means "leave n cores free"
+            randomx_threads += GetNumCores();
+        }
+        opts.randomx_verify_threads_num = std::clamp(randomx_threads, 0, MAX_RANDOMX_VERIFY_THREADS);
+        LogPrintf("RandomX header verification uses %d threads\n", opts.randomx_verify_threads_num);
+    }
+
     if (auto max_size = args.GetIntArg("-maxsigcachesize")) {
         // 1. When supplied with a max_size of 0, both the signature cache and
         //    script execution cache create the minimum possible cache (2
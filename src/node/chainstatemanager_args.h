@@ -14,6 +14,14 @@ class ArgsManager;
 static constexpr int MAX_SCRIPTCHECK_THREADS{15};
 /** -par default (number of script-checking threads, 0 = auto) */
 static constexpr int DEFAULT_SCRIPTCHECK_THREADS{0};
+/** Maximum number of coins prefetch threads allowed */
+static constexpr int MAX_COINS_PREFETCH_THREADS{64};
+/** -prefetchthreads default (number of threads reading the coins spent by a block before connecting it, 0 = disabled) */
+static constexpr int DEFAULT_COINS_PREFETCH_THREADS{0};
+/** Maximum number of blocks whose script checks can be pipelined */
+static constexpr int MAX_SCRIPT_CHECK_PIPELINE_BLOCKS{32};
+/** -scriptcheckpipeline default (number of blocks whose script checks can be pipelined during initial block download, 0 = disabled) */
+static constexpr int DEFAULT_SCRIPT_CHECK_PIPELINE_BLOCKS{0};
 
 namespace node {
 [[nodiscard]] util::Result<void> ApplyArgsManOptions(const ArgsManager& args, ChainstateManager::Options& opts);
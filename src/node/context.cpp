@@ -13,7 +13,10 @@
 #include <net.h>
 #include <net_processing.h>
 #include <netgroup.h>
+#include <node/cpuminer.h>
 #include <node/kernel_notifications.h>
+#include <node/miner.h>
+#include <node/stratum.h>
 #include <node/warnings.h>
 #include <policy/fees.h>
 #include <scheduler.h>
@@ -39,7 +39,10 @@ class SignalInterrupt;
 }
 
 namespace node {
+class BlockTemplateCache;
+class CPUMiner;
 class KernelNotifications;
+class StratumServer;
 class Warnings;
 
 //! NodeContext struct containing references to chain state and connection
@@ -76,6 +79,12 @@ struct NodeContext {
     //! Reference to chain client that should used to load or create wallets
     //! opened by the gui.
     std::unique_ptr<interfaces::Mining> mining;
+    //! Block template kept up to date with the mempool, used by the Mining interface
+    std::unique_ptr<node::BlockTemplateCache> block_template_cache;
+    //! Background miner controlled by the setgenerate RPC
+    std::unique_ptr<node::CPUMiner> cpu_miner;
+    //! Mining job server enabled by -stratum
+    std::unique_ptr<node::StratumServer> stratum;
     interfaces::WalletLoader* wallet_loader{nullptr};
     std::unique_ptr<CScheduler> scheduler;
     std::function<void()> rpc_interruption_point = [] {};
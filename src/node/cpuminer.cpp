@@ -0,0 +1,114 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/cpuminer.h>
+
+#include <common/system.h>
+#include <consensus/merkle.h>
+#include <interfaces/mining.h>
+#include <logging.h>
+#include <node/miner.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <uint256.h>
+#include <util/thread.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+
+using namespace std::chrono_literals;
+
+namespace node {
+/** Time after which a template is replaced if the mempool has changed */
+static constexpr auto MINER_TEMPLATE_REFRESH{60s};
+
+int GetMiningThreads(int genproclimit)
+{
+    return genproclimit < 0 ? std::max(GetNumCores(), 1) : std::max(genproclimit, 1);
+}
+
+CPUMiner::CPUMiner(interfaces::Mining& mining, const Consensus::Params& consensus_params)
+    : m_mining{mining}, m_consensus_params{consensus_params}
+{
+}
+
+CPUMiner::~CPUMiner()
+{
+    Stop();
+}
+
+void CPUMiner::Start(const CScript& coinbase_script, int num_threads)
+{
+    LOCK(m_mutex);
+    StopLocked();
+    m_interrupt.reset();
+    m_hashes = 0;
+    m_start_time = SteadyClock::now();
+    m_threads = num_threads;
+    m_thread = std::thread(&util::TraceThread, "rxminer", [this, coinbase_script, num_threads] { Loop(coinbase_script, num_threads); });
+    LogInfo("CPU miner started with %d threads\n", num_threads);
+}
+
+void CPUMiner::Stop()
+{
+    LOCK(m_mutex);
+    StopLocked();
+}
+
+void CPUMiner::StopLocked()
+{
+    if (!m_thread.joinable()) return;
+    m_interrupt();
+    m_thread.join();
+    m_threads = 0;
+    LogInfo("CPU miner stopped\n");
+}
+
+double CPUMiner::GetHashRate() const
+{
+    if (m_threads == 0) return 0;
+    const double elapsed{Ticks<SecondsDouble>(SteadyClock::now() - m_start_time.load())};
+    return elapsed > 0 ? m_hashes / elapsed : 0;
+}
+
+void CPUMiner::Loop(CScript coinbase_script, int num_threads)
+{
+    while (!m_interrupt) {
+        // Do not mine on top of a stale tip
+        if (!m_mining.isTestChain() && m_mining.isInitialBlockDownload()) {
+            m_interrupt.sleep_for(1s);
+            continue;
+        }
+
+        std::unique_ptr<CBlockTemplate> block_template{m_mining.createNewBlock(coinbase_script)};
+        if (!block_template) {
+            LogError("%s: Couldn't create new block\n", __func__);
+            m_interrupt.sleep_for(1s);
+            continue;
+        }
+        CBlock& block{block_template->block};
+        block.hashMerkleRoot = BlockMerkleRoot(block);
+
+        const unsigned int transactions_updated{m_mining.getTransactionsUpdated()};
+        const auto template_time{SteadyClock::now()};
+        const auto interrupt{[&] {
+            return bool{m_interrupt} || m_mining.getTipHash() != block.hashPrevBlock ||
+                   (m_mining.getTransactionsUpdated() != transactions_updated && SteadyClock::now() - template_time > MINER_TEMPLATE_REFRESH);
+        }};
+
+        uint64_t max_tries{std::numeric_limits<uint64_t>::max()};
+        if (!MineRandomX(block, m_consensus_params, num_threads, max_tries, interrupt, &m_hashes)) {
+            continue;
+        }
+
+        const auto block_out{std::make_shared<const CBlock>(block)};
+        bool new_block{false};
+        if (m_mining.processNewBlock(block_out, &new_block) && new_block) {
+            LogInfo("CPU miner found block %s\n", block_out->GetHash().ToString());
+        }
+    }
+}
+} // namespace node
@@ -0,0 +1,76 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_CPUMINER_H
+#define BITCOIN_NODE_CPUMINER_H
+
+#include <script/script.h>
+#include <sync.h>
+#include <util/threadinterrupt.h>
+#include <util/time.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace Consensus {
+struct Params;
+} // namespace Consensus
+namespace interfaces {
+class Mining;
+} // namespace interfaces
+
+namespace node {
+/** Default for -genproclimit, the number of threads mining blocks for the generate RPCs. -1 means one thread per core. */
+static constexpr int DEFAULT_GENPROCLIMIT{-1};
+
+/** Number of mining threads for a -genproclimit value */
+int GetMiningThreads(int genproclimit);
+
+/**
+ * Background miner, controlled by the setgenerate RPC.
+ *
+ * Repeatedly creates a block template paying to a coinbase script, and mines it with MineRandomX() until a
+ * block is found, the tip changes, or the mempool has changed for a minute. Found blocks are processed
+ * like submitted blocks.
+ */
+class CPUMiner
+{
+private:
+    interfaces::Mining& m_mining;
+    const Consensus::Params& m_consensus_params;
+
+    Mutex m_mutex;
+    std::thread m_thread GUARDED_BY(m_mutex);
+    CThreadInterrupt m_interrupt;
+
+    std::atomic<int> m_threads{0};
+    std::atomic<uint64_t> m_hashes{0};
+    std::atomic<SteadyClock::time_point> m_start_time{};
+
+    void Loop(CScript coinbase_script, int num_threads);
+    void StopLocked() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    CPUMiner(interfaces::Mining& mining, const Consensus::Params& consensus_params);
+    ~CPUMiner();
+
+    CPUMiner(const CPUMiner&) = delete;
+    CPUMiner& operator=(const CPUMiner&) = delete;
+
+    /** Start mining with num_threads threads, restarting if already running. */
+    void Start(const CScript& coinbase_script, int num_threads) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Stop mining and wait for the mining threads to exit. */
+    void Stop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Number of mining threads, 0 if not running. */
+    int GetThreads() const { return m_threads.load(); }
+
+    /** Hashes per second since mining was started, 0 if not running. */
+    double GetHashRate() const;
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_CPUMINER_H
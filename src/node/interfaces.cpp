@@ -437,7 +437,7 @@ bool FillBlock(const CBlockIndex* index, const FoundBlock& block, UniqueLock<Rec
     if (block.m_next_block) FillBlock(active[index->nHeight] == index ? active[index->nHeight + 1] : nullptr, *block.m_next_block, lock, active, blockman);
     if (block.m_data) {
         REVERSE_LOCK(lock);
-        if (!blockman.ReadBlockFromDisk(*block.m_data, *index)) block.m_data->SetNull();
+        if (!blockman.ReadBlockFromDisk(*block.m_data, *index, /*check_pow=*/false)) block.m_data->SetNull();
     }
     block.found = true;
     return true;
@@ -911,6 +911,12 @@ public:
 
     std::unique_ptr<CBlockTemplate> createNewBlock(const CScript& script_pub_key, const BlockCreateOptions& options) override
     {
+        // The cached template reserves the default coinbase weight and sigops
+        if (m_node.block_template_cache && options.use_mempool &&
+            options.coinbase_max_additional_weight == BlockCreateOptions{}.coinbase_max_additional_weight &&
+            options.coinbase_output_max_additional_sigops == BlockCreateOptions{}.coinbase_output_max_additional_sigops) {
+            return m_node.block_template_cache->Get(script_pub_key);
+        }
         BlockAssembler::Options assemble_options{options};
         ApplyArgsManOptions(*Assert(m_node.args), assemble_options);
         return BlockAssembler{chainman().ActiveChainstate(), context()->mempool.get(), assemble_options}.CreateNewBlock(script_pub_key);
@@ -430,4 +430,177 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
         nDescendantsUpdated += UpdatePackagesForAdded(mempool, ancestors, mapModifiedTx);
     }
 }
+
+/** Maximum number of mempool updates kept between template requests */
+static constexpr size_t MAX_BLOCK_TEMPLATE_PENDING_UPDATES{10000};
+
+BlockTemplateCache::BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const BlockAssembler::Options& options, ValidationSignals* signals)
+    : m_chainman{chainman},
+      m_mempool{mempool},
+      m_options{ClampOptions(options)},
+      m_signals{signals}
+{
+}
+
+BlockTemplateCache::~BlockTemplateCache()
+{
+    if (m_signals) m_signals->UnregisterValidationInterface(this);
+}
+
+void BlockTemplateCache::TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence)
+{
+    LOCK(m_pending_mutex);
+    if (m_pending.size() >= MAX_BLOCK_TEMPLATE_PENDING_UPDATES) {
+        m_pending.clear();
+        m_pending_overflow = true;
+    }
+    m_pending.push_back({tx.info.m_tx->GetHash(), /*added=*/true, mempool_sequence});
+}
+
+void BlockTemplateCache::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
+{
+    LOCK(m_pending_mutex);
+    if (m_pending.size() >= MAX_BLOCK_TEMPLATE_PENDING_UPDATES) {
+        m_pending.clear();
+        m_pending_overflow = true;
+    }
+    m_pending.push_back({tx->GetHash(), /*added=*/false, mempool_sequence});
+}
+
+void BlockTemplateCache::Rebuild(const CBlockIndex* tip)
+{
+    AssertLockHeld(::cs_main);
+    AssertLockHeld(m_mempool.cs);
+
+    m_template.reset();
+    // The coinbase output is filled in for each request
+    m_template = BlockAssembler{m_chainman.ActiveChainstate(), &m_mempool, m_options}.CreateNewBlock(CScript{});
+    m_tip = tip;
+    m_lock_time_cutoff = tip->GetMedianTimePast();
+    m_in_block.clear();
+    m_block_weight = m_options.coinbase_max_additional_weight;
+    m_block_sigops_cost = m_options.coinbase_output_max_additional_sigops;
+    for (size_t i = 1; i < m_template->block.vtx.size(); ++i) {
+        m_in_block.insert(m_template->block.vtx[i]->GetHash());
+        m_block_weight += GetTransactionWeight(*m_template->block.vtx[i]);
+        m_block_sigops_cost += m_template->vTxSigOpsCost[i];
+    }
+    m_mempool_sequence = m_mempool.GetSequence();
+    m_transactions_updated = m_mempool.GetTransactionsUpdated();
+    m_build_time = NodeClock::now();
+    m_missed_transactions = false;
+}
+
+bool BlockTemplateCache::AppendTransaction(const Txid& txid, CAmount& fees)
+{
+    AssertLockHeld(::cs_main);
+    AssertLockHeld(m_mempool.cs);
+
+    const auto it{m_mempool.GetIter(txid)};
+    // Already removed again, or already in the template
+    if (!it || m_in_block.count(txid)) return true;
+    const CTxMemPoolEntry& entry{**it};
+    // Not enough fee to be selected unless a descendant pays for it
+    if (entry.GetModifiedFee() < m_options.blockMinFeeRate.GetFee(entry.GetTxSize())) return true;
+    if (!IsFinalTx(entry.GetTx(), m_tip->nHeight + 1, m_lock_time_cutoff)) return true;
+    for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) {
+        if (!m_in_block.count(parent.GetTx().GetHash())) return false;
+    }
+    // Same limits as BlockAssembler::TestPackage(), with the weight of the transaction rather than four times its
+    // virtual size, so that the template is filled up to -blockmaxweight
+    if (m_block_weight + entry.GetTxWeight() >= m_options.nBlockMaxWeight ||
+        m_block_sigops_cost + entry.GetSigOpCost() >= MAX_BLOCK_SIGOPS_COST) {
+        return false;
+    }
+
+    m_template->block.vtx.emplace_back(entry.GetSharedTx());
+    m_template->vTxFees.push_back(entry.GetFee());
+    m_template->vTxSigOpsCost.push_back(entry.GetSigOpCost());
+    m_in_block.insert(txid);
+    m_block_weight += entry.GetTxWeight();
+    m_block_sigops_cost += entry.GetSigOpCost();
+    fees += entry.GetFee();
+    return true;
+}
+
+bool BlockTemplateCache::Update(const std::vector<MempoolUpdate>& updates)
+{
+    AssertLockHeld(::cs_main);
+    AssertLockHeld(m_mempool.cs);
+
+    const size_t num_txs{m_template->block.vtx.size()};
+    CAmount fees{0};
+    for (const MempoolUpdate& update : updates) {
+        // Already accounted for when the template was built
+        if (update.mempool_sequence < m_mempool_sequence) continue;
+        m_mempool_sequence = update.mempool_sequence + 1;
+        ++m_transactions_updated;
+        if (!update.added) {
+            if (m_in_block.count(update.txid)) return false;
+        } else if (!AppendTransaction(update.txid, fees)) {
+            m_missed_transactions = true;
+        }
+    }
+
+    if (m_mempool.GetSequence() == m_mempool_sequence) {
+        // Every addition and removal has been accounted for, so any other update is a prioritisation
+        if (m_mempool.GetTransactionsUpdated() != m_transactions_updated) return false;
+    } else {
+        // Some updates have not been notified yet: make sure that the template has not lost any transaction
+        for (size_t i = 1; i < m_template->block.vtx.size(); ++i) {
+            if (!m_mempool.exists(GenTxid::Txid(m_template->block.vtx[i]->GetHash()))) return false;
+        }
+    }
+    if (m_missed_transactions && NodeClock::now() - m_build_time >= BLOCK_TEMPLATE_REBUILD_INTERVAL) return false;
+
+    if (m_template->block.vtx.size() != num_txs) {
+        CBlock& block{m_template->block};
+        CMutableTransaction coinbase{*block.vtx[0]};
+        coinbase.vout[0].nValue += fees;
+        const int commitpos{GetWitnessCommitmentIndex(block)};
+        if (commitpos != NO_WITNESS_COMMITMENT) coinbase.vout.erase(coinbase.vout.begin() + commitpos);
+        block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+        m_template->vchCoinbaseCommitment = m_chainman.GenerateCoinbaseCommitment(block, m_tip);
+        m_template->vTxFees[0] -= fees;
+        LogPrint(BCLog::BENCH, "BlockTemplateCache: appended %u txs, block weight: %u txs: %u\n",
+                 block.vtx.size() - num_txs, m_block_weight, block.vtx.size() - 1);
+    }
+    return true;
+}
+
+std::unique_ptr<CBlockTemplate> BlockTemplateCache::Get(const CScript& script_pub_key)
+{
+    LOCK2(::cs_main, m_mempool.cs);
+    const CBlockIndex* tip{m_chainman.ActiveChain().Tip()};
+    assert(tip != nullptr);
+
+    // Updates sent before the first template is built are accounted for by its mempool sequence
+    if (m_signals && !m_registered) {
+        m_signals->RegisterValidationInterface(this);
+        m_registered = true;
+    }
+
+    std::vector<MempoolUpdate> updates;
+    bool overflow;
+    {
+        LOCK(m_pending_mutex);
+        updates.swap(m_pending);
+        overflow = std::exchange(m_pending_overflow, false);
+    }
+    if (!m_template || m_tip != tip || overflow || !Update(updates)) {
+        Rebuild(tip);
+    }
+
+    BlockAssembler::m_last_block_num_txs = m_template->block.vtx.size() - 1;
+    BlockAssembler::m_last_block_weight = m_block_weight;
+
+    auto block_template{std::make_unique<CBlockTemplate>(*m_template)};
+    CBlock& block{block_template->block};
+    CMutableTransaction coinbase{*block.vtx[0]};
+    coinbase.vout[0].scriptPubKey = script_pub_key;
+    block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    block_template->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*block.vtx[0]);
+    UpdateTime(&block, m_chainman.GetConsensus(), tip);
+    return block_template;
+}
 } // namespace node
@@ -9,11 +9,17 @@
 #include <node/types.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
+#include <util/time.h>
+#include <validationinterface.h>
 
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <stdint.h>
+#include <unordered_set>
+#include <vector>
 
 #include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/indexed_by.hpp>
@@ -204,6 +210,78 @@ private:
     void SortForBlock(const CTxMemPool::setEntries& package, std::vector<CTxMemPool::txiter>& sortedEntries);
 };
 
+/** Minimum age of a cached block template before it is rebuilt for transactions which could not be appended */
+static constexpr std::chrono::seconds BLOCK_TEMPLATE_REBUILD_INTERVAL{5};
+
+/**
+ * Block template for the current tip, kept up to date with the mempool.
+ *
+ * The template is built by BlockAssembler when the tip changes. Transactions entering the
+ * mempool afterwards are appended to it when their parents are already in the template and
+ * they fit, so that most requests only copy the cached template. It is rebuilt when one of
+ * its transactions leaves the mempool, when a transaction is prioritised, and, at most every
+ * BLOCK_TEMPLATE_REBUILD_INTERVAL, when transactions could not be appended, e.g. because the
+ * block is full or their parents are missing. Appended transactions are not checked with
+ * TestBlockValidity().
+ *
+ * The cache only subscribes to mempool updates when the first template is requested, so that
+ * nodes which do not mine do not track them. It unregisters itself when destroyed, so it must
+ * outlive any validation interface callback already running, e.g. be destroyed only after the
+ * scheduler has been stopped.
+ */
+class BlockTemplateCache final : public CValidationInterface
+{
+public:
+    BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const BlockAssembler::Options& options, ValidationSignals* signals);
+    ~BlockTemplateCache();
+
+    /** Return a copy of the template with coinbase to script_pub_key and an updated time */
+    std::unique_ptr<CBlockTemplate> Get(const CScript& script_pub_key) EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+protected:
+    void TransactionAddedToMempool(const NewMempoolTransactionInfo& tx, uint64_t mempool_sequence) override EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) override EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+private:
+    //! Only the txid is kept, so that transactions which left the mempool are not kept alive
+    struct MempoolUpdate {
+        Txid txid;
+        bool added;
+        uint64_t mempool_sequence;
+    };
+
+    ChainstateManager& m_chainman;
+    const CTxMemPool& m_mempool;
+    const BlockAssembler::Options m_options;
+    ValidationSignals* const m_signals;
+    bool m_registered GUARDED_BY(::cs_main){false};
+
+    //! Mempool updates received since the last request
+    Mutex m_pending_mutex;
+    std::vector<MempoolUpdate> m_pending GUARDED_BY(m_pending_mutex);
+    //! Set when updates were dropped because nobody requested a template
+    bool m_pending_overflow GUARDED_BY(m_pending_mutex){false};
+
+    std::unique_ptr<CBlockTemplate> m_template GUARDED_BY(::cs_main);
+    const CBlockIndex* m_tip GUARDED_BY(::cs_main){nullptr};
+    std::unordered_set<Txid, SaltedTxidHasher> m_in_block GUARDED_BY(::cs_main);
+    uint64_t m_block_weight GUARDED_BY(::cs_main){0};
+    int64_t m_block_sigops_cost GUARDED_BY(::cs_main){0};
+    int64_t m_lock_time_cutoff GUARDED_BY(::cs_main){0};
+    //! Mempool sequence and transaction update count which the template accounts for
+    uint64_t m_mempool_sequence GUARDED_BY(::cs_main){0};
+    unsigned int m_transactions_updated GUARDED_BY(::cs_main){0};
+    NodeClock::time_point m_build_time GUARDED_BY(::cs_main){};
+    //! Whether a transaction could not be appended since the template was built
+    bool m_missed_transactions GUARDED_BY(::cs_main){false};
+
+    void Rebuild(const CBlockIndex* tip) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mempool.cs);
+    /** Apply mempool updates to the template. Returns false if it must be rebuilt. */
+    bool Update(const std::vector<MempoolUpdate>& updates) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mempool.cs);
+    /** Append a transaction. Returns false if it could belong in the template but was not appended. */
+    bool AppendTransaction(const Txid& txid, CAmount& fees) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mempool.cs);
+};
+
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
 /** Update an old GenerateCoinbaseCommitment from CreateNewBlock after the block txs have changed */
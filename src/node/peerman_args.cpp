@@ -22,6 +22,8 @@ void ApplyArgsManOptions(const ArgsManager& argsman, PeerManager::Options& optio
 
     if (auto value{argsman.GetBoolArg("-capturemessages")}) options.capture_messages = *value;
 
+    if (auto value{argsman.GetBoolArg("-fastcmpctblockrelay")}) options.fast_cmpctblock_relay = *value;
+
     if (auto value{argsman.GetBoolArg("-blocksonly")}) options.ignore_incoming_txs = *value;
 }
 
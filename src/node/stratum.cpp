@@ -0,0 +1,508 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/stratum.h>
+
+#include <consensus/merkle.h>
+#include <consensus/params.h>
+#include <crypto/common.h>
+#include <interfaces/mining.h>
+#include <logging.h>
+#include <netaddress.h>
+#include <node/miner.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <streams.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <univalue.h>
+#include <util/strencodings.h>
+#include <util/thread.h>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <stdexcept>
+
+using namespace std::chrono_literals;
+
+namespace node {
+/** Time after which a job is replaced if the mempool has changed */
+static constexpr auto STRATUM_JOB_REFRESH{60s};
+/** Interval between checks for a job refresh */
+static constexpr struct timeval STRATUM_REFRESH_INTERVAL{5, 0};
+/** Connections which send nothing for this long are closed. Miners send keepalived requests. */
+static constexpr struct timeval STRATUM_IDLE_TIMEOUT{300, 0};
+/** Maximum length of a request line */
+static constexpr size_t MAX_STRATUM_LINE_LENGTH{16 * 1024};
+/** Number of jobs on the current tip whose shares are accepted */
+static constexpr size_t MAX_STRATUM_JOBS{4};
+
+static UniValue StratumReply(const UniValue& id, const UniValue& result, const UniValue& error)
+{
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("id", id);
+    reply.pushKV("jsonrpc", "2.0");
+    reply.pushKV("error", error);
+    reply.pushKV("result", result);
+    return reply;
+}
+
+static UniValue StratumError(const std::string& message)
+{
+    UniValue error(UniValue::VOBJ);
+    error.pushKV("code", -1);
+    error.pushKV("message", message);
+    return error;
+}
+
+StratumServer::Connection::~Connection()
+{
+    bufferevent_free(bev);
+}
+
+StratumServer::StratumServer(interfaces::Mining& mining, const Consensus::Params& consensus_params, event_base* base, CScript coinbase_script, int64_t share_difficulty)
+    : m_mining{mining},
+      m_consensus_params{consensus_params},
+      m_base{base},
+      m_coinbase_script{std::move(coinbase_script)},
+      m_share_difficulty{share_difficulty}
+{
+}
+
+StratumServer::~StratumServer()
+{
+    Stop();
+}
+
+bool StratumServer::Start(const std::vector<CService>& binds)
+{
+    {
+        LOCK(m_mutex);
+        m_new_tip_event = event_new(m_base, -1, 0, [](evutil_socket_t, short, void* ctx) {
+            static_cast<StratumServer*>(ctx)->UpdateJob();
+        }, this);
+        m_results_event = event_new(m_base, -1, 0, [](evutil_socket_t, short, void* ctx) {
+            StratumServer& server{*static_cast<StratumServer*>(ctx)};
+            for (const auto& result : WITH_LOCK(server.m_mutex, return std::exchange(server.m_results, {}))) {
+                result();
+            }
+        }, this);
+    }
+    m_worker_thread = std::thread(&util::TraceThread, "stratum", [this] { WorkerThread(); });
+    m_refresh_event = event_new(m_base, -1, EV_PERSIST, [](evutil_socket_t, short, void* ctx) {
+        StratumServer& server{*static_cast<StratumServer*>(ctx)};
+        if (server.m_connections.empty()) return;
+        if (server.m_jobs.empty() ||
+            (server.m_mining.getTransactionsUpdated() != server.m_transactions_updated && SteadyClock::now() - server.m_job_time > STRATUM_JOB_REFRESH)) {
+            server.UpdateJob();
+        }
+    }, this);
+    event_add(m_refresh_event, &STRATUM_REFRESH_INTERVAL);
+    m_started = true;
+
+    for (const CService& bind : binds) {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        if (!bind.GetSockAddr(reinterpret_cast<struct sockaddr*>(&addr), &addr_len)) {
+            LogPrintf("Stratum: Error parsing address %s\n", bind.ToStringAddrPort());
+            continue;
+        }
+        evconnlistener* listener{evconnlistener_new_bind(m_base, AcceptCallback, this, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
+                                                          reinterpret_cast<struct sockaddr*>(&addr), addr_len)};
+        if (!listener) {
+            LogPrintf("Binding Stratum on address %s failed.\n", bind.ToStringAddrPort());
+            continue;
+        }
+        LogPrintf("Binding Stratum on address %s\n", bind.ToStringAddrPort());
+        if (!bind.IsLocal()) {
+            LogPrintf("WARNING: the Stratum server is not safe to expose to untrusted networks such as the public internet\n");
+        }
+        m_listeners.push_back(listener);
+    }
+    return !m_listeners.empty();
+}
+
+void StratumServer::Stop()
+{
+    if (!m_started) return;
+    m_started = false;
+
+    // Work which has not started is dropped, and no result is queued once the worker thread has stopped
+    WITH_LOCK(m_mutex, m_request_stop = true);
+    m_work_cv.notify_all();
+    m_worker_thread.join();
+
+    // Connections are closed on the event base thread, so that none of their callbacks is running
+    std::promise<void> closed;
+    std::pair<StratumServer*, std::promise<void>*> ctx{this, &closed};
+    event_base_once(m_base, -1, EV_TIMEOUT, [](evutil_socket_t, short, void* arg) {
+        auto& [server, closed]{*static_cast<std::pair<StratumServer*, std::promise<void>*>*>(arg)};
+        server->Close();
+        closed->set_value();
+    }, &ctx, nullptr);
+    closed.get_future().wait();
+}
+
+void StratumServer::Close()
+{
+    for (evconnlistener* listener : m_listeners) {
+        evconnlistener_free(listener);
+    }
+    m_listeners.clear();
+    m_connections.clear();
+    m_jobs.clear();
+    m_pending_logins.clear();
+    event_free(m_refresh_event);
+    m_refresh_event = nullptr;
+    LOCK(m_mutex);
+    event_free(m_new_tip_event);
+    m_new_tip_event = nullptr;
+    event_free(m_results_event);
+    m_results_event = nullptr;
+    m_work.clear();
+    m_results.clear();
+}
+
+void StratumServer::QueueWork(std::function<void()> work)
+{
+    WITH_LOCK(m_mutex, m_work.push_back(std::move(work)));
+    m_work_cv.notify_one();
+}
+
+void StratumServer::QueueResult(std::function<void()> result)
+{
+    LOCK(m_mutex);
+    if (!m_results_event) return;
+    m_results.push_back(std::move(result));
+    event_active(m_results_event, 0, 0);
+}
+
+void StratumServer::WorkerThread()
+{
+    while (true) {
+        std::function<void()> work;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_work_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_request_stop || !m_work.empty(); });
+            if (m_request_stop) return;
+            work = std::move(m_work.front());
+            m_work.pop_front();
+        }
+        work();
+    }
+}
+
+void StratumServer::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload && !m_mining.isTestChain()) return;
+    LOCK(m_mutex);
+    if (m_new_tip_event) event_active(m_new_tip_event, 0, 0);
+}
+
+void StratumServer::UpdateJob()
+{
+    // The tip may change while a template is created, in which case another one is created after it
+    if (m_job_requested) {
+        m_job_outdated = true;
+        return;
+    }
+    m_job_requested = true;
+    QueueWork([this] {
+        unsigned int transactions_updated{0};
+        std::shared_ptr<const CBlockTemplate> block_template;
+        // Do not mine on top of a stale tip
+        if ((m_mining.isTestChain() || !m_mining.isInitialBlockDownload()) && m_mining.getTipHash()) {
+            transactions_updated = m_mining.getTransactionsUpdated();
+            try {
+                block_template = m_mining.createNewBlock(m_coinbase_script);
+            } catch (const std::exception& e) {
+                LogError("Stratum: %s\n", e.what());
+            }
+            if (!block_template) LogError("Stratum: Couldn't create new block\n");
+        }
+        QueueResult([this, block_template = std::move(block_template), transactions_updated] {
+            AddJob(std::move(block_template), transactions_updated);
+        });
+    });
+}
+
+void StratumServer::AddJob(std::shared_ptr<const CBlockTemplate> block_template, unsigned int transactions_updated)
+{
+    m_job_requested = false;
+    if (std::exchange(m_job_outdated, false)) UpdateJob();
+
+    if (block_template) {
+        // Shares for jobs on a previous tip can no longer become blocks
+        if (!m_jobs.empty() && m_jobs.back().block_template->block.hashPrevBlock != block_template->block.hashPrevBlock) {
+            m_jobs.clear();
+        }
+        if (m_jobs.size() >= MAX_STRATUM_JOBS) {
+            m_jobs.erase(m_jobs.begin());
+        }
+        m_jobs.push_back(Job{strprintf("%x", m_next_job_id++), std::move(block_template), {}});
+        m_transactions_updated = transactions_updated;
+        m_job_time = SteadyClock::now();
+        LogDebug(BCLog::RPC, "Stratum: New job %s on block %s\n", m_jobs.back().id, m_jobs.back().block_template->block.hashPrevBlock.ToString());
+
+        for (const auto& [id, conn] : m_connections) {
+            if (!conn->logged_in) continue;
+            UniValue notification(UniValue::VOBJ);
+            notification.pushKV("jsonrpc", "2.0");
+            notification.pushKV("method", "job");
+            notification.pushKV("params", JobToJSON(m_jobs.back(), *conn));
+            Send(*conn, notification);
+        }
+    }
+
+    // Reply to the logins which were waiting for a job
+    for (const auto& [conn_id, id] : std::exchange(m_pending_logins, {})) {
+        const auto it{m_connections.find(conn_id)};
+        if (it == m_connections.end()) continue;
+        if (m_jobs.empty()) {
+            Send(*it->second, StratumReply(id, NullUniValue, StratumError("No job available")));
+        } else {
+            Send(*it->second, StratumReply(id, LoginResult(*it->second), NullUniValue));
+        }
+    }
+}
+
+CBlock StratumServer::MakeBlock(const Job& job, uint32_t extranonce) const
+{
+    CBlock block{job.block_template->block};
+    CMutableTransaction coinbase{*block.vtx[0]};
+    coinbase.vin[0].scriptSig << CScriptNum{extranonce};
+    block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    return block;
+}
+
+arith_uint256 StratumServer::GetShareTarget(uint32_t nBits) const
+{
+    arith_uint256 target;
+    target.SetCompact(nBits);
+    if (m_share_difficulty > 0) {
+        // Shares never need to be harder than the block
+        arith_uint256 share_target{UintToArith256(m_consensus_params.powLimit)};
+        share_target /= static_cast<uint64_t>(m_share_difficulty);
+        if (share_target > target) target = share_target;
+    }
+    return target;
+}
+
+UniValue StratumServer::JobToJSON(const Job& job, const Connection& conn) const
+{
+    const CBlockHeader header{MakeBlock(job, conn.extranonce).GetBlockHeader()};
+    DataStream ss{};
+    ss << header;
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("job_id", job.id);
+    result.pushKV("blob", HexStr(ss));
+    result.pushKV("target", ArithToUint256(GetShareTarget(header.nBits)).GetHex());
+    if (m_consensus_params.fPowRandomX) {
+        result.pushKV("seed_hash", HexStr(GetSeedHash(GetEpoch(header.nTime, m_consensus_params.nRandomXEpochDuration))));
+    }
+    return result;
+}
+
+void StratumServer::Send(Connection& conn, const UniValue& msg)
+{
+    const std::string str{msg.write() + "\n"};
+    bufferevent_write(conn.bev, str.data(), str.size());
+}
+
+void StratumServer::Disconnect(Connection& conn)
+{
+    LogDebug(BCLog::RPC, "Stratum: Connection %d from %s closed\n", conn.id, conn.addr);
+    m_connections.erase(conn.id);
+}
+
+std::optional<UniValue> StratumServer::Login(Connection& conn, const UniValue& id)
+{
+    if (m_jobs.empty()) {
+        m_pending_logins.emplace_back(conn.id, id);
+        if (!m_job_requested) UpdateJob();
+        return std::nullopt;
+    }
+    return LoginResult(conn);
+}
+
+UniValue StratumServer::LoginResult(Connection& conn)
+{
+    conn.logged_in = true;
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("id", strprintf("%x", conn.id));
+    result.pushKV("job", JobToJSON(m_jobs.back(), conn));
+    result.pushKV("status", "OK");
+    return result;
+}
+
+void StratumServer::Submit(Connection& conn, const UniValue& id, const UniValue& params)
+{
+    // Every request counts, so that a connection cannot make the node check shares at a higher rate
+    const auto current_time{SteadyClock::now()};
+    if (conn.share_token_bucket < MAX_STRATUM_SHARE_TOKEN_BUCKET) {
+        // Don't increment bucket if it's already full
+        const auto time_diff{std::max(current_time - conn.share_token_timestamp, SteadyClock::duration::zero())};
+        const double increment{Ticks<SecondsDouble>(time_diff) * MAX_STRATUM_SHARE_RATE_PER_SECOND};
+        conn.share_token_bucket = std::min<double>(conn.share_token_bucket + increment, MAX_STRATUM_SHARE_TOKEN_BUCKET);
+    }
+    conn.share_token_timestamp = current_time;
+    if (conn.share_token_bucket < 1.0) throw std::runtime_error("Too many shares");
+    conn.share_token_bucket -= 1.0;
+
+    const auto job{std::find_if(m_jobs.begin(), m_jobs.end(), [&](const Job& job) { return job.id == params.find_value("job_id").getValStr(); })};
+    if (job == m_jobs.end()) throw std::runtime_error("Stale job");
+
+    const std::string& nonce_hex{params.find_value("nonce").getValStr()};
+    const std::vector<unsigned char> nonce{ParseHex(nonce_hex)};
+    if (nonce.size() != 4 || nonce_hex.size() != 8) throw std::runtime_error("Invalid nonce");
+
+    CBlock block{MakeBlock(*job, conn.extranonce)};
+    block.nNonce = ReadLE32(nonce.data());
+
+    uint256 pow_hash;
+    if (m_consensus_params.fPowRandomX) {
+        // The result is hex encoded in byte order, as the RandomX API outputs it
+        const std::string& result_hex{params.find_value("result").getValStr()};
+        const std::vector<unsigned char> result{ParseHex(result_hex)};
+        if (result.size() != uint256::size() || result_hex.size() != 2 * uint256::size()) throw std::runtime_error("Invalid result");
+        block.hashRandomX = uint256{result};
+        pow_hash = GetRandomXCommitment(block);
+    } else {
+        pow_hash = block.GetHash();
+    }
+    if (UintToArith256(pow_hash) > GetShareTarget(block.nBits)) throw std::runtime_error("Low difficulty share");
+    // Checked before the RandomX hash is computed, so that replaying a share costs no hash
+    if (!job->shares.emplace(conn.extranonce, block.nNonce).second) throw std::runtime_error("Duplicate share");
+
+    arith_uint256 block_target;
+    block_target.SetCompact(block.nBits);
+    const bool solves_block{UintToArith256(pow_hash) <= block_target};
+
+    QueueWork([this, conn_id = conn.id, addr = conn.addr, id, block = std::move(block), solves_block] {
+        UniValue result;
+        UniValue error;
+        try {
+            if (m_consensus_params.fPowRandomX && CalculateRandomXHash(block, m_consensus_params) != block.hashRandomX) {
+                LogPrintf("Stratum: Connection %d from %s submitted an invalid RandomX hash\n", conn_id, addr);
+                throw std::runtime_error("Invalid result");
+            }
+            if (solves_block) {
+                const auto block_out{std::make_shared<const CBlock>(block)};
+                bool new_block{false};
+                if (!m_mining.processNewBlock(block_out, &new_block)) throw std::runtime_error("Block rejected");
+                if (new_block) LogInfo("Stratum: Connection %d from %s found block %s\n", conn_id, addr, block_out->GetHash().ToString());
+            }
+            result.setObject();
+            result.pushKV("status", "OK");
+        } catch (const std::exception& e) {
+            LogDebug(BCLog::RPC, "Stratum: Connection %d submit error: %s\n", conn_id, e.what());
+            error = StratumError(e.what());
+        }
+        QueueResult([this, conn_id, id, result = std::move(result), error = std::move(error)] {
+            const auto it{m_connections.find(conn_id)};
+            if (it != m_connections.end()) Send(*it->second, StratumReply(id, result, error));
+        });
+    });
+}
+
+void StratumServer::ProcessLine(Connection& conn, const std::string& line)
+{
+    UniValue request;
+    if (!request.read(line) || !request.isObject()) {
+        Send(conn, StratumReply(NullUniValue, NullUniValue, StratumError("Parse error")));
+        return;
+    }
+    const UniValue& id{request.find_value("id")};
+    const std::string& method{request.find_value("method").getValStr()};
+    const UniValue& params{request.find_value("params")};
+
+    // Replies to requests completed later are sent by them
+    std::optional<UniValue> result;
+    try {
+        if (method == "login") {
+            result = Login(conn, id);
+        } else if (method == "keepalived") {
+            result.emplace(UniValue::VOBJ);
+            result->pushKV("status", "KEEPALIVED");
+        } else if (!conn.logged_in) {
+            throw std::runtime_error("Unauthenticated");
+        } else if (method == "getjob") {
+            if (m_jobs.empty()) throw std::runtime_error("No job available");
+            result = JobToJSON(m_jobs.back(), conn);
+        } else if (method == "submit") {
+            if (!params.isObject()) throw std::runtime_error("Invalid params");
+            Submit(conn, id, params);
+        } else {
+            throw std::runtime_error("Method not found");
+        }
+    } catch (const std::exception& e) {
+        LogDebug(BCLog::RPC, "Stratum: Connection %d %s error: %s\n", conn.id, method, e.what());
+        Send(conn, StratumReply(id, NullUniValue, StratumError(e.what())));
+        return;
+    }
+    if (result) Send(conn, StratumReply(id, *result, NullUniValue));
+}
+
+void StratumServer::AcceptCallback(evconnlistener* listener, evutil_socket_t fd, sockaddr* addr, int socklen, void* ctx)
+{
+    StratumServer& server{*static_cast<StratumServer*>(ctx)};
+    CService peer;
+    peer.SetSockAddr(addr);
+    if (server.m_connections.size() >= MAX_STRATUM_CONNECTIONS) {
+        LogPrintf("Stratum: Rejecting connection from %s, too many connections\n", peer.ToStringAddrPort());
+        evutil_closesocket(fd);
+        return;
+    }
+
+    bufferevent* bev{bufferevent_socket_new(server.m_base, fd, BEV_OPT_CLOSE_ON_FREE)};
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    const uint64_t id{server.m_next_connection_id++};
+    auto conn{std::make_unique<Connection>(server, id, server.m_next_extranonce++, peer.ToStringAddrPort(), bev)};
+    bufferevent_setcb(bev, ReadCallback, nullptr, EventCallback, conn.get());
+    bufferevent_set_timeouts(bev, &STRATUM_IDLE_TIMEOUT, nullptr);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    LogDebug(BCLog::RPC, "Stratum: Connection %d from %s\n", id, conn->addr);
+    server.m_connections.emplace(id, std::move(conn));
+}
+
+void StratumServer::ReadCallback(bufferevent* bev, void* ctx)
+{
+    Connection& conn{*static_cast<Connection*>(ctx)};
+    evbuffer* input{bufferevent_get_input(bev)};
+    size_t n_read_out{0};
+    char* line;
+    while ((line = evbuffer_readln(input, &n_read_out, EVBUFFER_EOL_CRLF)) != nullptr) {
+        const std::string s(line, n_read_out);
+        free(line);
+        if (!s.empty()) conn.server.ProcessLine(conn, s);
+    }
+    // Everything left is an incomplete line
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE_LENGTH) {
+        LogPrintf("Stratum: Disconnecting %s because MAX_STRATUM_LINE_LENGTH exceeded\n", conn.addr);
+        conn.server.Disconnect(conn);
+    }
+}
+
+void StratumServer::EventCallback(bufferevent* bev, short what, void* ctx)
+{
+    Connection& conn{*static_cast<Connection*>(ctx)};
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR | BEV_EVENT_TIMEOUT)) {
+        conn.server.Disconnect(conn);
+    }
+}
+} // namespace node
@@ -0,0 +1,182 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_STRATUM_H
+#define BITCOIN_NODE_STRATUM_H
+
+#include <arith_uint256.h>
+#include <script/script.h>
+#include <sync.h>
+#include <univalue.h>
+#include <util/time.h>
+#include <validationinterface.h>
+
+#include <event2/util.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CService;
+struct bufferevent;
+struct event;
+struct event_base;
+struct evconnlistener;
+struct sockaddr;
+namespace Consensus {
+struct Params;
+} // namespace Consensus
+namespace interfaces {
+class Mining;
+} // namespace interfaces
+
+namespace node {
+struct CBlockTemplate;
+
+/** Default for -stratum */
+static constexpr bool DEFAULT_STRATUM{false};
+/** Default for -stratumport */
+static constexpr uint16_t DEFAULT_STRATUM_PORT{3333};
+/** Default for -stratumsharediff. 0 means shares must solve the block. */
+static constexpr int64_t DEFAULT_STRATUM_SHARE_DIFFICULTY{0};
+/** Maximum number of Stratum connections */
+static constexpr size_t MAX_STRATUM_CONNECTIONS{64};
+/** Average number of shares a Stratum connection may submit per second */
+static constexpr double MAX_STRATUM_SHARE_RATE_PER_SECOND{10};
+/** Number of shares a Stratum connection may submit in a burst */
+static constexpr double MAX_STRATUM_SHARE_TOKEN_BUCKET{20};
+
+/**
+ * Stratum-style mining job server, running on the event base of the HTTP server.
+ *
+ * Miners log in over a TCP connection with newline-delimited JSON requests, and are pushed a
+ * new job whenever a block template is created: when the tip changes, or when the mempool has
+ * changed and the current job is older than a minute. Each connection mines its own extranonce,
+ * appended to the coinbase scriptSig, so connections never repeat each other's work. The node
+ * builds the coinbase and merkle root, and a job holds the serialized header to hash, the share
+ * target and the RandomX seed hash. Submitted shares are checked against the share target, and
+ * solutions are processed like submitted blocks.
+ *
+ * Connections and jobs are only accessed from the event base thread. Templates are created,
+ * RandomX hashes of shares computed and blocks processed on a worker thread, so that they do
+ * not hold up the HTTP server sharing the event base.
+ */
+class StratumServer final : public CValidationInterface
+{
+public:
+    StratumServer(interfaces::Mining& mining, const Consensus::Params& consensus_params, event_base* base, CScript coinbase_script, int64_t share_difficulty);
+    ~StratumServer();
+
+    StratumServer(const StratumServer&) = delete;
+    StratumServer& operator=(const StratumServer&) = delete;
+
+    /** Listen for connections on the given addresses. Returns false if no address could be bound. */
+    bool Start(const std::vector<CService>& binds) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Stop listening and close all connections, waiting for the event base thread. */
+    void Stop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct Job {
+        std::string id;
+        std::shared_ptr<const CBlockTemplate> block_template;
+        //! Extranonces and nonces of the shares submitted for this job
+        std::set<std::pair<uint32_t, uint32_t>> shares;
+    };
+
+    struct Connection {
+        StratumServer& server;
+        uint64_t id;
+        uint32_t extranonce;
+        std::string addr;
+        bufferevent* bev;
+        bool logged_in{false};
+        //! Number of shares the connection may submit, see MAX_STRATUM_SHARE_RATE_PER_SECOND
+        double share_token_bucket{MAX_STRATUM_SHARE_TOKEN_BUCKET};
+        //! When share_token_bucket was last updated
+        SteadyClock::time_point share_token_timestamp{SteadyClock::now()};
+
+        ~Connection();
+    };
+
+    interfaces::Mining& m_mining;
+    const Consensus::Params& m_consensus_params;
+    event_base* const m_base;
+    const CScript m_coinbase_script;
+    const int64_t m_share_difficulty;
+
+    //! Protects the work and results exchanged with the worker thread, and the events which are activated from other threads
+    Mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::deque<std::function<void()>> m_work GUARDED_BY(m_mutex);
+    std::deque<std::function<void()>> m_results GUARDED_BY(m_mutex);
+    bool m_request_stop GUARDED_BY(m_mutex){false};
+    std::thread m_worker_thread;
+    event* m_new_tip_event GUARDED_BY(m_mutex){nullptr};
+    event* m_results_event GUARDED_BY(m_mutex){nullptr};
+    event* m_refresh_event{nullptr};
+    std::vector<evconnlistener*> m_listeners;
+    bool m_started{false};
+
+    std::map<uint64_t, std::unique_ptr<Connection>> m_connections;
+    uint64_t m_next_connection_id{1};
+    uint32_t m_next_extranonce{1};
+
+    //! Jobs built on the current tip, newest last
+    std::vector<Job> m_jobs;
+    uint64_t m_next_job_id{1};
+    unsigned int m_transactions_updated{0};
+    SteadyClock::time_point m_job_time{};
+    //! Whether a template is being created, and whether another one was requested meanwhile
+    bool m_job_requested{false};
+    bool m_job_outdated{false};
+    //! Connections and request ids of the logins waiting for a job
+    std::vector<std::pair<uint64_t, UniValue>> m_pending_logins;
+
+    void Close() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void Disconnect(Connection& conn);
+
+    /** Run work on the worker thread. */
+    void QueueWork(std::function<void()> work) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Run a result of the worker thread on the event base thread. */
+    void QueueResult(std::function<void()> result) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void WorkerThread() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Create a new template on the worker thread, for a job pushed to every logged in connection. */
+    void UpdateJob() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Handle a template created on the worker thread, and reply to the logins waiting for a job. */
+    void AddJob(std::shared_ptr<const CBlockTemplate> block_template, unsigned int transactions_updated) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** The block a connection mines for a job, with its extranonce in the coinbase. */
+    CBlock MakeBlock(const Job& job, uint32_t extranonce) const;
+    arith_uint256 GetShareTarget(uint32_t nBits) const;
+    UniValue JobToJSON(const Job& job, const Connection& conn) const;
+
+    void Send(Connection& conn, const UniValue& msg);
+    void ProcessLine(Connection& conn, const std::string& line) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Return the login result, or std::nullopt if it is sent once a job has been created. */
+    std::optional<UniValue> Login(Connection& conn, const UniValue& id) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    UniValue LoginResult(Connection& conn);
+    /** Check a share, whose result is sent once the worker thread has checked its RandomX hash. */
+    void Submit(Connection& conn, const UniValue& id, const UniValue& params) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    static void AcceptCallback(evconnlistener* listener, evutil_socket_t fd, sockaddr* addr, int socklen, void* ctx);
+    static void ReadCallback(bufferevent* bev, void* ctx);
+    static void EventCallback(bufferevent* bev, short what, void* ctx);
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_STRATUM_H
@@ -13,13 +13,55 @@
 #include <uint256.h>
 
 #include <common/args.h>
+#include <common/system.h>
+#include <crypto/common.h>
 #include <crypto/sha256.h>
+#include <cuckoocache.h>
 #include <randomx.h>
 #include <logging.h>
-#include <boost/compute/detail/lru_cache.hpp>
-
+#include <random.h>
+#include <streams.h>
+#include <util/fs.h>
+#include <util/fs_helpers.h>
+#include <util/hasher.h>
+#include <util/overflow.h>
+#include <util/strencodings.h>
+#include <util/string.h>
+#include <util/threadnames.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using util::SplitString;
+using util::TrimString;
+
+// Serializes the creation of light mode caches, so that an epoch's cache is only created once.
 static Mutex rx_caches_mutex;
 
+// Memory used by the cache of verified RandomX hashes, enough for about 30000 block headers.
+static constexpr size_t RANDOMX_HASH_CACHE_BYTES = 1 << 20;
+
+// Memory used by a light mode cache and by a VM scratchpad.
+static constexpr size_t RANDOMX_CACHE_BYTES = 256 << 20;
+static constexpr size_t RANDOMX_VM_BYTES = 2 << 20;
+
 typedef struct RandomXCacheWrapper {
     randomx_cache *cache = nullptr;
     RandomXCacheWrapper(randomx_cache *inCache) : cache(inCache) {}
@@ -39,33 +81,530 @@ typedef struct RandomXDatasetWrapper {
 using RandomXDatasetRef = std::shared_ptr<RandomXDatasetWrapper>;
 using RandomXCacheRef = std::shared_ptr<RandomXCacheWrapper>;
 
-typedef struct RandomXVMWrapper
+// Call a RandomX allocation function with large pages if enabled with -randomxlargepages, falling back to regular
+// pages if they cannot be obtained. If name is set, log which kind of pages were used.
+template <typename T, typename Fn>
+static T* AllocRandomX(const char* name, randomx_flags flags, Fn alloc)
 {
-    randomx_vm *vm = nullptr;
-    RandomXCacheRef cache = nullptr;
-    RandomXDatasetRef dataset = nullptr;
-    mutable Mutex m_hashing_mutex;
-    RandomXVMWrapper(randomx_vm *inVm, RandomXCacheRef inCacheRef, RandomXDatasetRef inDatasetRef) : vm(inVm), cache(inCacheRef), dataset(inDatasetRef) {}
-    ~RandomXVMWrapper() {
-        if (vm) {
-            randomx_destroy_vm(vm);
-            cache = nullptr;
-            dataset = nullptr;
+    if (gArgs.GetBoolArg("-randomxlargepages", DEFAULT_RANDOMX_LARGE_PAGES)) {
+        if (T* p = alloc(flags | RANDOMX_FLAG_LARGE_PAGES)) {
+            if (name) LogPrintf("RandomX %s allocated with large pages\n", name);
+            return p;
         }
+        if (name) LogPrintf("RandomX %s: large pages not available, using regular pages\n", name);
     }
-} RandomXVMWrapper;
+    return alloc(flags);
+}
 
-using RandomXVMRef = std::shared_ptr<RandomXVMWrapper>;
+static randomx_vm* CreateVM(randomx_flags flags, randomx_cache* pCache, randomx_dataset* pDataset)
+{
+    return AllocRandomX<randomx_vm>(nullptr, flags, [&](randomx_flags f) { return randomx_create_vm(f, pCache, pDataset); });
+}
 
-using LRURandomXCacheRef = std::shared_ptr< boost::compute::detail::lru_cache<int32_t, RandomXCacheRef>>;
-using LRURandomXVMRef = std::shared_ptr< boost::compute::detail::lru_cache<int32_t, RandomXVMRef>>;
-using LRURandomXDatasetRef = std::shared_ptr< boost::compute::detail::lru_cache<int32_t, RandomXDatasetRef>>;
+std::vector<int> ParseNumaCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    for (const std::string& range : SplitString(TrimString(list), ',')) {
+        const std::vector<std::string> bounds = SplitString(range, '-');
+        const auto first{ToIntegral<int>(bounds.front())};
+        const auto last{ToIntegral<int>(bounds.back())};
+        if (!first || !last) continue;
+        for (int cpu = *first; cpu <= *last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
 
-static LRURandomXCacheRef cache_rx_cache;
-static LRURandomXVMRef cache_rx_vm_light;
-static LRURandomXVMRef cache_rx_vm_fast;
-static LRURandomXDatasetRef cache_rx_dataset;
+// CPUs of each NUMA node, read from sysfs on Linux. Empty on other platforms or if the topology cannot be read.
+static const std::vector<std::vector<int>>& GetNumaNodes()
+{
+    static const std::vector<std::vector<int>> nodes = []() {
+        std::vector<std::vector<int>> result;
+#ifdef __linux__
+        for (int nNode = 0;; ++nNode) {
+            std::ifstream file{strprintf("/sys/devices/system/node/node%d/cpulist", nNode)};
+            std::string list;
+            if (!file || !std::getline(file, list)) break;
+            result.push_back(ParseNumaCpuList(list));
+        }
+#endif
+        return result;
+    }();
+    return nodes;
+}
+
+// Number of copies of the fast mode dataset: one per NUMA node with -randomxnuma, otherwise one.
+static size_t GetDatasetCopies()
+{
+    if (!gArgs.GetBoolArg("-randomxnuma", DEFAULT_RANDOMX_NUMA)) return 1;
+    return std::max<size_t>(GetNumaNodes().size(), 1);
+}
 
+// NUMA node of the CPU the calling thread is running on.
+static size_t GetCurrentNumaNode()
+{
+#ifdef __linux__
+    static const std::vector<size_t> cpu_nodes = []() {
+        std::vector<size_t> result;
+        const std::vector<std::vector<int>>& nodes = GetNumaNodes();
+        for (size_t nNode = 0; nNode < nodes.size(); ++nNode) {
+            for (int cpu : nodes[nNode]) {
+                if (size_t(cpu) >= result.size()) result.resize(cpu + 1);
+                result[cpu] = nNode;
+            }
+        }
+        return result;
+    }();
+    const int cpu = sched_getcpu();
+    if (cpu >= 0 && size_t(cpu) < cpu_nodes.size()) return cpu_nodes[cpu];
+#endif
+    return 0;
+}
+
+// Restrict the calling thread to the CPUs of a NUMA node, so that memory it touches first is allocated on the node.
+static void BindThreadToNumaNode(size_t nNode)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : GetNumaNodes().at(nNode)) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        LogPrintf("Warning: Could not bind thread to NUMA node %d\n", nNode);
+    }
+#endif
+}
+
+/** Bind the calling thread to a NUMA node for the lifetime of the object, then restore its previous CPUs. */
+class NumaNodeBinding
+{
+#ifdef __linux__
+    cpu_set_t m_saved;
+    bool m_restore{false};
+#endif
+
+public:
+    explicit NumaNodeBinding(size_t nNode)
+    {
+#ifdef __linux__
+        m_restore = sched_getaffinity(0, sizeof(m_saved), &m_saved) == 0;
+#endif
+        BindThreadToNumaNode(nNode);
+    }
+
+    ~NumaNodeBinding()
+    {
+#ifdef __linux__
+        if (m_restore) sched_setaffinity(0, sizeof(m_saved), &m_saved);
+#endif
+    }
+
+    NumaNodeBinding(const NumaNodeBinding&) = delete;
+    NumaNodeBinding& operator=(const NumaNodeBinding&) = delete;
+};
+
+/**
+ * Pool of VMs for one epoch. All VMs share the epoch's cache (light mode) or dataset (fast mode), which hold
+ * the bulk of the memory, so each VM only adds its own scratchpad. Callers check out an idle VM without taking
+ * a shared lock, and only wait when every VM in the pool is busy. A VM is created when its slot is first used.
+ *
+ * In fast mode there may be a copy of the dataset per NUMA node. Slots are spread across the copies, and callers
+ * prefer a VM using the copy of the node they are running on.
+ */
+class RandomXVMPool
+{
+    struct Slot {
+        std::atomic<bool> in_use{false};
+        randomx_vm* vm{nullptr};
+        size_t node{0};
+    };
+
+    const randomx_flags m_flags;
+    const RandomXCacheRef m_cache;
+    const std::vector<RandomXDatasetRef> m_datasets;
+    const size_t m_size;
+    const std::unique_ptr<Slot[]> m_slots;
+    std::atomic<size_t> m_next_slot{0};
+    std::atomic<size_t> m_num_vms{0};
+    std::atomic<int> m_waiters{0};
+    Mutex m_wait_mutex;
+    std::condition_variable m_wait_cv;
+
+    Slot* TryAcquire()
+    {
+        const size_t nStart = m_next_slot.fetch_add(1, std::memory_order_relaxed);
+        // With a dataset per NUMA node, first look for a VM on the caller's node, then for any VM.
+        const bool fNuma = m_datasets.size() > 1;
+        const size_t nNode = fNuma ? GetCurrentNumaNode() : 0;
+        for (int nPass = fNuma ? 0 : 1; nPass < 2; ++nPass) {
+            for (size_t i = 0; i < m_size; ++i) {
+                Slot& slot = m_slots[(nStart + i) % m_size];
+                if ((nPass == 1 || slot.node == nNode) && !slot.in_use.load(std::memory_order_relaxed) && !slot.in_use.exchange(true)) {
+                    return &slot;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    Slot* Acquire() EXCLUSIVE_LOCKS_REQUIRED(!m_wait_mutex)
+    {
+        if (Slot* slot = TryAcquire()) return slot;
+
+        // All VMs are busy. Register as a waiter before scanning again, so that a concurrent Release() either
+        // makes its slot visible to the scan or sees the waiter and notifies.
+        WAIT_LOCK(m_wait_mutex, lock);
+        ++m_waiters;
+        Slot* slot = nullptr;
+        m_wait_cv.wait(lock, [&] { return (slot = TryAcquire()) != nullptr; });
+        --m_waiters;
+        return slot;
+    }
+
+    void Release(Slot* slot) EXCLUSIVE_LOCKS_REQUIRED(!m_wait_mutex)
+    {
+        slot->in_use.store(false);
+        if (m_waiters.load() > 0) {
+            LOCK(m_wait_mutex);
+            m_wait_cv.notify_one();
+        }
+    }
+
+public:
+    RandomXVMPool(randomx_flags flags, RandomXCacheRef cache, std::vector<RandomXDatasetRef> datasets, size_t nSize)
+        : m_flags(flags), m_cache(std::move(cache)), m_datasets(std::move(datasets)), m_size(std::max({nSize, m_datasets.size(), size_t{1}})),
+          m_slots(std::make_unique<Slot[]>(m_size))
+    {
+        for (size_t i = 0; i < m_size; ++i) {
+            m_slots[i].node = m_datasets.empty() ? 0 : i % m_datasets.size();
+        }
+    }
+
+    ~RandomXVMPool()
+    {
+        for (size_t i = 0; i < m_size; ++i) {
+            if (m_slots[i].vm) randomx_destroy_vm(m_slots[i].vm);
+        }
+    }
+
+    RandomXVMPool(const RandomXVMPool&) = delete;
+    RandomXVMPool& operator=(const RandomXVMPool&) = delete;
+
+    /** Number of VMs created so far. */
+    size_t NumVMs() const { return m_num_vms.load(); }
+
+    /**
+     * Exclusive use of one VM of a pool. Blocks until a VM is available. Keeps the pool alive while held.
+     *
+     * With a dataset per NUMA node, the calling thread is bound to the node of the VM while the lease is held, so
+     * that the VM's scratchpad is allocated on the node and hashing reads the local copy of the dataset.
+     */
+    class Lease
+    {
+        const std::shared_ptr<RandomXVMPool> m_pool;
+        Slot* const m_slot;
+        std::optional<NumaNodeBinding> m_binding;
+
+    public:
+        explicit Lease(std::shared_ptr<RandomXVMPool> pool) : m_pool(std::move(pool)), m_slot(m_pool->Acquire())
+        {
+            if (m_pool->m_datasets.size() > 1) m_binding.emplace(m_slot->node);
+        }
+        ~Lease()
+        {
+            m_binding.reset();
+            m_pool->Release(m_slot);
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        /** Return the VM, creating it on first use of the slot. Returns nullptr if the VM could not be created. */
+        randomx_vm* get()
+        {
+            if (!m_slot->vm) {
+                m_slot->vm = CreateVM(m_pool->m_flags, m_pool->m_cache ? m_pool->m_cache->cache : nullptr,
+                                      m_pool->m_datasets.empty() ? nullptr : m_pool->m_datasets[m_slot->node]->dataset);
+                if (m_slot->vm) ++m_pool->m_num_vms;
+            }
+            return m_slot->vm;
+        }
+    };
+};
+
+using RandomXVMPoolRef = std::shared_ptr<RandomXVMPool>;
+
+/**
+ * Caches, datasets and VM pools of recently used epochs, limited by the number of epochs (-randomxvmcachesize) and
+ * by the memory they use (-randomxmaxmem). When over a limit, the least recently used epoch other than the epoch of
+ * the chain tip is dropped, starting with its dataset. The memory of dropped objects is freed once VMs using them
+ * are released.
+ *
+ * Proof of work is checked by kernel code which has no node context, so there is a single instance, like
+ * LockedPoolManager.
+ */
+class RandomXEpochManager
+{
+    struct Epoch {
+        RandomXCacheRef cache;
+        RandomXVMPoolRef light_pool;
+        RandomXDatasetRef dataset;
+        size_t dataset_copies{0};
+        RandomXVMPoolRef fast_pool;
+        uint64_t last_used{0};
+    };
+
+    const size_t m_max_epochs;
+    const size_t m_max_bytes;
+
+    mutable Mutex m_mutex;
+    std::map<uint32_t, Epoch> m_epochs GUARDED_BY(m_mutex);
+    uint64_t m_use_counter GUARDED_BY(m_mutex){0};
+    std::optional<uint32_t> m_tip_epoch GUARDED_BY(m_mutex);
+    //! Memory of the datasets being created, by epoch, see ReserveDataset()
+    std::map<uint32_t, size_t> m_reserved_bytes GUARDED_BY(m_mutex);
+
+    static size_t DatasetBytes() { return randomx_dataset_item_count() * RANDOMX_DATASET_ITEM_SIZE; }
+
+    Epoch* Find(uint32_t nEpoch) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        const auto it = m_epochs.find(nEpoch);
+        if (it == m_epochs.end()) return nullptr;
+        it->second.last_used = ++m_use_counter;
+        return &it->second;
+    }
+
+    Epoch& Insert(uint32_t nEpoch) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        Epoch& epoch = m_epochs[nEpoch];
+        epoch.last_used = ++m_use_counter;
+        return epoch;
+    }
+
+    RandomXMemoryInfo GetMemoryInfoLocked() const EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        RandomXMemoryInfo info;
+        info.epochs = m_epochs.size();
+        info.max_bytes = m_max_bytes;
+        for (const auto& [nEpoch, epoch] : m_epochs) {
+            if (epoch.cache) {
+                ++info.caches;
+                info.cache_bytes += RANDOMX_CACHE_BYTES;
+            }
+            if (epoch.dataset) {
+                info.datasets += epoch.dataset_copies;
+                info.dataset_bytes += epoch.dataset_copies * DatasetBytes();
+            }
+            for (const RandomXVMPoolRef& pool : {epoch.light_pool, epoch.fast_pool}) {
+                if (pool) info.vms += pool->NumVMs();
+            }
+        }
+        info.vm_bytes = info.vms * RANDOMX_VM_BYTES;
+        return info;
+    }
+
+    // Drop the least recently used data, other than of the tip epoch and of nEpoch, until nExtraBytes fit within
+    // -randomxmaxmem, along with the reserved datasets, and the number of epochs, including nEpoch, is within -randomxvmcachesize. Returns false if
+    // this is not possible.
+    bool Evict(uint32_t nEpoch, size_t nExtraBytes) EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        while (true) {
+            const size_t nEpochs = m_epochs.size() + (m_epochs.count(nEpoch) ? 0 : 1);
+            size_t nReservedBytes = 0;
+            for (const auto& [nReservedEpoch, nBytes] : m_reserved_bytes) {
+                nReservedBytes += nBytes;
+            }
+            const bool fOverBytes = m_max_bytes > 0 && GetMemoryInfoLocked().TotalBytes() + nReservedBytes + nExtraBytes > m_max_bytes;
+            if (nEpochs <= m_max_epochs && !fOverBytes) return true;
+
+            auto victim = m_epochs.end();
+            for (auto it = m_epochs.begin(); it != m_epochs.end(); ++it) {
+                if (it->first == nEpoch || it->first == m_tip_epoch) continue;
+                if (victim == m_epochs.end() || it->second.last_used < victim->second.last_used) victim = it;
+            }
+            if (victim == m_epochs.end()) return false;
+
+            if (nEpochs <= m_max_epochs && victim->second.dataset) {
+                victim->second.dataset.reset();
+                victim->second.dataset_copies = 0;
+                victim->second.fast_pool.reset();
+            } else {
+                m_epochs.erase(victim);
+            }
+        }
+    }
+
+public:
+    RandomXEpochManager(size_t nMaxEpochs, size_t nMaxBytes) : m_max_epochs(std::max<size_t>(nMaxEpochs, 1)), m_max_bytes(nMaxBytes) {}
+
+    RandomXEpochManager(const RandomXEpochManager&) = delete;
+    RandomXEpochManager& operator=(const RandomXEpochManager&) = delete;
+
+    static RandomXEpochManager& Instance()
+    {
+        static RandomXEpochManager manager(gArgs.GetIntArg("-randomxvmcachesize", DEFAULT_RANDOMX_VM_CACHE_SIZE),
+                                           size_t(gArgs.GetIntArg("-randomxmaxmem", DEFAULT_RANDOMX_MAX_MEM)) << 20);
+        return manager;
+    }
+
+    /** Return the VM pool of an epoch, in fast mode if available, or nullptr if there is none. */
+    RandomXVMPoolRef GetPool(uint32_t nEpoch) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const Epoch* epoch = Find(nEpoch);
+        if (!epoch) return nullptr;
+        return epoch->fast_pool ? epoch->fast_pool : epoch->light_pool;
+    }
+
+    RandomXCacheRef GetCache(uint32_t nEpoch) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const Epoch* epoch = Find(nEpoch);
+        return epoch ? epoch->cache : nullptr;
+    }
+
+    RandomXDatasetRef GetDataset(uint32_t nEpoch) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const Epoch* epoch = Find(nEpoch);
+        return epoch ? epoch->dataset : nullptr;
+    }
+
+    /** Add the cache and light mode VM pool of an epoch. They are added even if over the memory limit, as they are required to verify blocks. */
+    void AddLight(uint32_t nEpoch, RandomXCacheRef cache, RandomXVMPoolRef pool) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const bool fNew = !m_epochs.count(nEpoch) || !m_epochs.at(nEpoch).cache;
+        if (!Evict(nEpoch, fNew ? RANDOMX_CACHE_BYTES : 0)) {
+            LogPrintf("Warning: RandomX memory use exceeds -randomxmaxmem\n");
+        }
+        Epoch& epoch = Insert(nEpoch);
+        epoch.cache = std::move(cache);
+        epoch.light_pool = std::move(pool);
+    }
+
+    /**
+     * Make room for nCopies datasets of an epoch, and reserve it until they are added by AddFast() or the reservation
+     * is released. Returns false if they would not fit within -randomxmaxmem, or if the datasets of the epoch are
+     * already being created.
+     */
+    bool ReserveDataset(uint32_t nEpoch, size_t nCopies) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_reserved_bytes.count(nEpoch)) return false;
+        const size_t nBytes = nCopies * DatasetBytes();
+        if (!Evict(nEpoch, nBytes)) return false;
+        m_reserved_bytes.emplace(nEpoch, nBytes);
+        return true;
+    }
+
+    /** Release the reservation of the datasets of an epoch, which could not be created. */
+    void ReleaseDataset(uint32_t nEpoch) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_reserved_bytes.erase(nEpoch);
+    }
+
+    /**
+     * Add the dataset and fast mode VM pool of an epoch, whose datasets are the given number of copies of dataset, and
+     * release its reservation. Returns false, without adding them, if they do not fit within the limits.
+     */
+    bool AddFast(uint32_t nEpoch, RandomXDatasetRef dataset, size_t nCopies, RandomXVMPoolRef pool) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_reserved_bytes.erase(nEpoch);
+        const auto it = m_epochs.find(nEpoch);
+        const size_t nPreviousCopies = it != m_epochs.end() && it->second.dataset ? it->second.dataset_copies : 0;
+        if (!Evict(nEpoch, nCopies > nPreviousCopies ? (nCopies - nPreviousCopies) * DatasetBytes() : 0)) return false;
+        Epoch& epoch = Insert(nEpoch);
+        epoch.dataset = std::move(dataset);
+        epoch.dataset_copies = nCopies;
+        epoch.fast_pool = std::move(pool);
+        return true;
+    }
+
+    /** Drop the light mode VM pools, keeping the caches, so that fast mode VM pools are created when next used. */
+    void ClearLightPools() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        for (auto& [nEpoch, epoch] : m_epochs) {
+            epoch.light_pool.reset();
+        }
+    }
+
+    /** Set the epoch of the chain tip, which is never dropped. */
+    void SetTipEpoch(uint32_t nEpoch) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        m_tip_epoch = nEpoch;
+    }
+
+    RandomXMemoryInfo GetMemoryInfo() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return GetMemoryInfoLocked();
+    }
+};
+
+
+
+/**
+ * Cache of block headers whose RandomX hash was verified, so that a header which is checked again, e.g. by
+ * AcceptBlockHeader and then CheckBlock, submitblock or TestBlockValidity, is only hashed once.
+ */
+class RandomXHashCache
+{
+    //! Entries are SHA256(nonce || 32 zero bytes || block hash || RandomX hash || epoch duration)
+    CSHA256 m_salted_hasher;
+    CuckooCache::cache<uint256, SignatureCacheHasher> m_set_valid;
+    std::shared_mutex m_mutex;
+
+public:
+    explicit RandomXHashCache(size_t nMaxBytes)
+    {
+        const uint256 nonce = GetRandHash();
+        static constexpr unsigned char PADDING[32] = {0};
+        m_salted_hasher.Write(nonce.begin(), 32);
+        m_salted_hasher.Write(PADDING, 32);
+
+        const auto [num_elems, approx_size_bytes] = m_set_valid.setup_bytes(nMaxBytes);
+        LogPrintf("Using %zu KiB for RandomX hash cache, able to store %zu elements\n", approx_size_bytes >> 10, num_elems);
+    }
+
+    RandomXHashCache(const RandomXHashCache&) = delete;
+    RandomXHashCache& operator=(const RandomXHashCache&) = delete;
+
+    static RandomXHashCache& Instance()
+    {
+        static RandomXHashCache cache(RANDOMX_HASH_CACHE_BYTES);
+        return cache;
+    }
+
+    uint256 ComputeEntry(const CBlockHeader& block, const Consensus::Params& params) const
+    {
+        // The block hash does not commit to the RandomX hash on chains other than RandomX ones, so add it
+        const uint256 hash = block.GetHash();
+        unsigned char duration[4];
+        WriteLE32(duration, params.nRandomXEpochDuration);
+        uint256 entry;
+        CSHA256(m_salted_hasher).Write(hash.begin(), 32).Write(block.hashRandomX.begin(), 32).Write(duration, 4).Finalize(entry.begin());
+        return entry;
+    }
+
+    bool Contains(const uint256& entry)
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_set_valid.contains(entry, /*erase=*/false);
+    }
+
+    void Insert(const uint256& entry)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_set_valid.insert(entry);
+    }
+};
 
 
 // !BITCOINCASH
@@ -433,78 +972,336 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
 }
 
 
-// Seed string contains an epoch integer and is sha256d hashed to derive the seed hash (RandomX key).
-static const char *RANDOMX_EPOCH_SEED_STRING = "Snailcoin/RandomX/Epoch/%d";
+// Number of dataset items initialized by a worker between progress updates.
+static constexpr unsigned long RANDOMX_DATASET_INIT_CHUNK_ITEMS = 1 << 16;
+
+void InitRandomXDatasetRanges(unsigned long nItems, int nThreads, const std::function<void(unsigned long, unsigned long)>& init, std::optional<size_t> nNode)
+{
+    if (nItems == 0) return;
+    const unsigned long nRanges = std::clamp<unsigned long>(nThreads, 1, nItems);
+    std::atomic<unsigned long> nItemsDone{0};
+
+    auto init_range = [&](unsigned long nStart, unsigned long nCount) {
+        while (nCount > 0) {
+            const unsigned long nChunk = std::min(nCount, RANDOMX_DATASET_INIT_CHUNK_ITEMS);
+            init(nStart, nChunk);
+            nStart += nChunk;
+            nCount -= nChunk;
+
+            const unsigned long nBefore = nItemsDone.fetch_add(nChunk);
+            const unsigned long nStep = (nBefore + nChunk) * 10 / nItems;
+            if (nBefore * 10 / nItems != nStep && nStep < 10) {
+                LogPrintf("Creating RandomX dataset: %d%%\n", nStep * 10);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(nRanges - 1);
+    unsigned long nStart = 0;
+    for (unsigned long i = 0; i < nRanges; ++i) {
+        const unsigned long nCount = nItems / nRanges + (i < nItems % nRanges ? 1 : 0);
+        if (i + 1 == nRanges) {
+            init_range(nStart, nCount);
+        } else {
+            workers.emplace_back([&init_range, i, nStart, nCount, nNode]() {
+                util::ThreadRename(strprintf("rxinit.%i", i));
+                if (nNode) BindThreadToNumaNode(*nNode);
+                init_range(nStart, nCount);
+            });
+        }
+        nStart += nCount;
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Initialize a dataset from a cache. If nNode is set, the calling thread should be bound to that NUMA node, so that
+// the dataset is local to the node.
+static void InitDataset(randomx_dataset* pDataset, randomx_cache* pCache, int nThreads, std::optional<size_t> nNode)
+{
+    InitRandomXDatasetRanges(randomx_dataset_item_count(), nThreads, [&](unsigned long nStart, unsigned long nCount) {
+        randomx_init_dataset(pDataset, pCache, nStart, nCount);
+    }, nNode);
+}
+
+// Number of threads to use for dataset initialization, from -randomxinitthreads (0 means one per core).
+static int GetDatasetInitThreads()
+{
+    int nThreads = gArgs.GetIntArg("-randomxinitthreads", DEFAULT_RANDOMX_INIT_THREADS);
+    if (nThreads <= 0) {
+        nThreads = GetNumCores();
+    }
+    return std::max(nThreads, 1);
+}
+
+// Dataset files are kept in this subdirectory of the data directory, see -randomxpersistdataset.
+static const char* RANDOMX_DATASET_DIR = "randomx";
+static constexpr uint32_t RANDOMX_DATASET_FILE_VERSION = 1;
+// The dataset checksum is the SHA256 of the SHA256 of each chunk of this many bytes.
+static constexpr size_t RANDOMX_DATASET_CHECKSUM_CHUNK = 64 << 20;
+
+fs::path GetRandomXDatasetPath(uint32_t nEpoch)
+{
+    return gArgs.GetDataDirNet() / RANDOMX_DATASET_DIR / fs::u8path(strprintf("dataset-%s.dat", GetSeedHash(nEpoch).GetHex()));
+}
+
+// Checksum of the dataset memory. Chunks are hashed in parallel, see -randomxinitthreads.
+static uint256 GetDatasetChecksum(const unsigned char* pData, size_t nSize, int nThreads)
+{
+    const size_t nChunks = (nSize + RANDOMX_DATASET_CHECKSUM_CHUNK - 1) / RANDOMX_DATASET_CHECKSUM_CHUNK;
+    std::vector<uint256> vChunkHashes(nChunks);
+    std::atomic<size_t> nNextChunk{0};
+
+    auto hash_chunks = [&]() {
+        for (size_t i = nNextChunk++; i < nChunks; i = nNextChunk++) {
+            const size_t nStart = i * RANDOMX_DATASET_CHECKSUM_CHUNK;
+            CSHA256().Write(pData + nStart, std::min(RANDOMX_DATASET_CHECKSUM_CHUNK, nSize - nStart)).Finalize(vChunkHashes[i].begin());
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < std::min<int>(nThreads, nChunks); ++i) {
+        workers.emplace_back([&hash_chunks, i]() {
+            util::ThreadRename(strprintf("rxcheck.%i", i));
+            hash_chunks();
+        });
+    }
+    hash_chunks();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    CSHA256 hasher;
+    for (const uint256& hash : vChunkHashes) {
+        hasher.Write(hash.begin(), hash.size());
+    }
+    uint256 checksum;
+    hasher.Finalize(checksum.begin());
+    return checksum;
+}
+
+bool ReadRandomXDataset(uint32_t nEpoch, Span<unsigned char> data, int nThreads)
+{
+    const fs::path path = GetRandomXDatasetPath(nEpoch);
+    AutoFile file{fsbridge::fopen(path, "rb")};
+    if (file.IsNull()) return false;
+
+    std::string strError;
+    try {
+        uint32_t nVersion, nFileEpoch;
+        uint64_t nFileSize;
+        uint256 seedHash, checksum;
+        file >> nVersion >> nFileEpoch >> seedHash >> nFileSize >> checksum;
+        if (nVersion != RANDOMX_DATASET_FILE_VERSION || nFileEpoch != nEpoch || seedHash != GetSeedHash(nEpoch) || nFileSize != data.size()) {
+            strError = strprintf("not created for epoch %d by this version", nEpoch);
+        } else {
+            file.read(MakeWritableByteSpan(data));
+            if (GetDatasetChecksum(data.data(), data.size(), nThreads) != checksum) {
+                strError = "checksum mismatch";
+            }
+        }
+    } catch (const std::exception& e) {
+        strError = e.what();
+    }
+    if (strError.empty()) return true;
+
+    // The file would be rejected again by the next run, so remove it
+    LogPrintf("Deleting RandomX dataset file %s: %s\n", fs::PathToString(path), strError);
+    file.fclose();
+    std::error_code ec;
+    fs::remove(path, ec);
+    return false;
+}
+
+// Whether name is that of a dataset file, see GetRandomXDatasetPath()
+static bool IsRandomXDatasetFileName(std::string_view name)
+{
+    constexpr std::string_view prefix{"dataset-"};
+    constexpr std::string_view suffix{".dat"};
+    return name.size() == prefix.size() + 2 * uint256::size() + suffix.size() && name.starts_with(prefix) && name.ends_with(suffix) &&
+           IsHex(name.substr(prefix.size(), 2 * uint256::size()));
+}
+
+bool WriteRandomXDataset(uint32_t nEpoch, Span<const unsigned char> data, int nThreads)
+{
+    const fs::path dir = gArgs.GetDataDirNet() / RANDOMX_DATASET_DIR;
+    const fs::path path = GetRandomXDatasetPath(nEpoch);
+    const fs::path path_tmp = fs::PathFromString(fs::PathToString(path) + ".new");
+
+    try {
+        TryCreateDirectories(dir);
+        AutoFile file{fsbridge::fopen(path_tmp, "wb")};
+        if (file.IsNull()) {
+            throw std::runtime_error("cannot open file");
+        }
+        file << RANDOMX_DATASET_FILE_VERSION << nEpoch << GetSeedHash(nEpoch) << uint64_t{data.size()} << GetDatasetChecksum(data.data(), data.size(), nThreads);
+        file.write(MakeByteSpan(data));
+        if (!file.Commit()) {
+            throw std::runtime_error("commit failed");
+        }
+        if (file.fclose() != 0) {
+            throw std::runtime_error("close failed");
+        }
+        if (!RenameOver(path_tmp, path)) {
+            throw std::runtime_error("rename failed");
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Error: Failed to write RandomX dataset file %s: %s\n", fs::PathToString(path), e.what());
+        std::error_code ec;
+        fs::remove(path_tmp, ec);
+        return false;
+    }
+
+    // Remove the dataset files of epochs other than the previous and next ones. Temporary files may be
+    // written concurrently for another epoch, and other files are not ours to delete.
+    const std::set<fs::path> keep{path, GetRandomXDatasetPath(nEpoch - 1), GetRandomXDatasetPath(nEpoch + 1)};
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        if (IsRandomXDatasetFileName(fs::PathToString(it->path().filename())) && fs::is_regular_file(it->path(), ec) && !keep.count(it->path())) {
+            fs::remove(it->path(), ec);
+        }
+    }
+    return true;
+}
+
+// Span of the memory of a dataset
+static Span<unsigned char> DatasetMemory(randomx_dataset* pDataset)
+{
+    return {static_cast<unsigned char*>(randomx_get_dataset_memory(pDataset)), randomx_dataset_item_count() * RANDOMX_DATASET_ITEM_SIZE};
+}
 
-// Epoch is Unix time stamp in seconds divided by epoch duration in seconds.
-uint32_t GetEpoch(uint32_t nTimestamp, uint32_t nDuration) {
-    return nTimestamp / nDuration;
+// Number of VMs per epoch, from -randomxvmpoolsize (0 means one per core).
+static size_t GetVMPoolSize()
+{
+    int nSize = gArgs.GetIntArg("-randomxvmpoolsize", DEFAULT_RANDOMX_VM_POOL_SIZE);
+    if (nSize <= 0) {
+        nSize = GetNumCores();
+    }
+    return std::max(nSize, 1);
 }
 
-// Compute seed hash (the RandomX key) for an epoch. Applies sha256d to the seed string.
-uint256 GetSeedHash(uint32_t nEpoch)
+// Return the dataset, which was created on node 0, followed by a copy for each other NUMA node with -randomxnuma.
+// Each copy is allocated and written by a thread bound to its node, so that its memory is local to the node. Returns an empty vector if a
+// copy could not be allocated.
+static std::vector<RandomXDatasetRef> CopyDatasetToNumaNodes(const RandomXDatasetRef& dataset, randomx_flags flags)
 {
-    std::string s = strprintf(RANDOMX_EPOCH_SEED_STRING, nEpoch);
-    uint256 h1, h2;
-    CSHA256().Write((const unsigned char*)s.data(), s.size()).Finalize(h1.begin());
-    CSHA256().Write(h1.begin(), 32).Finalize(h2.begin());
-    return h2;
+    const size_t nCopies = GetDatasetCopies();
+    std::vector<RandomXDatasetRef> datasets(nCopies);
+    datasets[0] = dataset;
+    if (nCopies == 1) return datasets;
+
+    const auto start{SteadyClock::now()};
+    const void* pSource = randomx_get_dataset_memory(dataset->dataset);
+    const size_t nSize = randomx_dataset_item_count() * RANDOMX_DATASET_ITEM_SIZE;
+    std::vector<std::thread> workers;
+    for (size_t nNode = 1; nNode < nCopies; ++nNode) {
+        workers.emplace_back([&, nNode]() {
+            util::ThreadRename(strprintf("rxnuma.%i", nNode));
+            BindThreadToNumaNode(nNode);
+            randomx_dataset* pDataset = AllocRandomX<randomx_dataset>(nullptr, flags, randomx_alloc_dataset);
+            if (pDataset == nullptr) return;
+            std::memcpy(randomx_get_dataset_memory(pDataset), pSource, nSize);
+            datasets[nNode] = std::make_shared<RandomXDatasetWrapper>(pDataset);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    if (std::any_of(datasets.begin(), datasets.end(), [](const RandomXDatasetRef& d) { return d == nullptr; })) {
+        LogPrintf("Error: randomx_alloc_dataset() failed\n");
+        return {};
+    }
+    LogPrintf("Copied RandomX dataset to %d NUMA nodes: %.2fs\n", nCopies, Ticks<SecondsDouble>(SteadyClock::now() - start));
+    return datasets;
 }
 
-// Create a VM in fast mode. Run this in a background thread as it can take a long time.
-// Can be optimized by using multiple threads to init the dataset.
+// Create a VM pool in fast mode. Run this in a background thread as it can take a long time.
+// The dataset is initialized using multiple threads, see -randomxinitthreads, or read from the
+// file written by a previous run, see -randomxpersistdataset.
 static void CreateFastVM(uint32_t nEpoch, RandomXCacheRef myCache)
 {
+    RandomXEpochManager& manager = RandomXEpochManager::Instance();
     randomx_flags flags = randomx_get_flags();
     flags |= RANDOMX_FLAG_FULL_MEM;
 
-    RandomXDatasetRef myDataset = nullptr;
-    if (cache_rx_dataset->contains(nEpoch)) {
-        myDataset = cache_rx_dataset->get(nEpoch).get();
-    } else {
-        randomx_dataset* pDataset = randomx_alloc_dataset(flags);
+    const size_t nCopies = GetDatasetCopies();
+    RandomXDatasetRef myDataset = manager.GetDataset(nEpoch);
+    bool fSave = false;
+    bool fReserved = false;
+    if (!myDataset) {
+        if (!manager.ReserveDataset(nEpoch, nCopies)) {
+            LogPrintf("Not creating RandomX dataset for epoch %d, as it is already being created or would exceed -randomxmaxmem\n", nEpoch);
+            return;
+        }
+        fReserved = true;
+
+        // With a copy per NUMA node, the original is the copy of node 0, so it is allocated and written there
+        std::optional<size_t> nNode;
+        std::optional<NumaNodeBinding> binding;
+        if (nCopies > 1) {
+            nNode = 0;
+            binding.emplace(*nNode);
+        }
+
+        randomx_dataset* pDataset = AllocRandomX<randomx_dataset>("dataset", flags, randomx_alloc_dataset);
         if (pDataset == nullptr) {
             LogPrintf("Error: randomx_alloc_dataset() failed\n");
+            manager.ReleaseDataset(nEpoch);
             return;
         }
 
         const auto start{SteadyClock::now()};
+        const int nThreads = GetDatasetInitThreads();
+        const bool fPersist = gArgs.GetBoolArg("-randomxpersistdataset", DEFAULT_RANDOMX_PERSIST_DATASET);
 
-        randomx_init_dataset(pDataset, myCache->cache, 0, randomx_dataset_item_count());
-        myDataset = std::make_shared<RandomXDatasetWrapper>(pDataset);
-        {
-            LOCK(rx_caches_mutex);
-            cache_rx_dataset->insert(nEpoch, myDataset);
+        const bool fLoaded = fPersist && ReadRandomXDataset(nEpoch, DatasetMemory(pDataset), nThreads);
+        if (!fLoaded) {
+            InitDataset(pDataset, myCache->cache, nThreads, nNode);
         }
+        myDataset = std::make_shared<RandomXDatasetWrapper>(pDataset);
+        binding.reset();
+
+        LogPrintf("%s RandomX dataset for epoch %d: %.2fs (%d threads)\n", fLoaded ? "Loaded" : "Created", nEpoch, Ticks<SecondsDouble>(SteadyClock::now() - start), nThreads);
 
-        LogPrintf("Created RandomX dataset: %.2fs\n", Ticks<SecondsDouble>(SteadyClock::now() - start));
+        // Write the dataset after the VMs using it are available, as this takes a while
+        if (fPersist && !fLoaded) {
+            fSave = true;
+        }
+    }
 
+    std::vector<RandomXDatasetRef> myDatasets = CopyDatasetToNumaNodes(myDataset, flags);
+    if (myDatasets.empty()) {
+        if (fReserved) manager.ReleaseDataset(nEpoch);
+        return;
     }
 
-    randomx_vm* myVM = nullptr;
-    myVM = randomx_create_vm(flags, NULL, myDataset.get()->dataset);
-    if (!myVM) {
+    RandomXVMPoolRef myPool = std::make_shared<RandomXVMPool>(flags, nullptr, std::move(myDatasets), GetVMPoolSize());
+    if (!RandomXVMPool::Lease(myPool).get()) {
         LogPrintf("Error: randomx_create_vm() failed\n");
+        if (fReserved) manager.ReleaseDataset(nEpoch);
         return;
     }
 
-    LOCK(rx_caches_mutex);
-    cache_rx_vm_fast->insert(nEpoch, std::make_shared<RandomXVMWrapper>(myVM, nullptr, myDataset));
+    if (!manager.AddFast(nEpoch, myDataset, nCopies, myPool)) {
+        LogPrintf("Not keeping RandomX dataset for epoch %d, as it would exceed -randomxmaxmem\n", nEpoch);
+        return;
+    }
+
+    if (fSave) {
+        const auto start{SteadyClock::now()};
+        if (WriteRandomXDataset(nEpoch, DatasetMemory(myDataset->dataset), GetDatasetInitThreads())) {
+            LogPrintf("Saved RandomX dataset for epoch %d: %.2fs\n", nEpoch, Ticks<SecondsDouble>(SteadyClock::now() - start));
+        }
+    }
 }
 
-// Get VM for a given epoch, creating and caching if necessary.
-static boost::optional<RandomXVMRef> GetVM(int32_t nEpoch)
+// Get VM pool for a given epoch, creating and caching if necessary.
+static RandomXVMPoolRef GetVM(uint32_t nEpoch)
 {
-    // Initialize caches once with desired size
-    static std::once_flag flag;
-    std::call_once(flag, []() {
-        int n = gArgs.GetIntArg("-randomxvmcachesize", DEFAULT_RANDOMX_VM_CACHE_SIZE);
-        cache_rx_cache = std::make_shared<boost::compute::detail::lru_cache<int32_t, RandomXCacheRef>>(n);
-        cache_rx_vm_light = std::make_shared<boost::compute::detail::lru_cache<int32_t, RandomXVMRef>>(n);
-        cache_rx_vm_fast = std::make_shared<boost::compute::detail::lru_cache<int32_t, RandomXVMRef>>(n);
-        cache_rx_dataset = std::make_shared<boost::compute::detail::lru_cache<int32_t, RandomXDatasetRef>>(n);
-        LogPrintf("Created RandomX caches of size %d\n", n);
-    });
+    RandomXEpochManager& manager = RandomXEpochManager::Instance();
 
     uint256 seedHash = GetSeedHash(nEpoch);
 
@@ -513,8 +1310,7 @@ static boost::optional<RandomXVMRef> GetVM(int32_t nEpoch)
         static std::once_flag allowFlag;
         std::call_once(allowFlag, []() {
             if (gArgs.GetBoolArg("-randomxfastmode", DEFAULT_RANDOMX_FAST_MODE)) {
-                LOCK(rx_caches_mutex);
-                cache_rx_vm_light->clear();
+                RandomXEpochManager::Instance().ClearLightPools();
                 LogPrintf("RandomX fast mode enabled\n");
             }
         });
@@ -522,42 +1318,40 @@ static boost::optional<RandomXVMRef> GetVM(int32_t nEpoch)
 
 
     // If VM in fast mode is cached, return it first, due to faster performance than light mode
-    if (cache_rx_vm_fast->contains(nEpoch)) {
-        return cache_rx_vm_fast->get(nEpoch);
-    } else if (cache_rx_vm_light->contains(nEpoch)) {
-        return cache_rx_vm_light->get(nEpoch);
+    if (RandomXVMPoolRef pool = manager.GetPool(nEpoch)) {
+        return pool;
     }
 
-    // No VM exists, so create light mode VM first and create fast mode VM in background thread.
+    // No VM exists, so create light mode VM pool first and create fast mode VM pool in background thread.
     randomx_flags flags = randomx_get_flags();
 
     LOCK(rx_caches_mutex);
 
+    // Another thread may have created the VM pool since the check above
+    if (RandomXVMPoolRef pool = manager.GetPool(nEpoch)) {
+        return pool;
+    }
+
     // Create randomx cache if requred
-    RandomXCacheRef myCache = nullptr;
-    if (cache_rx_cache->contains(nEpoch)) {
-        myCache = cache_rx_cache->get(nEpoch).get();
-    } else {
-        randomx_cache* pCache = randomx_alloc_cache(flags);
+    RandomXCacheRef myCache = manager.GetCache(nEpoch);
+    if (!myCache) {
+        randomx_cache* pCache = AllocRandomX<randomx_cache>("cache", flags, randomx_alloc_cache);
         if (!pCache) {
             LogPrintf("Error: randomx_alloc_cache() failed\n");
-            return boost::none;
+            return nullptr;
         }
         randomx_init_cache(pCache, seedHash.data(), seedHash.size());
         myCache = std::make_shared<RandomXCacheWrapper>(pCache);
-        cache_rx_cache->insert(nEpoch, myCache); // store in LRU cache
     }
 
-    // Create light VM using randomx cache
-    randomx_vm* myVM = nullptr;
-    myVM = randomx_create_vm(flags, myCache->cache, NULL);
-    if (!myVM) {
+    // Create light VM pool using randomx cache. The first VM is created up front to report failure early.
+    RandomXVMPoolRef vmRef = std::make_shared<RandomXVMPool>(flags, myCache, std::vector<RandomXDatasetRef>{}, GetVMPoolSize());
+    if (!RandomXVMPool::Lease(vmRef).get()) {
         LogPrintf("Error: randomx_create_vm() failed\n");
-        return boost::none;
+        return nullptr;
     }
 
-    RandomXVMRef vmRef = std::make_shared<RandomXVMWrapper>(myVM, myCache, nullptr);
-    cache_rx_vm_light->insert(nEpoch, vmRef);
+    manager.AddLight(nEpoch, myCache, vmRef);
 
     // When IBD has finished, allow background thread to create fast mode VM (can be disabled to reduce memory usage)
     if (g_isIBDFinished && gArgs.GetBoolArg("-randomxfastmode", DEFAULT_RANDOMX_FAST_MODE)) {
@@ -568,16 +1362,72 @@ static boost::optional<RandomXVMRef> GetVM(int32_t nEpoch)
     return vmRef;
 }
 
-// Compute randomx commitment from block header. If inHash parameter is not provided, use hash from block header.
-uint256 GetRandomXCommitment(const CBlockHeader& block, uint256 *inHash) {
-    uint256 rx_hash = inHash==nullptr ? block.hashRandomX : *inHash;
-    CBlockHeader rx_blockHeader(block);
-    rx_blockHeader.hashRandomX.SetNull();   // set to null when hashing
-    char rx_cm[RANDOMX_HASH_SIZE];
-    randomx_calculate_commitment(&rx_blockHeader, sizeof(rx_blockHeader), rx_hash.data(), rx_cm);
-    return uint256(std::vector<unsigned char>(rx_cm, rx_cm + sizeof(rx_cm)));
+std::optional<uint32_t> GetRandomXPrebuildEpoch(int64_t nTime, int64_t nLeadMinutes, uint32_t nDuration)
+{
+    if (nLeadMinutes <= 0) return std::nullopt;
+    const uint32_t nNextEpoch = GetEpoch(nTime + nLeadMinutes * 60, nDuration);
+    if (nNextEpoch == GetEpoch(nTime, nDuration)) return std::nullopt;
+    return nNextEpoch;
+}
+
+// Build the VM pool for an epoch in a background thread, so that blocks of the epoch do not wait for it.
+// Fast mode VMs are then created as for any other epoch, see GetVM().
+void PrebuildRandomXEpoch(uint32_t nEpoch)
+{
+    static std::atomic<uint32_t> nLastEpoch{0};
+    if (nLastEpoch.exchange(nEpoch) == nEpoch) return;
+
+    std::thread t([nEpoch]() {
+        util::ThreadRename("rxprebuild");
+        const auto start{SteadyClock::now()};
+        if (GetVM(nEpoch)) {
+            LogPrintf("Prebuilt RandomX VM for epoch %d: %.2fs\n", nEpoch, Ticks<SecondsDouble>(SteadyClock::now() - start));
+        }
+    });
+    t.detach();
+}
+
+void SetRandomXTipEpoch(uint32_t nEpoch)
+{
+    RandomXEpochManager::Instance().SetTipEpoch(nEpoch);
+}
+
+RandomXMemoryInfo GetRandomXMemoryInfo()
+{
+    return RandomXEpochManager::Instance().GetMemoryInfo();
+}
+
+
+//! Number of RandomX hashes computed to verify block headers
+static std::atomic<uint64_t> g_randomx_verify_count{0};
+
+uint64_t GetRandomXVerifyCount()
+{
+    return g_randomx_verify_count.load();
 }
 
+// Hash a block header with a VM from the pool of its epoch.
+std::optional<uint256> CalculateRandomXHash(const CBlockHeader& block, const Consensus::Params& params)
+{
+    int32_t nEpoch = GetEpoch(block.nTime, params.nRandomXEpochDuration);
+    RandomXVMPoolRef vmRef = GetVM(nEpoch);
+    if (!vmRef) {
+        LogPrintf("Error: Could not obtain VM for RandomX\n");
+        return std::nullopt;
+    }
+
+    CBlockHeader tmp(block);
+    tmp.hashRandomX.SetNull();   // set to null when hashing
+
+    uint256 hash;
+    RandomXVMPool::Lease vm(vmRef);
+    if (!vm.get()) {
+        LogPrintf("Error: randomx_create_vm() failed\n");
+        return std::nullopt;
+    }
+    randomx_calculate_hash(vm.get(), &tmp, sizeof(tmp), hash.data());
+    return hash;
+}
 
 /**
  * Check the RandomX commitment value, derived from the block header, meets the desired target.
@@ -630,37 +1480,33 @@ bool CheckProofOfWorkRandomX(const CBlockHeader& block, const Consensus::Params&
         fCommitmentVerified = true;
     }
 
+    // A header whose RandomX hash was verified before is not hashed again
+    uint256 hashCacheEntry;
+    if (verifyMode == POW_VERIFY_FULL) {
+        hashCacheEntry = RandomXHashCache::Instance().ComputeEntry(block, params);
+        fHashVerified = RandomXHashCache::Instance().Contains(hashCacheEntry);
+    }
+
     // Compute RandomX hash if necessary
-    if (verifyMode == POW_VERIFY_FULL || verifyMode == POW_VERIFY_MINING) {
-        int32_t nEpoch = GetEpoch(block.nTime, params.nRandomXEpochDuration);
-        boost::optional<RandomXVMRef> vmRef = GetVM(nEpoch);
-        if (!vmRef) {
-            LogPrintf("Error: Could not obtain VM for RandomX\n");
+    if ((verifyMode == POW_VERIFY_FULL && !fHashVerified) || verifyMode == POW_VERIFY_MINING) {
+        if (verifyMode == POW_VERIFY_FULL) ++g_randomx_verify_count;
+        const std::optional<uint256> rx_hash{CalculateRandomXHash(block, params)};
+        if (!rx_hash) {
             return false;
         }
 
-	    char rx_hash[RANDOMX_HASH_SIZE];
-
-        CBlockHeader tmp(block);
-        tmp.hashRandomX.SetNull();   // set to null when hashing
-
-        {
-            AssertLockNotHeld(vmRef.get()->m_hashing_mutex);
-            LOCK(vmRef.get()->m_hashing_mutex);
-            randomx_calculate_hash(vmRef.get()->vm, &tmp, sizeof(tmp), rx_hash);
-        }
-
         // If not mining, compare hash in block header with our computed value
         if (verifyMode != POW_VERIFY_MINING) {
-            if (memcmp(rx_hash, block.hashRandomX.begin(), RANDOMX_HASH_SIZE) != 0) {
+            if (*rx_hash != block.hashRandomX) {
                 LogPrintf("Error: Possible spam. RandomX hash value in block [%s] != computed hash value [%s]\n",
-                    block.hashRandomX.GetHex(), uint256(std::vector<unsigned char>(rx_hash, rx_hash + RANDOMX_HASH_SIZE)).GetHex());
+                    block.hashRandomX.GetHex(), rx_hash->GetHex());
                 return false;
             }
+            RandomXHashCache::Instance().Insert(hashCacheEntry);
         }
         else {
             // If mining, randomx hash generated, so now check if commitment meets target
-            hashRandomX = uint256(std::vector<unsigned char>(rx_hash, rx_hash + RANDOMX_HASH_SIZE));
+            hashRandomX = *rx_hash;
             if (UintToArith256(GetRandomXCommitment(block, &hashRandomX)) > bnTarget) {
                 return false;
             }
@@ -679,3 +1525,123 @@ bool CheckProofOfWorkRandomX(const CBlockHeader& block, const Consensus::Params&
 
     return true;
 }
+
+bool MineRandomX(CBlockHeader& block, const Consensus::Params& params, int nThreads, uint64_t& nMaxTries, const std::function<bool()>& interrupt, std::atomic<uint64_t>* pHashes)
+{
+    // Legacy chains continue to use original sha256d PoW, mined on the calling thread
+    if (!params.fPowRandomX) {
+        while (!CheckProofOfWork(block.GetHash(), block.nBits, params)) {
+            if (nMaxTries == 0 || block.nNonce == std::numeric_limits<uint32_t>::max() || interrupt()) return false;
+            ++block.nNonce;
+            --nMaxTries;
+            if (pHashes) ++*pHashes;
+        }
+        return true;
+    }
+
+    bool fNegative;
+    bool fOverflow;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(block.nBits, &fNegative, &fOverflow);
+    if (fNegative || bnTarget == 0 || fOverflow || bnTarget > UintToArith256(params.powLimit)) {
+        return false;
+    }
+
+    const uint32_t nEpoch = GetEpoch(block.nTime, params.nRandomXEpochDuration);
+    const uint64_t nEndNonce = std::min<uint64_t>(uint64_t{std::numeric_limits<uint32_t>::max()} + 1, SaturatingAdd(uint64_t{block.nNonce}, nMaxTries));
+
+    // Threads claim batches of consecutive nonces, and hash each batch with the pipelined RandomX API, which
+    // starts hashing the next nonce while completing the hash of the current one. Batches are claimed in order,
+    // and only nonces above a solution are abandoned, so the lowest solution is found, as with a single thread.
+    std::atomic<uint64_t> nNextNonce{block.nNonce};
+    std::atomic<uint64_t> nFoundNonce{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> nTried{0};
+    std::atomic<bool> fStop{false};
+    Mutex found_mutex;
+    uint256 hashFound;
+    // Lowest nonce of a claimed batch which was not tried, because the thread stopped before finishing it
+    uint64_t nFirstUntried{std::numeric_limits<uint64_t>::max()};
+    auto untried = [&](uint64_t nNonce) {
+        LOCK(found_mutex);
+        nFirstUntried = std::min(nFirstUntried, nNonce);
+    };
+
+    auto mine = [&]() {
+        CBlockHeader tmp(block);
+        tmp.hashRandomX.SetNull();   // set to null when hashing
+        char rx_hash[RANDOMX_HASH_SIZE];
+        while (!fStop) {
+            const uint64_t nStart = nNextNonce.fetch_add(RANDOMX_MINING_BATCH);
+            if (nStart >= nEndNonce || nStart > nFoundNonce) break;
+            const uint64_t nEnd = std::min(nStart + RANDOMX_MINING_BATCH, nEndNonce);
+
+            // A VM is only held for one batch, so that verification sharing the pool is not starved, and fast mode
+            // VMs are used as soon as they are ready.
+            RandomXVMPoolRef vmRef = GetVM(nEpoch);
+            if (!vmRef) {
+                LogPrintf("Error: Could not obtain VM for RandomX\n");
+                untried(nStart);
+                fStop = true;
+                break;
+            }
+            RandomXVMPool::Lease vm(vmRef);
+            if (!vm.get()) {
+                LogPrintf("Error: randomx_create_vm() failed\n");
+                untried(nStart);
+                fStop = true;
+                break;
+            }
+
+            tmp.nNonce = nStart;
+            randomx_calculate_hash_first(vm.get(), &tmp, sizeof(tmp));
+            uint64_t nNonce = nStart;
+            while (nNonce < nEnd && nNonce < nFoundNonce && !fStop) {
+                if (nNonce + 1 < nEnd) {
+                    tmp.nNonce = nNonce + 1;
+                    randomx_calculate_hash_next(vm.get(), &tmp, sizeof(tmp), rx_hash);
+                } else {
+                    randomx_calculate_hash_last(vm.get(), rx_hash);
+                }
+                CBlockHeader candidate(block);
+                candidate.nNonce = nNonce++;
+                uint256 hashRandomX(std::vector<unsigned char>(rx_hash, rx_hash + RANDOMX_HASH_SIZE));
+                if (UintToArith256(GetRandomXCommitment(candidate, &hashRandomX)) <= bnTarget) {
+                    LOCK(found_mutex);
+                    if (candidate.nNonce < nFoundNonce) {
+                        nFoundNonce = candidate.nNonce;
+                        hashFound = hashRandomX;
+                    }
+                    break;
+                }
+            }
+            if (nNonce < nEnd) untried(nNonce);
+            nTried += nNonce - nStart;
+            if (pHashes) *pHashes += nNonce - nStart;
+            if (interrupt()) fStop = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads; ++i) {
+        threads.emplace_back([&mine, i]() {
+            util::ThreadRename(strprintf("rxmine.%i", i));
+            mine();
+        });
+    }
+    mine();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    nMaxTries -= std::min(nMaxTries, nTried.load());
+    LOCK(found_mutex);
+    if (nFoundNonce == std::numeric_limits<uint64_t>::max()) {
+        // Continue from the lowest nonce not tried, either in a batch a thread stopped in or after the batches
+        // handed out to the threads. The nonces above it which other threads tried are tried again.
+        block.nNonce = std::min<uint64_t>({nFirstUntried, nNextNonce.load(), nEndNonce, std::numeric_limits<uint32_t>::max()});
+        return false;
+    }
+    block.nNonce = nFoundNonce;
+    block.hashRandomX = hashFound;
+    return true;
+}
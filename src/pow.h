@@ -9,8 +9,16 @@
 #define BITCOIN_POW_H
 
 #include <consensus/params.h>
+#include <consensus/randomx.h>
+#include <span.h>
+#include <util/fs.h>
 
+#include <atomic>
+#include <functional>
+#include <optional>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 #include <randomx.h>
 
@@ -49,20 +57,96 @@ typedef enum POWVerifyMode_t
 /** Faster RandomX computation but requires more memory */
 static constexpr bool DEFAULT_RANDOMX_FAST_MODE = false;
 
-/** Number of epochs to cache. There is one VM per epoch. Minimum is 1.*/
+/** Number of epochs to cache. There is one VM pool per epoch. Minimum is 1.*/
 static constexpr int DEFAULT_RANDOMX_VM_CACHE_SIZE = 2;
 
-/** Calculate epoch from timestamp */
-uint32_t GetEpoch(uint32_t nTime, uint32_t nDuration);
+/** Maximum memory in MiB used by cached RandomX caches, datasets and VMs. 0 means no limit. */
+static constexpr int64_t DEFAULT_RANDOMX_MAX_MEM = 0;
 
-/** Calculate RandomX key for a given epoch */
-uint256 GetSeedHash(uint32_t nEpoch);
+/** Number of VMs per epoch, allowing concurrent hashing. 0 means one VM per core. */
+static constexpr int DEFAULT_RANDOMX_VM_POOL_SIZE = 0;
+
+/** Number of threads used to initialize the fast mode dataset. 0 means one thread per core. */
+static constexpr int DEFAULT_RANDOMX_INIT_THREADS = 0;
+
+/** Allocate RandomX memory with large pages, falling back to regular pages if they are not available. */
+static constexpr bool DEFAULT_RANDOMX_LARGE_PAGES = false;
+
+/** Keep a copy of the fast mode dataset on each NUMA node, used by VMs running on the node. */
+static constexpr bool DEFAULT_RANDOMX_NUMA = false;
+
+/** Keep the fast mode dataset in a file in the data directory, so it does not need to be created again after a restart. */
+static constexpr bool DEFAULT_RANDOMX_PERSIST_DATASET = false;
+
+/** Minutes before an epoch starts to build its RandomX VMs in the background. 0 disables it. */
+static constexpr int64_t DEFAULT_RANDOMX_PREBUILD_LEAD = 60;
+
+/** Parse the CPUs of a NUMA node from its sysfs cpulist, e.g. "0-3,8" */
+std::vector<int> ParseNumaCpuList(const std::string& list);
+
+/** Return the epoch starting within nLeadMinutes after nTime, whose RandomX VMs should be prebuilt, if any */
+std::optional<uint32_t> GetRandomXPrebuildEpoch(int64_t nTime, int64_t nLeadMinutes, uint32_t nDuration);
+
+/** Create the RandomX VMs for an epoch in a background thread, ahead of its first block */
+void PrebuildRandomXEpoch(uint32_t nEpoch);
+
+/** Memory used by cached RandomX epochs */
+struct RandomXMemoryInfo {
+    size_t epochs{0};
+    size_t caches{0};
+    size_t cache_bytes{0};
+    size_t datasets{0};
+    size_t dataset_bytes{0};
+    size_t vms{0};
+    size_t vm_bytes{0};
+    size_t max_bytes{0};
+
+    size_t TotalBytes() const { return cache_bytes + dataset_bytes + vm_bytes; }
+};
+
+/** Return the memory used by cached RandomX epochs */
+RandomXMemoryInfo GetRandomXMemoryInfo();
+
+/** Set the epoch of the chain tip, whose RandomX VMs are kept when evicting cached epochs */
+void SetRandomXTipEpoch(uint32_t nEpoch);
+
+/**
+ * Call init on the items of the fast mode dataset, split into contiguous ranges across nThreads threads. The
+ * calling thread initializes the last range itself. Progress is logged in steps of 10%. If nNode is set, the
+ * workers are bound to that NUMA node.
+ */
+void InitRandomXDatasetRanges(unsigned long nItems, int nThreads, const std::function<void(unsigned long nStart, unsigned long nCount)>& init, std::optional<size_t> nNode = std::nullopt);
+
+/** Return the path of the fast mode dataset file of an epoch, see -randomxpersistdataset */
+fs::path GetRandomXDatasetPath(uint32_t nEpoch);
+
+/** Write the fast mode dataset of an epoch to its file, with a header committing to the epoch, its size and its checksum */
+bool WriteRandomXDataset(uint32_t nEpoch, Span<const unsigned char> data, int nThreads);
+
+/** Read the fast mode dataset of an epoch from its file. A file which does not match the epoch, the size of data
+ * or its checksum is deleted. */
+bool ReadRandomXDataset(uint32_t nEpoch, Span<unsigned char> data, int nThreads);
+
+/** Return the number of RandomX hashes computed to verify block headers, not counting those found in the verified hash cache */
+uint64_t GetRandomXVerifyCount();
+
+/** Calculate the RandomX hash of a block header with a VM of its epoch, or std::nullopt if no VM is available */
+std::optional<uint256> CalculateRandomXHash(const CBlockHeader& block, const Consensus::Params& params);
 
 /** Check if RandomX commitment of block satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWorkRandomX(const CBlockHeader& block, const Consensus::Params& params, POWVerifyMode mode = POW_VERIFY_FULL, uint256 *outHash = nullptr);
 
-/** Calculate RandomX commitment of block */
-uint256 GetRandomXCommitment(const CBlockHeader& block, uint256 *inHash = nullptr);
+/** Number of consecutive nonces a mining thread hashes with one VM before checking for interruption */
+static constexpr uint64_t RANDOMX_MINING_BATCH = 256;
+
+/**
+ * Search the nonces of a block header, starting from nNonce, for a RandomX hash whose commitment meets the target.
+ * The nonces are shared by nThreads threads, including the calling thread, each hashing with its own VM of the
+ * epoch pool. On success, set nNonce and hashRandomX and return true. Otherwise set nNonce to the lowest nonce
+ * not tried yet, which is the maximum when the nonces are exhausted. At most nMaxTries nonces are tried, and the number
+ * tried is subtracted from it. Stop early if interrupt returns true. Hashes are also added to pHashes if set.
+ */
+bool MineRandomX(CBlockHeader& block, const Consensus::Params& params, int nThreads, uint64_t& nMaxTries, const std::function<bool()>& interrupt, std::atomic<uint64_t>* pHashes = nullptr);
 
 /**
  * Bitcoin cash's difficulty adjustment mechanism.
@@ -0,0 +1,122 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <powverifyqueue.h>
+
+#include <pow.h>
+#include <tinyformat.h>
+#include <util/threadnames.h>
+
+PowVerifyQueue::PowVerifyQueue(const Consensus::Params& consensus_params, int worker_threads_num)
+    : m_consensus_params{consensus_params}
+{
+    m_worker_threads.reserve(worker_threads_num);
+    for (int n = 0; n < worker_threads_num; ++n) {
+        m_worker_threads.emplace_back([this, n]() {
+            util::ThreadRename(strprintf("rxverify.%i", n));
+            Loop();
+        });
+    }
+}
+
+PowVerifyQueue::~PowVerifyQueue()
+{
+    StopWorkerThreads();
+}
+
+bool PowVerifyQueue::Verify(const CBlockHeader& header) const
+{
+    return CheckProofOfWorkRandomX(header, m_consensus_params, POW_VERIFY_FULL);
+}
+
+void PowVerifyQueue::Loop()
+{
+    while (true) {
+        CBlockHeader header;
+        uint256 block_hash;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_worker_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_request_stop || !m_queue.empty(); });
+            if (m_request_stop) return;
+            block_hash = m_queue.front();
+            m_queue.pop_front();
+            // Skip blocks whose result was already taken, or which are being verified by a caller of Take().
+            const auto it{m_entries.find(block_hash)};
+            if (it == m_entries.end() || it->second.status != Status::QUEUED) continue;
+            it->second.status = Status::VERIFYING;
+            header = it->second.header;
+        }
+
+        const bool valid{Verify(header)};
+
+        {
+            LOCK(m_mutex);
+            const auto it{m_entries.find(block_hash)};
+            if (it != m_entries.end()) it->second.status = valid ? Status::VALID : Status::INVALID;
+        }
+        m_result_cv.notify_all();
+    }
+}
+
+bool PowVerifyQueue::Add(const CBlockHeader& header)
+{
+    const uint256 block_hash{header.GetHash()};
+    {
+        LOCK(m_mutex);
+        if (m_request_stop || m_entries.size() >= MAX_POW_VERIFY_QUEUE_SIZE) return false;
+        if (!m_entries.try_emplace(block_hash, Entry{header}).second) return true;
+        m_queue.push_back(block_hash);
+    }
+    m_worker_cv.notify_one();
+    return true;
+}
+
+std::optional<bool> PowVerifyQueue::Take(const uint256& block_hash)
+{
+    WAIT_LOCK(m_mutex, lock);
+    auto it{m_entries.find(block_hash)};
+    if (it == m_entries.end()) return std::nullopt;
+
+    if (it->second.status == Status::QUEUED) {
+        // Not picked up by a worker yet: verify it here rather than waiting behind the rest of the queue.
+        // Its hash stays in m_queue and is skipped by the worker that pops it.
+        const CBlockHeader header{it->second.header};
+        m_entries.erase(it);
+        REVERSE_LOCK(lock);
+        return Verify(header);
+    }
+
+    m_result_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+        it = m_entries.find(block_hash);
+        return it == m_entries.end() || it->second.status != Status::VERIFYING;
+    });
+    if (it == m_entries.end()) return std::nullopt;
+    const bool valid{it->second.status == Status::VALID};
+    m_entries.erase(it);
+    return valid;
+}
+
+void PowVerifyQueue::Discard(const uint256& block_hash)
+{
+    // The hash stays in m_queue, and a worker which is verifying the block drops its result.
+    WITH_LOCK(m_mutex, m_entries.erase(block_hash));
+    m_result_cv.notify_all();
+}
+
+size_t PowVerifyQueue::Size()
+{
+    return WITH_LOCK(m_mutex, return m_entries.size());
+}
+
+void PowVerifyQueue::StopWorkerThreads()
+{
+    WITH_LOCK(m_mutex, m_request_stop = true);
+    m_worker_cv.notify_all();
+    for (std::thread& t : m_worker_threads) {
+        t.join();
+    }
+    m_worker_threads.clear();
+    WITH_LOCK(m_mutex, m_queue.clear(); m_entries.clear());
+    m_result_cv.notify_all();
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWVERIFYQUEUE_H
+#define BITCOIN_POWVERIFYQUEUE_H
+
+#include <consensus/params.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <condition_variable>
+#include <deque>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/** Maximum number of RandomX verification threads. */
+static constexpr int MAX_RANDOMX_VERIFY_THREADS{64};
+/** -randomxverifythreads default (0 = one thread per core) */
+static constexpr int DEFAULT_RANDOMX_VERIFY_THREADS{0};
+/** Maximum number of headers queued or verified whose result has not been taken. */
+static constexpr size_t MAX_POW_VERIFY_QUEUE_SIZE{4096};
+
+/**
+ * Queue for full RandomX verification of block headers, run by worker threads.
+ *
+ * Batches of new headers, as received during headers sync, are queued here by
+ * ChainstateManager::PreVerifyPow(), so that their RandomX hashes are verified
+ * in parallel before the headers are accepted. The result is recorded by block
+ * hash, and taken or discarded by the caller before it returns, so no entry
+ * outlives the batch it was queued for.
+ */
+class PowVerifyQueue
+{
+private:
+    enum class Status {
+        QUEUED,
+        VERIFYING,
+        VALID,
+        INVALID,
+    };
+
+    const Consensus::Params& m_consensus_params;
+
+    Mutex m_mutex;
+
+    //! Worker threads block on this when out of work
+    std::condition_variable m_worker_cv;
+
+    //! Threads waiting for a result block on this
+    std::condition_variable m_result_cv;
+
+    struct Entry {
+        CBlockHeader header;
+        Status status{Status::QUEUED};
+    };
+
+    //! Hashes of blocks waiting to be verified, in the order they were queued.
+    std::deque<uint256> m_queue GUARDED_BY(m_mutex);
+
+    //! Every queued block whose result has not been taken yet.
+    std::unordered_map<uint256, Entry, BlockHasher> m_entries GUARDED_BY(m_mutex);
+
+    std::vector<std::thread> m_worker_threads;
+    bool m_request_stop GUARDED_BY(m_mutex){false};
+
+    void Loop() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    bool Verify(const CBlockHeader& header) const;
+
+public:
+    PowVerifyQueue(const Consensus::Params& consensus_params, int worker_threads_num);
+    ~PowVerifyQueue();
+
+    PowVerifyQueue(const PowVerifyQueue&) = delete;
+    PowVerifyQueue& operator=(const PowVerifyQueue&) = delete;
+
+    /** Queue a header for verification. Returns false if it was not queued because the queue is full. */
+    bool Add(const CBlockHeader& header) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Take the verification result for a block, waiting if a worker is verifying it.
+     * A block which is still queued is verified by the calling thread.
+     * Returns std::nullopt if the block was never queued, or its result was already taken.
+     */
+    std::optional<bool> Take(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Forget a block whose result is no longer needed. */
+    void Discard(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Number of blocks queued or verified whose result has not been taken or discarded. */
+    size_t Size() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Stop the worker threads. Results which have not been taken are discarded. */
+    void StopWorkerThreads() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+
+#endif // BITCOIN_POWVERIFYQUEUE_H
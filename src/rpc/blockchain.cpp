@@ -605,7 +605,7 @@ static CBlock GetBlockChecked(BlockManager& blockman, const CBlockIndex& blockin
         }
     }
 
-    if (!blockman.ReadBlockFromDisk(block, blockindex)) {
+    if (!blockman.ReadBlockFromDisk(block, blockindex, /*check_pow=*/false)) {
         // Block not found on disk. This could be because we have the block
         // header in our index but not yet have the block or did not accept the
         // block. Or if the block was pruned right after we released the lock above.
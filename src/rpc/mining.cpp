@@ -10,11 +10,13 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <chainparamsbase.h>
+#include <common/args.h>
 #include <common/system.h>
 #include <consensus/amount.h>
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/params.h>
+#include <consensus/randomx.h>
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <deploymentinfo.h>
@@ -23,6 +25,7 @@
 #include <key_io.h>
 #include <net.h>
 #include <node/context.h>
+#include <node/cpuminer.h>
 #include <node/miner.h>
 #include <node/warnings.h>
 #include <pow.h>
@@ -44,6 +47,7 @@
 #include <validation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <memory>
 #include <stdint.h>
 
@@ -132,26 +136,25 @@ static RPCHelpMan getnetworkhashps()
     };
 }
 
-static bool GenerateBlock(ChainstateManager& chainman, Mining& miner, CBlock& block, uint64_t& max_tries, std::shared_ptr<const CBlock>& block_out, bool process_new_block)
+/** Number of threads mining blocks for the generate RPCs */
+static int GetGenerateThreads(const NodeContext& node)
+{
+    return node::GetMiningThreads(EnsureArgsman(node).GetIntArg("-genproclimit", node::DEFAULT_GENPROCLIMIT));
+}
+
+static bool GenerateBlock(ChainstateManager& chainman, Mining& miner, CBlock& block, uint64_t& max_tries, int num_threads, std::shared_ptr<const CBlock>& block_out, bool process_new_block)
 {
     block_out.reset();
     block.hashMerkleRoot = BlockMerkleRoot(block);
 
-    uint256 rxHash;
-    rxHash.SetNull();
-    while (max_tries > 0 &&
-           block.nNonce < std::numeric_limits<uint32_t>::max() &&
-           !CheckProofOfWorkRandomX(block, chainman.GetConsensus(), POW_VERIFY_MINING, &rxHash)) {
-        ++block.nNonce;
-        --max_tries;
-    }
-    block.hashRandomX = rxHash;
-
-    if (max_tries == 0 || chainman.m_interrupt) {
-        return false;
-    }
-    if (block.nNonce == std::numeric_limits<uint32_t>::max()) {
-        return true;
+    if (!MineRandomX(block, chainman.GetConsensus(), num_threads, max_tries, [&] { return bool{chainman.m_interrupt}; })) {
+        if (max_tries == 0 || chainman.m_interrupt) {
+            return false;
+        }
+        if (block.nNonce == std::numeric_limits<uint32_t>::max()) {
+            return true;
+        }
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not compute RandomX hash");
     }
 
     block_out = std::make_shared<const CBlock>(block);
@@ -165,7 +168,7 @@ static bool GenerateBlock(ChainstateManager& chainman, Mining& miner, CBlock& bl
     return true;
 }
 
-static UniValue generateBlocks(ChainstateManager& chainman, Mining& miner, const CScript& coinbase_script, int nGenerate, uint64_t nMaxTries)
+static UniValue generateBlocks(ChainstateManager& chainman, Mining& miner, const CScript& coinbase_script, int nGenerate, uint64_t nMaxTries, int num_threads)
 {
     UniValue blockHashes(UniValue::VARR);
     while (nGenerate > 0 && !chainman.m_interrupt) {
@@ -174,7 +177,7 @@ static UniValue generateBlocks(ChainstateManager& chainman, Mining& miner, const
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't create new block");
 
         std::shared_ptr<const CBlock> block_out;
-        if (!GenerateBlock(chainman, miner, pblocktemplate->block, nMaxTries, block_out, /*process_new_block=*/true)) {
+        if (!GenerateBlock(chainman, miner, pblocktemplate->block, nMaxTries, num_threads, block_out, /*process_new_block=*/true)) {
             break;
         }
 
@@ -220,6 +223,21 @@ static bool getScriptFromDescriptor(const std::string& descriptor, CScript& scri
     }
 }
 
+static CScript GetScriptForAddressOrDescriptor(const std::string& address_or_descriptor)
+{
+    CScript script;
+    std::string error;
+    if (!getScriptFromDescriptor(address_or_descriptor, script, error)) {
+        const auto destination = DecodeDestination(address_or_descriptor);
+        if (!IsValidDestination(destination)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Error: Invalid address or descriptor");
+        }
+
+        script = GetScriptForDestination(destination);
+    }
+    return script;
+}
+
 static RPCHelpMan generatetodescriptor()
 {
     return RPCHelpMan{
@@ -253,7 +271,7 @@ static RPCHelpMan generatetodescriptor()
     Mining& miner = EnsureMining(node);
     ChainstateManager& chainman = EnsureChainman(node);
 
-    return generateBlocks(chainman, miner, coinbase_script, num_blocks, max_tries);
+    return generateBlocks(chainman, miner, coinbase_script, num_blocks, max_tries, GetGenerateThreads(node));
 },
     };
 }
@@ -301,7 +319,7 @@ static RPCHelpMan generatetoaddress()
 
     CScript coinbase_script = GetScriptForDestination(destination);
 
-    return generateBlocks(chainman, miner, coinbase_script, num_blocks, max_tries);
+    return generateBlocks(chainman, miner, coinbase_script, num_blocks, max_tries, GetGenerateThreads(node));
 },
     };
 }
@@ -334,18 +352,7 @@ static RPCHelpMan generateblock()
         },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
-    const auto address_or_descriptor = request.params[0].get_str();
-    CScript coinbase_script;
-    std::string error;
-
-    if (!getScriptFromDescriptor(address_or_descriptor, coinbase_script, error)) {
-        const auto destination = DecodeDestination(address_or_descriptor);
-        if (!IsValidDestination(destination)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Error: Invalid address or descriptor");
-        }
-
-        coinbase_script = GetScriptForDestination(destination);
-    }
+    const CScript coinbase_script{GetScriptForAddressOrDescriptor(request.params[0].get_str())};
 
     NodeContext& node = EnsureAnyNodeContext(request.context);
     Mining& miner = EnsureMining(node);
@@ -402,7 +409,7 @@ static RPCHelpMan generateblock()
     std::shared_ptr<const CBlock> block_out;
     uint64_t max_tries{DEFAULT_MAX_TRIES};
 
-    if (!GenerateBlock(chainman, miner, block, max_tries, block_out, process_new_block) || !block_out) {
+    if (!GenerateBlock(chainman, miner, block, max_tries, GetGenerateThreads(node), block_out, process_new_block) || !block_out) {
         throw JSONRPCError(RPC_MISC_ERROR, "Failed to make block.");
     }
 
@@ -418,6 +425,56 @@ static RPCHelpMan generateblock()
     };
 }
 
+static RPCHelpMan setgenerate()
+{
+    return RPCHelpMan{"setgenerate",
+        "\nStart or stop mining blocks in the background.\n"
+        "Blocks are mined on the current tip, and a new block template is used when the tip changes.\n"
+        "See getmininginfo for the hash rate.\n",
+        {
+            {"generate", RPCArg::Type::BOOL, RPCArg::Optional::NO, "Set to true to start mining, or false to stop."},
+            {"output", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The address or descriptor to send newly generated Snailcoin to. Required to start mining."},
+            {"genproclimit", RPCArg::Type::NUM, RPCArg::DefaultHint{"-genproclimit"}, "Number of mining threads (-1 = one per core)."},
+        },
+        RPCResult{RPCResult::Type::NONE, "", ""},
+        RPCExamples{
+            "\nMine with 4 threads to myaddress\n"
+            + HelpExampleCli("setgenerate", "true \"myaddress\" 4")
+            + "\nStop mining\n"
+            + HelpExampleCli("setgenerate", "false")
+            + HelpExampleRpc("setgenerate", "true, \"myaddress\", 4")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    NodeContext& node = EnsureAnyNodeContext(request.context);
+    if (!node.cpu_miner) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Miner not available");
+    }
+
+    if (!request.params[0].get_bool()) {
+        node.cpu_miner->Stop();
+        return UniValue::VNULL;
+    }
+
+    if (request.params[1].isNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "An address or descriptor is required to start mining");
+    }
+    const CScript coinbase_script{GetScriptForAddressOrDescriptor(request.params[1].get_str())};
+
+    int genproclimit{static_cast<int>(EnsureArgsman(node).GetIntArg("-genproclimit", node::DEFAULT_GENPROCLIMIT))};
+    if (!request.params[2].isNull()) {
+        genproclimit = request.params[2].getInt<int>();
+        if (genproclimit < -1 || genproclimit == 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "genproclimit must be -1 or a positive integer");
+        }
+    }
+
+    node.cpu_miner->Start(coinbase_script, node::GetMiningThreads(genproclimit));
+    return UniValue::VNULL;
+},
+    };
+}
+
 static RPCHelpMan getmininginfo()
 {
     return RPCHelpMan{"getmininginfo",
@@ -432,6 +489,9 @@ static RPCHelpMan getmininginfo()
                         {RPCResult::Type::NUM, "difficulty", "The current difficulty"},
                         {RPCResult::Type::NUM, "networkhashps", "The network hashes per second"},
                         {RPCResult::Type::NUM, "pooledtx", "The size of the mempool"},
+                        {RPCResult::Type::BOOL, "generate", "Whether blocks are being mined in the background (see setgenerate)"},
+                        {RPCResult::Type::NUM, "genproclimit", "The number of background mining threads, 0 if not mining"},
+                        {RPCResult::Type::NUM, "hashespersec", "The background mining hash rate since mining was started"},
                         {RPCResult::Type::STR, "chain", "current network name (" LIST_CHAIN_NAMES ")"},
                         (IsDeprecatedRPCEnabled("warnings") ?
                             RPCResult{RPCResult::Type::STR, "warnings", "any network and blockchain warnings (DEPRECATED)"} :
@@ -461,6 +521,10 @@ static RPCHelpMan getmininginfo()
     obj.pushKV("difficulty", GetDifficulty(*CHECK_NONFATAL(active_chain.Tip())));
     obj.pushKV("networkhashps",    getnetworkhashps().HandleRequest(request));
     obj.pushKV("pooledtx",         (uint64_t)mempool.size());
+    const int mining_threads{node.cpu_miner ? node.cpu_miner->GetThreads() : 0};
+    obj.pushKV("generate",         mining_threads > 0);
+    obj.pushKV("genproclimit",     mining_threads);
+    obj.pushKV("hashespersec",     node.cpu_miner ? node.cpu_miner->GetHashRate() : 0.0);
     obj.pushKV("chain", chainman.GetParams().GetChainTypeString());
     obj.pushKV("warnings", node::GetWarningsForRpc(*CHECK_NONFATAL(node.warnings), IsDeprecatedRPCEnabled("warnings")));
     return obj;
@@ -661,6 +725,10 @@ static RPCHelpMan getblocktemplate()
                 {RPCResult::Type::STR_HEX, "default_witness_commitment", /*optional=*/true, "a valid witness commitment for the unmodified block template"},
 
                 {RPCResult::Type::NUM, "rx_epoch_duration", "seconds"},
+                {RPCResult::Type::NUM, "rx_epoch", /*optional=*/true, "The RandomX epoch of curtime"},
+                {RPCResult::Type::STR_HEX, "rx_seed_hash", /*optional=*/true, "The RandomX key of the epoch, in byte order"},
+                {RPCResult::Type::STR_HEX, "rx_next_seed_hash", /*optional=*/true, "The RandomX key of the next epoch, in byte order"},
+                {RPCResult::Type::NUM_TIME, "rx_epoch_end", /*optional=*/true, "The timestamp at which the next epoch starts, expressed in " + UNIX_EPOCH_TIME + ". Longpolling returns a new template at this time."},
             }},
         },
         RPCExamples{
@@ -746,6 +814,8 @@ static RPCHelpMan getblocktemplate()
 
     static unsigned int nTransactionsUpdatedLast;
 
+    const Consensus::Params& consensusParams = chainman.GetParams().GetConsensus();
+
     if (!lpval.isNull())
     {
         // Wait to respond until either the best block changes, OR a minute has passed and there are more transactions
@@ -768,6 +838,14 @@ static RPCHelpMan getblocktemplate()
             nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
         }
 
+        // Also wake up when the next RandomX epoch starts, as the template then has a new key
+        auto epoch_end{std::chrono::steady_clock::time_point::max()};
+        if (consensusParams.fPowRandomX) {
+            const int64_t now{TicksSinceEpoch<std::chrono::seconds>(NodeClock::now())};
+            const int64_t next_epoch_time{(int64_t{GetEpoch(now, consensusParams.nRandomXEpochDuration)} + 1) * consensusParams.nRandomXEpochDuration};
+            epoch_end = std::chrono::steady_clock::now() + std::chrono::seconds{next_epoch_time - now};
+        }
+
         // Release lock while waiting
         LEAVE_CRITICAL_SECTION(cs_main);
         {
@@ -776,8 +854,10 @@ static RPCHelpMan getblocktemplate()
             WAIT_LOCK(g_best_block_mutex, lock);
             while (g_best_block == hashWatchedChain && IsRPCRunning())
             {
-                if (g_best_block_cv.wait_until(lock, checktxtime) == std::cv_status::timeout)
+                if (g_best_block_cv.wait_until(lock, std::min(checktxtime, epoch_end)) == std::cv_status::timeout)
                 {
+                    if (std::chrono::steady_clock::now() >= epoch_end)
+                        break;
                     // Timeout: Check transactions for update
                     // without holding the mempool lock to avoid deadlocks
                     if (miner.getTransactionsUpdated() != nTransactionsUpdatedLastLP)
@@ -795,8 +875,6 @@ static RPCHelpMan getblocktemplate()
         // TODO: Maybe recheck connections/IBD and (if something wrong) send an expires-immediately template to stop miners?
     }
 
-    const Consensus::Params& consensusParams = chainman.GetParams().GetConsensus();
-
     // GBT must be called with 'signet' set in the rules for signet chains
     if (consensusParams.signet_blocks && setClientRules.count("signet") != 1) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "getblocktemplate must be called with the signet rule set (call with {\"rules\": [\"segwit\", \"signet\"]})");
@@ -809,10 +887,9 @@ static RPCHelpMan getblocktemplate()
 
     // Update block
     static CBlockIndex* pindexPrev;
-    static int64_t time_start;
     static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    if (!pindexPrev || pindexPrev->GetBlockHash() != tip ||
-        (miner.getTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - time_start > 5))
+    // Mempool changes are applied incrementally by the block template cache, so there is no need to throttle them
+    if (!pindexPrev || pindexPrev->GetBlockHash() != tip || miner.getTransactionsUpdated() != nTransactionsUpdatedLast)
     {
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
         pindexPrev = nullptr;
@@ -820,7 +897,6 @@ static RPCHelpMan getblocktemplate()
         // Store the pindexBest used before createNewBlock, to avoid races
         nTransactionsUpdatedLast = miner.getTransactionsUpdated();
         CBlockIndex* pindexPrevNew = chainman.m_blockman.LookupBlockIndex(tip);
-        time_start = GetTime();
 
         // Create new block
         CScript scriptDummy = CScript() << OP_TRUE;
@@ -983,6 +1059,13 @@ static RPCHelpMan getblocktemplate()
     }
 
     result.pushKV("rx_epoch_duration", consensusParams.nRandomXEpochDuration);
+    if (consensusParams.fPowRandomX) {
+        const uint32_t nEpoch = GetEpoch(pblock->nTime, consensusParams.nRandomXEpochDuration);
+        result.pushKV("rx_epoch", (int64_t)nEpoch);
+        result.pushKV("rx_seed_hash", HexStr(GetSeedHash(nEpoch)));
+        result.pushKV("rx_next_seed_hash", HexStr(GetSeedHash(nEpoch + 1)));
+        result.pushKV("rx_epoch_end", (int64_t)(nEpoch + 1) * consensusParams.nRandomXEpochDuration);
+    }
 
     return result;
 },
@@ -1123,6 +1206,7 @@ void RegisterMiningRPCCommands(CRPCTable& t)
     static const CRPCCommand commands[]{
         {"mining", &getnetworkhashps},
         {"mining", &getmininginfo},
+        {"mining", &setgenerate},
         {"mining", &prioritisetransaction},
         {"mining", &getprioritisedtransactions},
         {"mining", &getblocktemplate},
@@ -17,6 +17,8 @@
 #include <kernel/cs_main.h>
 #include <logging.h>
 #include <node/context.h>
+#include <pow.h>
+#include <primitives/block.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
@@ -105,6 +107,22 @@ static RPCHelpMan mockscheduler()
     };
 }
 
+static UniValue RPCRandomXMemoryInfo()
+{
+    const RandomXMemoryInfo info = GetRandomXMemoryInfo();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("epochs", uint64_t(info.epochs));
+    obj.pushKV("caches", uint64_t(info.caches));
+    obj.pushKV("cache_bytes", uint64_t(info.cache_bytes));
+    obj.pushKV("datasets", uint64_t(info.datasets));
+    obj.pushKV("dataset_bytes", uint64_t(info.dataset_bytes));
+    obj.pushKV("vms", uint64_t(info.vms));
+    obj.pushKV("vm_bytes", uint64_t(info.vm_bytes));
+    obj.pushKV("total_bytes", uint64_t(info.TotalBytes()));
+    obj.pushKV("max_bytes", uint64_t(info.max_bytes));
+    return obj;
+}
+
 static UniValue RPCLockedMemoryInfo()
 {
     LockedPool::Stats stats = LockedPoolManager::Instance().stats();
@@ -162,6 +180,18 @@ static RPCHelpMan getmemoryinfo()
                                 {RPCResult::Type::NUM, "chunks_used", "Number allocated chunks"},
                                 {RPCResult::Type::NUM, "chunks_free", "Number unused chunks"},
                             }},
+                            {RPCResult::Type::OBJ, "randomx", /*optional=*/true, "Information about cached RandomX epochs, only present on RandomX chains",
+                            {
+                                {RPCResult::Type::NUM, "epochs", "Number of cached epochs"},
+                                {RPCResult::Type::NUM, "caches", "Number of light mode caches"},
+                                {RPCResult::Type::NUM, "cache_bytes", "Number of bytes used by light mode caches"},
+                                {RPCResult::Type::NUM, "datasets", "Number of fast mode datasets, including copies for NUMA nodes"},
+                                {RPCResult::Type::NUM, "dataset_bytes", "Number of bytes used by fast mode datasets"},
+                                {RPCResult::Type::NUM, "vms", "Number of VMs"},
+                                {RPCResult::Type::NUM, "vm_bytes", "Number of bytes used by VM scratchpads"},
+                                {RPCResult::Type::NUM, "total_bytes", "Total number of bytes used"},
+                                {RPCResult::Type::NUM, "max_bytes", "Maximum number of bytes to use, set by -randomxmaxmem (0 = no limit)"},
+                            }},
                         }
                     },
                     RPCResult{"mode \"mallocinfo\"",
@@ -178,6 +208,9 @@ static RPCHelpMan getmemoryinfo()
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        if (g_isRandomX) {
+            obj.pushKV("randomx", RPCRandomXMemoryInfo());
+        }
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
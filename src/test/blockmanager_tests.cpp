@@ -8,6 +8,7 @@
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <node/kernel_notifications.h>
+#include <pow.h>
 #include <script/solver.h>
 #include <primitives/block.h>
 #include <util/chaintype.h>
@@ -15,13 +16,26 @@
 
 #include <boost/test/unit_test.hpp>
 #include <test/util/logging.h>
+#include <test/util/random.h>
 #include <test/util/setup_common.h>
 
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
 using node::BLOCK_SERIALIZATION_HEADER_SIZE;
 using node::BlockManager;
 using node::KernelNotifications;
 using node::MAX_BLOCKFILE_SIZE;
 
+namespace {
+//! Block index entries only store the RandomX hash on RandomX chains
+struct RandomXBasicTestingSetup : public BasicTestingSetup {
+    RandomXBasicTestingSetup() : BasicTestingSetup{ChainType::SNAILCOINREGTEST} {}
+};
+} // namespace
+
 // use BasicTestingSetup here for the data directory configuration, setup, and cleanup
 BOOST_FIXTURE_TEST_SUITE(blockmanager_tests, BasicTestingSetup)
 
@@ -180,6 +194,9 @@ BOOST_AUTO_TEST_CASE(blockmanager_flush_block_file)
         BOOST_CHECK(!blockman.ReadBlockFromDisk(read_block, pos2));
         BOOST_CHECK_EQUAL(read_block.nVersion, 2);
     }
+    // A trusted read does not check the header
+    BOOST_CHECK(blockman.ReadBlockFromDisk(read_block, pos1, /*check_pow=*/false));
+    BOOST_CHECK_EQUAL(read_block.nVersion, 1);
 
     // During reindex, the flat file block storage will not be written to.
     // UpdateBlockInfo will, however, update the blockfile metadata.
@@ -198,4 +215,36 @@ BOOST_AUTO_TEST_CASE(blockmanager_flush_block_file)
     BOOST_CHECK_EQUAL(read_block.nVersion, 2);
 }
 
+BOOST_FIXTURE_TEST_CASE(blockmanager_load_block_index_pow_commitments, RandomXBasicTestingSetup)
+{
+    const CChainParams& params{Params()};
+    const Consensus::Params& consensus{params.GetConsensus()};
+    // More entries than are handed to the check queue at once
+    const size_t num_blocks{3000};
+
+    // An entry failing its commitment check is found whether it is in the first or the last batch
+    for (const std::optional<size_t> bad_block : {std::optional<size_t>{}, std::optional<size_t>{0}, std::optional<size_t>{num_blocks - 1}}) {
+        kernel::BlockTreeDB block_tree_db{DBParams{.path = "", .cache_bytes = 1 << 20, .memory_only = true}};
+        std::vector<uint256> hashes(num_blocks);
+        std::vector<std::unique_ptr<CBlockIndex>> blocks;
+        std::vector<const CBlockIndex*> blocks_info;
+        for (size_t i{0}; i < num_blocks; ++i) {
+            CBlockHeader header{params.GenesisBlock().GetBlockHeader()};
+            const bool valid{i != bad_block};
+            do {
+                header.hashRandomX = InsecureRand256();
+            } while (CheckProofOfWorkRandomX(header, consensus, POW_VERIFY_COMMITMENT_ONLY) != valid);
+            hashes[i] = InsecureRand256();
+            blocks.push_back(std::make_unique<CBlockIndex>(header));
+            blocks.back()->phashBlock = &hashes[i];
+            blocks_info.push_back(blocks.back().get());
+        }
+        BOOST_REQUIRE(block_tree_db.WriteBatchSync({}, 0, blocks_info));
+
+        std::map<uint256, CBlockIndex> block_index;
+        const auto inserter{[&](const uint256& hash) { return hash.IsNull() ? nullptr : &block_index[hash]; }};
+        BOOST_CHECK_EQUAL(WITH_LOCK(::cs_main, return block_tree_db.LoadBlockIndexGuts(consensus, inserter, m_interrupt)), !bad_block);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
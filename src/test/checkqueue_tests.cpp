@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <map>
 #include <mutex>
 #include <thread>
 #include <unordered_set>
@@ -78,6 +79,22 @@ struct UniqueCheck {
 };
 
 
+struct ThreadCheck {
+    static Mutex m;
+    static std::condition_variable cv;
+    static std::map<std::thread::id, size_t> checks_per_thread GUARDED_BY(m);
+    bool operator()() const
+    {
+        WAIT_LOCK(m, lock);
+        ++checks_per_thread[std::this_thread::get_id()];
+        cv.notify_all();
+        // Hold every check until a second thread has run one, so the batch
+        // only completes if other threads take part of it.
+        cv.wait(lock, []() EXCLUSIVE_LOCKS_REQUIRED(m) { return checks_per_thread.size() > 1; });
+        return true;
+    }
+};
+
 struct MemoryCheck {
     static std::atomic<size_t> fake_allocated_memory;
     bool b {false};
@@ -141,6 +158,9 @@ std::atomic<uint64_t> FrozenCleanupCheck::nFrozen{0};
 std::condition_variable FrozenCleanupCheck::cv{};
 Mutex UniqueCheck::m;
 std::unordered_multiset<size_t> UniqueCheck::results;
+Mutex ThreadCheck::m;
+std::condition_variable ThreadCheck::cv;
+std::map<std::thread::id, size_t> ThreadCheck::checks_per_thread;
 std::atomic<size_t> FakeCheckCheckCompletion::n_calls{0};
 std::atomic<size_t> MemoryCheck::fake_allocated_memory{0};
 
@@ -149,6 +169,7 @@ typedef CCheckQueue<FakeCheckCheckCompletion> Correct_Queue;
 typedef CCheckQueue<FakeCheck> Standard_Queue;
 typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
+typedef CCheckQueue<ThreadCheck> Thread_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
 
@@ -287,6 +308,25 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
 }
 
 
+// Test that the checks of a single batch are stolen and run by several threads
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing)
+{
+    auto queue = std::make_unique<Thread_Queue>(QUEUE_BATCH_SIZE, SCRIPT_CHECK_THREADS);
+    {
+        CCheckQueueControl<ThreadCheck> control(queue.get());
+        control.Add(std::vector<ThreadCheck>(100));
+        BOOST_REQUIRE(control.Wait());
+    }
+    LOCK(ThreadCheck::m);
+    BOOST_CHECK_GT(ThreadCheck::checks_per_thread.size(), 1U);
+    size_t total{0};
+    for (const auto& [id, count] : ThreadCheck::checks_per_thread) {
+        BOOST_CHECK_LT(count, 100U);
+        total += count;
+    }
+    BOOST_CHECK_EQUAL(total, 100U);
+}
+
 // Test that blocks which might allocate lots of memory free their memory aggressively.
 //
 // This test attempts to catch a pathological case where by lazily freeing
@@ -95,7 +95,9 @@ public:
     }
 
     CCoinsMap& map() const { return cacheCoins; }
+#ifndef USE_FLAT_COINS_MAP
     CoinsCachePair& sentinel() const { return m_sentinel; }
+#endif
     size_t& usage() const { return cachedCoinsUsage; }
 };
 
@@ -580,7 +582,11 @@ static void SetCoinsValue(CAmount value, Coin& coin)
     }
 }
 
+#ifdef USE_FLAT_COINS_MAP
+static size_t InsertCoinsMapEntry(CCoinsMap& map, CAmount value, char flags)
+#else
 static size_t InsertCoinsMapEntry(CCoinsMap& map, CoinsCachePair& sentinel, CAmount value, char flags)
+#endif
 {
     if (value == ABSENT) {
         assert(flags == NO_ENTRY);
@@ -591,7 +597,11 @@ static size_t InsertCoinsMapEntry(CCoinsMap& map, CoinsCachePair& sentinel, CAmo
     SetCoinsValue(value, entry.coin);
     auto inserted = map.emplace(OUTPOINT, std::move(entry));
     assert(inserted.second);
+#ifdef USE_FLAT_COINS_MAP
+    map.AddFlags(*inserted.first, flags);
+#else
     inserted.first->second.AddFlags(flags, *inserted.first, sentinel);
+#endif
     return inserted.first->second.coin.DynamicMemoryUsage();
 }
 
@@ -614,12 +624,17 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags, const C
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CoinsCachePair sentinel{};
-    sentinel.second.SelfRef(sentinel);
     CCoinsMapMemoryResource resource;
     CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+#ifdef USE_FLAT_COINS_MAP
+    auto usage{InsertCoinsMapEntry(map, value, flags)};
+    auto cursor{CoinsViewCacheCursor(usage, map, /*will_erase=*/true)};
+#else
+    CoinsCachePair sentinel{};
+    sentinel.second.SelfRef(sentinel);
     auto usage{InsertCoinsMapEntry(map, sentinel, value, flags)};
     auto cursor{CoinsViewCacheCursor(usage, sentinel, map, /*will_erase=*/true)};
+#endif
     BOOST_CHECK(view.BatchWrite(cursor, {}));
 }
 
@@ -629,7 +644,11 @@ public:
     SingleEntryCacheTest(CAmount base_value, CAmount cache_value, char cache_flags)
     {
         WriteCoinsViewEntry(base, base_value, base_value == ABSENT ? NO_ENTRY : DIRTY);
+#ifdef USE_FLAT_COINS_MAP
+        cache.usage() += InsertCoinsMapEntry(cache.map(), cache_value, cache_flags);
+#else
         cache.usage() += InsertCoinsMapEntry(cache.map(), cache.sentinel(), cache_value, cache_flags);
+#endif
     }
 
     CCoinsView root;
@@ -1089,6 +1108,60 @@ BOOST_AUTO_TEST_CASE(ccoins_flush_behavior)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_frozen_cache)
+{
+    CCoinsViewDB base{{.path = "test", .cache_bytes = 1 << 23, .memory_only = true}, {}};
+    CCoinsViewCacheTest cache{&base};
+    cache.SetBestBlock(uint256::ONE);
+
+    const COutPoint spent{Txid::FromUint256(InsecureRand256()), 0};
+    const COutPoint added{Txid::FromUint256(InsecureRand256()), 0};
+    const COutPoint unchanged{Txid::FromUint256(InsecureRand256()), 0};
+    cache.AddCoin(spent, MakeCoin(), /*possible_overwrite=*/false);
+    cache.AddCoin(unchanged, MakeCoin(), /*possible_overwrite=*/false);
+    BOOST_CHECK(cache.Flush());
+
+    BOOST_CHECK(cache.SpendCoin(spent));
+    cache.AddCoin(added, MakeCoin(), /*possible_overwrite=*/false);
+    const size_t cache_size{cache.GetCacheSize()};
+
+    // A cache on top of the frozen cache sees its coins, but does not modify it.
+    CCoinsViewFrozenCache frozen{&base, cache};
+    CCoinsViewCacheTest top{&frozen};
+    BOOST_CHECK(!top.HaveCoin(spent));
+    BOOST_CHECK(top.HaveCoin(added));
+    BOOST_CHECK(top.HaveCoin(unchanged));
+    BOOST_CHECK_EQUAL(top.GetBestBlock(), uint256::ONE);
+    BOOST_CHECK(top.SpendCoin(added));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), cache_size);
+    BOOST_CHECK_THROW(top.Flush(), std::logic_error);
+
+    // The modified coins are written without modifying the cache.
+    BOOST_CHECK(cache.WriteFlagged());
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), cache_size);
+    BOOST_CHECK(!base.HaveCoin(spent));
+    BOOST_CHECK(base.HaveCoin(added));
+
+    // Once written, spent coins are erased and the flags of the others cleared.
+    cache.ClearFlagged();
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), cache_size - 1);
+    CAmount value;
+    char flags;
+    GetCoinsMapEntry(cache.map(), value, flags, added);
+    BOOST_CHECK_EQUAL(flags, 0);
+
+    // The coins modified on top can then be flushed into the cache.
+    top.SetBackend(cache);
+    BOOST_CHECK(top.Flush());
+    BOOST_CHECK(!cache.HaveCoin(added));
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!base.HaveCoin(added));
+    BOOST_CHECK(base.HaveCoin(unchanged));
+}
+
+#ifndef USE_FLAT_COINS_MAP
 BOOST_AUTO_TEST_CASE(coins_resource_is_used)
 {
     CCoinsMapMemoryResource resource;
@@ -1113,5 +1186,6 @@ BOOST_AUTO_TEST_CASE(coins_resource_is_used)
 
     PoolResourceTester::CheckAllDataAccountedFor(resource);
 }
+#endif
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,8 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <config/bitcoin-config.h> // IWYU pragma: keep
+
 #include <coins.h>
 
 #include <boost/test/unit_test.hpp>
@@ -10,6 +12,9 @@
 
 BOOST_AUTO_TEST_SUITE(coinscachepair_tests)
 
+// The flat coins map indexes flagged entries itself instead of linking them
+#ifndef USE_FLAT_COINS_MAP
+
 static constexpr auto NUM_NODES{4};
 
 std::list<CoinsCachePair> CreatePairs(CoinsCachePair& sentinel)
@@ -215,5 +220,6 @@ BOOST_AUTO_TEST_CASE(linked_list_add_flags)
     BOOST_CHECK_EQUAL(n1.second.Next(), &sentinel);
     BOOST_CHECK_EQUAL(sentinel.second.Prev(), &n1);
 }
+#endif // USE_FLAT_COINS_MAP
 
 BOOST_AUTO_TEST_SUITE_END()
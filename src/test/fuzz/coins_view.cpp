@@ -120,8 +120,10 @@ FUZZ_TARGET(coins_view, .init = initialize_coins_view)
                 random_mutable_transaction = *opt_mutable_transaction;
             },
             [&] {
+#ifndef USE_FLAT_COINS_MAP
                 CoinsCachePair sentinel{};
                 sentinel.second.SelfRef(sentinel);
+#endif
                 size_t usage{0};
                 CCoinsMapMemoryResource resource;
                 CCoinsMap coins_map{0, SaltedOutpointHasher{/*deterministic=*/true}, CCoinsMap::key_equal{}, &resource};
@@ -140,12 +142,20 @@ FUZZ_TARGET(coins_view, .init = initialize_coins_view)
                         coins_cache_entry.coin = *opt_coin;
                     }
                     auto it{coins_map.emplace(random_out_point, std::move(coins_cache_entry)).first};
+#ifdef USE_FLAT_COINS_MAP
+                    coins_map.AddFlags(*it, flags);
+#else
                     it->second.AddFlags(flags, *it, sentinel);
+#endif
                     usage += it->second.coin.DynamicMemoryUsage();
                 }
                 bool expected_code_path = false;
                 try {
+#ifdef USE_FLAT_COINS_MAP
+                    auto cursor{CoinsViewCacheCursor(usage, coins_map, /*will_erase=*/true)};
+#else
                     auto cursor{CoinsViewCacheCursor(usage, sentinel, coins_map, /*will_erase=*/true)};
+#endif
                     coins_view_cache.BatchWrite(cursor, fuzzed_data_provider.ConsumeBool() ? ConsumeUInt256(fuzzed_data_provider) : coins_view_cache.GetBestBlock());
                     expected_code_path = true;
                 } catch (const std::logic_error& e) {
@@ -8,6 +8,7 @@
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
+#include <consensus/validation.h>
 #include <node/miner.h>
 #include <policy/policy.h>
 #include <test/util/random.h>
@@ -18,7 +19,9 @@
 #include <util/strencodings.h>
 #include <util/time.h>
 #include <util/translation.h>
+#include <util/vector.h>
 #include <validation.h>
+#include <validationinterface.h>
 #include <versionbits.h>
 
 #include <test/util/setup_common.h>
@@ -658,4 +661,86 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     TestPrioritisedMining(scriptPubKey, txFirst);
 }
 
+BOOST_FIXTURE_TEST_CASE(block_template_cache, TestChain100Setup)
+{
+    const CScript script_pub_key{CScript() << OP_TRUE};
+    const CScript output_script{GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()))};
+    node::BlockTemplateCache cache{*m_node.chainman, *m_node.mempool, BlockAssembler::Options{}, m_node.validation_signals.get()};
+
+    // Check that the cached template holds the given transactions, and is valid
+    const auto check_template{[&](const std::vector<CMutableTransaction>& txs) {
+        m_node.validation_signals->SyncWithValidationInterfaceQueue();
+        const auto block_template{cache.Get(script_pub_key)};
+        CBlock block{block_template->block};
+        BOOST_CHECK(block.vtx[0]->vout[0].scriptPubKey == script_pub_key);
+        BOOST_REQUIRE_EQUAL(block.vtx.size(), txs.size() + 1);
+        CAmount fees{0};
+        for (size_t i = 0; i < txs.size(); ++i) {
+            BOOST_CHECK_EQUAL(block.vtx[i + 1]->GetHash(), txs[i].GetHash());
+            fees += block_template->vTxFees[i + 1];
+        }
+        BOOST_CHECK_EQUAL(block_template->vTxFees[0], -fees);
+        LOCK(cs_main);
+        CBlockIndex* tip{m_node.chainman->ActiveChain().Tip()};
+        BOOST_CHECK_EQUAL(block.hashPrevBlock, tip->GetBlockHash());
+        BOOST_CHECK_EQUAL(block.vtx[0]->vout[0].nValue, GetBlockSubsidy(tip->nHeight + 1, m_node.chainman->GetConsensus()) + fees);
+        block.hashMerkleRoot = BlockMerkleRoot(block);
+        BlockValidationState state;
+        BOOST_CHECK(TestBlockValidity(state, m_node.chainman->GetParams(), m_node.chainman->ActiveChainstate(), block, tip, /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/true));
+    }};
+
+    check_template({});
+
+    // Transactions entering the mempool are appended, along with their children
+    const CMutableTransaction tx1{CreateValidMempoolTransaction({m_coinbase_txns[0]}, {COutPoint{m_coinbase_txns[0]->GetHash(), 0}}, 1, {coinbaseKey},
+                                                                {CTxOut{24 * COIN, output_script}, CTxOut{24 * COIN, output_script}})};
+    check_template({tx1});
+    const CMutableTransaction tx2{CreateValidMempoolTransaction(MakeTransactionRef(tx1), 0, 101, coinbaseKey, output_script, 23 * COIN)};
+    const CMutableTransaction tx3{CreateValidMempoolTransaction(MakeTransactionRef(tx1), 1, 101, coinbaseKey, output_script, 23 * COIN)};
+    check_template({tx1, tx2, tx3});
+
+    // The template is rebuilt when one of its transactions leaves the mempool
+    {
+        LOCK2(cs_main, m_node.mempool->cs);
+        m_node.mempool->removeRecursive(CTransaction{tx2}, MemPoolRemovalReason::CONFLICT);
+    }
+    check_template({tx1, tx3});
+
+    // ... and when the tip changes
+    CreateAndProcessBlock({tx1}, script_pub_key);
+    check_template({tx3});
+}
+
+BOOST_FIXTURE_TEST_CASE(block_template_cache_max_weight, TestChain100Setup)
+{
+    // Spends of segwit outputs, whose weight is usually less than four times their virtual size
+    const CScript segwit_script{GetScriptForDestination(WitnessV0KeyHash(coinbaseKey.GetPubKey()))};
+    const CScript output_script{GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()))};
+    const CMutableTransaction parent{CreateValidMempoolTransaction({m_coinbase_txns[0]}, {COutPoint{m_coinbase_txns[0]->GetHash(), 0}}, 1, {coinbaseKey},
+                                                                   std::vector<CTxOut>(3, CTxOut{16 * COIN, segwit_script}), /*submit=*/false)};
+    std::vector<CMutableTransaction> children;
+    for (uint32_t i = 0; i < 3; ++i) {
+        children.push_back(CreateValidMempoolTransaction(MakeTransactionRef(parent), i, 101, coinbaseKey, output_script, 15 * COIN, /*submit=*/false));
+    }
+
+    // Only the parent and the first two children fit below -blockmaxweight
+    BlockAssembler::Options options;
+    options.nBlockMaxWeight = options.coinbase_max_additional_weight + GetTransactionWeight(CTransaction{parent}) +
+                              GetTransactionWeight(CTransaction{children[0]}) + GetTransactionWeight(CTransaction{children[1]}) + 1;
+    node::BlockTemplateCache cache{*m_node.chainman, *m_node.mempool, options, m_node.validation_signals.get()};
+    BOOST_CHECK_EQUAL(cache.Get(CScript{})->block.vtx.size(), 1U);
+
+    // The transactions are appended to the cached template as they enter the mempool
+    for (const CMutableTransaction& tx : Cat({parent}, children)) {
+        const MempoolAcceptResult result{WITH_LOCK(cs_main, return m_node.chainman->ProcessTransaction(MakeTransactionRef(tx)))};
+        BOOST_REQUIRE(result.m_result_type == MempoolAcceptResult::ResultType::VALID);
+    }
+    m_node.validation_signals->SyncWithValidationInterfaceQueue();
+    const auto block_template{cache.Get(CScript{})};
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 4U);
+    BOOST_CHECK_EQUAL(block_template->block.vtx[1]->GetHash(), parent.GetHash());
+    BOOST_CHECK_EQUAL(block_template->block.vtx[2]->GetHash(), children[0].GetHash());
+    BOOST_CHECK_EQUAL(block_template->block.vtx[3]->GetHash(), children[1].GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,12 +2,20 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or https://www.opensource.org/licenses/mit-license.php.
 
+#include <blockencodings.h>
 #include <chainparams.h>
+#include <consensus/merkle.h>
 #include <node/miner.h>
 #include <net_processing.h>
+#include <netbase.h>
+#include <netmessagemaker.h>
 #include <pow.h>
+#include <protocol.h>
+#include <test/util/net.h>
+#include <test/util/random.h>
 #include <test/util/setup_common.h>
 #include <validation.h>
+#include <versionbits.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -74,4 +82,89 @@ BOOST_AUTO_TEST_CASE(connections_desirable_service_flags)
     BOOST_CHECK(peerman->GetDesirableServiceFlags(peer_flags) == ServiceFlags(NODE_NETWORK | NODE_WITNESS));
 }
 
+struct FastCmpctBlockRelaySetup : public TestingSetup {
+    FastCmpctBlockRelaySetup() : TestingSetup{ChainType::SNAILCOINREGTEST, {.extra_args = {"-fastcmpctblockrelay=1"}}} {}
+};
+
+BOOST_FIXTURE_TEST_CASE(fast_cmpctblock_relay_disconnects_noban_peer, FastCmpctBlockRelaySetup)
+{
+    LOCK(NetEventsInterface::g_msgproc_mutex);
+    auto& connman{static_cast<ConnmanTestMsg&>(*m_node.connman)};
+    ChainstateManager& chainman{*m_node.chainman};
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return chainman.ActiveChain().Tip())};
+    m_node.validation_signals->RegisterValidationInterface(m_node.peerman.get());
+
+    // Compact blocks are only relayed before verifying their RandomX hash after initial block download
+    SetMockTime(tip->GetBlockTime() + 1200);
+    BOOST_REQUIRE(!chainman.IsInitialBlockDownload());
+
+    // A block on the tip whose RandomX hash is wrong, but whose commitment meets the target
+    const auto make_block{[&](uint32_t time) {
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vin[0].scriptSig = CScript() << (tip->nHeight + 1) << OP_0;
+        coinbase.vout.emplace_back(0, CScript() << OP_TRUE);
+        CBlock block;
+        block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+        block.nVersion = VERSIONBITS_TOP_BITS;
+        block.hashPrevBlock = tip->GetBlockHash();
+        block.hashMerkleRoot = BlockMerkleRoot(block);
+        block.nTime = time;
+        block.nBits = tip->nBits;
+        do {
+            block.hashRandomX = InsecureRand256();
+        } while (!CheckProofOfWorkRandomX(block, chainman.GetConsensus(), POW_VERIFY_COMMITMENT_ONLY));
+        return block;
+    }};
+    const auto add_peer{[&](NodeId id) {
+        CNode* node{new CNode{id,
+                              /*sock=*/nullptr,
+                              CAddress{LookupNumeric("1.2.3.4", Params().GetDefaultPort()), NODE_NONE},
+                              /*nKeyedNetGroupIn=*/0,
+                              /*nLocalHostNonceIn=*/0,
+                              CAddress(),
+                              /*addrNameIn=*/"",
+                              ConnectionType::INBOUND,
+                              /*inbound_onion=*/false,
+                              CNodeOptions{.permission_flags = NetPermissionFlags::NoBan}}};
+        connman.AddTestNode(*node);
+        connman.Handshake(*node, /*successfully_connected=*/true, ServiceFlags(NODE_NETWORK | NODE_WITNESS),
+                          ServiceFlags(NODE_NETWORK | NODE_WITNESS), PROTOCOL_VERSION, /*relay_txs=*/true);
+        return node;
+    }};
+    const auto send_block{[&](CNode& node, const CBlock& block) {
+        connman.FlushSendBuffer(node);
+        (void)connman.ReceiveMsgFrom(node, NetMsg::Make(NetMsgType::CMPCTBLOCK, CBlockHeaderAndShortTxIDs{block, /*nonce=*/0}));
+        node.fPauseSend = false;
+        connman.ProcessMessagesOnce(node);
+    }};
+
+    // The header is accepted unverified from a noban peer, and the peer is disconnected once the block fails
+    // the check, although it is not otherwise punished
+    CNode* node{add_peer(0)};
+    const CBlock block{make_block(tip->nTime + 1200)};
+    const uint64_t verify_count{GetRandomXVerifyCount()};
+    send_block(*node, block);
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 1U);
+    {
+        LOCK(::cs_main);
+        const CBlockIndex* pindex{chainman.m_blockman.LookupBlockIndex(block.GetHash())};
+        BOOST_REQUIRE(pindex);
+        BOOST_CHECK(pindex->nStatus & BLOCK_FAILED_VALID);
+    }
+    BOOST_CHECK(node->fDisconnect);
+    m_node.peerman->FinalizeNode(*node);
+
+    // Once it reconnects, its headers are verified before being accepted
+    node = add_peer(1);
+    const CBlock block2{make_block(tip->nTime + 1201)};
+    send_block(*node, block2);
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 2U);
+    BOOST_CHECK(!WITH_LOCK(::cs_main, return chainman.m_blockman.LookupBlockIndex(block2.GetHash())));
+    BOOST_CHECK(!node->fDisconnect);
+    m_node.peerman->FinalizeNode(*node);
+    connman.ClearTestNodes();
+    m_node.validation_signals->UnregisterValidationInterface(m_node.peerman.get());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,13 +7,22 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <pow.h>
+#include <powverifyqueue.h>
+#include <sync.h>
 #include <test/util/random.h>
 #include <test/util/setup_common.h>
 #include <util/chaintype.h>
+#include <util/fs.h>
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
+#include <set>
+#include <thread>
+#include <vector>
 
 
 BOOST_FIXTURE_TEST_SUITE(pow_tests, BasicTestingSetup)
@@ -364,6 +373,311 @@ BOOST_AUTO_TEST_CASE(Check_RandomX_BlockHeader)
     BOOST_CHECK_NE(cm, uint256S("00000922ba3e0d5f9aa758a22dd73165912c858f50673a34b07a3ccdbe6e8dcb"));
 }
 
+/** Solve the regtest genesis header at runtime, so that the header is known to verify */
+static CBlockHeader SolveRandomXHeader(const CChainParams& chain_params)
+{
+    CBlockHeader header = chain_params.GenesisBlock().GetBlockHeader();
+    header.nNonce = 0;
+    header.hashRandomX.SetNull();
+    uint64_t max_tries{1000};
+    BOOST_REQUIRE(MineRandomX(header, chain_params.GetConsensus(), 1, max_tries, [] { return false; }));
+    return header;
+}
+
+BOOST_AUTO_TEST_CASE(Check_PowVerifyQueue)
+{
+    m_node.args->ForceSetArg("-randomxfastmode", "0");
+
+    const auto chainParams = CreateChainParams(*m_node.args, ChainType::SNAILCOINREGTEST);
+    const auto consensus = chainParams->GetConsensus();
+    g_isRandomX = true;
+
+    // Valid header, and a header whose fake RandomX hash meets the target but fails full verification
+    const CBlockHeader valid = SolveRandomXHeader(*chainParams);
+    CBlockHeader invalid = valid;
+    do {
+        invalid.hashRandomX = InsecureRand256();
+    } while (!CheckProofOfWorkRandomX(invalid, consensus, POW_VERIFY_COMMITMENT_ONLY));
+
+    for (int worker_threads : {0, 2}) {
+        PowVerifyQueue queue{consensus, worker_threads};
+        BOOST_CHECK(queue.Add(valid));
+        BOOST_CHECK(queue.Add(invalid));
+        BOOST_CHECK(queue.Add(valid)); // duplicate is ignored
+
+        BOOST_CHECK(queue.Take(valid.GetHash()) == std::optional<bool>{true});
+        BOOST_CHECK(queue.Take(invalid.GetHash()) == std::optional<bool>{false});
+
+        // Results can only be taken once, and unknown blocks have no result
+        BOOST_CHECK(!queue.Take(valid.GetHash()).has_value());
+        BOOST_CHECK(!queue.Take(uint256::ONE).has_value());
+
+        // Nothing can be queued after the queue has been stopped
+        queue.StopWorkerThreads();
+        BOOST_CHECK(!queue.Add(valid));
+    }
+
+    g_isRandomX = false;
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_MemoryInfo)
+{
+    m_node.args->ForceSetArg("-randomxfastmode", "0");
+
+    const auto chainParams = CreateChainParams(*m_node.args, ChainType::SNAILCOINREGTEST);
+    const auto consensus = chainParams->GetConsensus();
+    const CBlockHeader header = SolveRandomXHeader(*chainParams);
+    BOOST_CHECK(CheckProofOfWorkRandomX(header, consensus, POW_VERIFY_FULL));
+
+    // The genesis epoch has a light mode cache and at least one VM, and no dataset
+    const RandomXMemoryInfo info = GetRandomXMemoryInfo();
+    BOOST_CHECK_GE(info.epochs, 1U);
+    BOOST_CHECK_GE(info.caches, 1U);
+    BOOST_CHECK_GE(info.vms, 1U);
+    BOOST_CHECK_EQUAL(info.datasets, 0U);
+    BOOST_CHECK_EQUAL(info.TotalBytes(), info.cache_bytes + info.vm_bytes);
+    BOOST_CHECK_EQUAL(info.max_bytes, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_Mining)
+{
+    m_node.args->ForceSetArg("-randomxfastmode", "0");
+
+    const auto chainParams = CreateChainParams(*m_node.args, ChainType::SNAILCOINREGTEST);
+    const auto consensus = chainParams->GetConsensus();
+    const auto no_interrupt = [] { return false; };
+
+    CBlockHeader header = chainParams->GenesisBlock().GetBlockHeader();
+    header.nNonce = 0;
+    header.hashRandomX.SetNull();
+
+    // The lowest solution is found whatever the number of threads
+    std::optional<uint32_t> nonce;
+    for (int threads : {1, 4}) {
+        CBlockHeader block = header;
+        uint64_t max_tries{1000};
+        std::atomic<uint64_t> hashes{0};
+        BOOST_CHECK(MineRandomX(block, consensus, threads, max_tries, no_interrupt, &hashes));
+        BOOST_CHECK(CheckProofOfWorkRandomX(block, consensus, POW_VERIFY_FULL));
+        BOOST_CHECK_GE(hashes.load(), uint64_t{block.nNonce} + 1);
+        if (nonce) BOOST_CHECK_EQUAL(block.nNonce, *nonce);
+        nonce = block.nNonce;
+    }
+
+    // Nothing is tried without tries left
+    uint64_t max_tries{0};
+    CBlockHeader block = header;
+    BOOST_CHECK(!MineRandomX(block, consensus, 2, max_tries, no_interrupt));
+    BOOST_CHECK(block.hashRandomX.IsNull());
+
+    // The nonces up to the maximum are tried when more tries are allowed than fit in the nonce range. The target
+    // is too low for a solution to be found.
+    header.nBits = 0x03000001;
+    block = header;
+    block.nNonce = std::numeric_limits<uint32_t>::max() - 9;
+    max_tries = std::numeric_limits<uint64_t>::max();
+    BOOST_CHECK(!MineRandomX(block, consensus, 2, max_tries, no_interrupt));
+    BOOST_CHECK_EQUAL(block.nNonce, std::numeric_limits<uint32_t>::max());
+    BOOST_CHECK_EQUAL(max_tries, std::numeric_limits<uint64_t>::max() - 10);
+
+    // When interrupted, mining resumes from the lowest nonce not tried, although threads stop in the middle of
+    // their batch as soon as one of them is interrupted
+    block = header;
+    max_tries = 100 * RANDOMX_MINING_BATCH;
+    std::atomic<uint64_t> hashes{0};
+    BOOST_CHECK(!MineRandomX(block, consensus, 4, max_tries, [] { return true; }, &hashes));
+    BOOST_CHECK_GE(block.nNonce, 1U);
+    BOOST_CHECK_LE(block.nNonce, hashes.load());
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_HashCache)
+{
+    m_node.args->ForceSetArg("-randomxfastmode", "0");
+
+    const auto chainParams = CreateChainParams(*m_node.args, ChainType::SNAILCOINREGTEST);
+    const auto consensus = chainParams->GetConsensus();
+    // A header not verified by other tests
+    CBlockHeader valid = chainParams->GenesisBlock().GetBlockHeader();
+    valid.hashMerkleRoot = InsecureRand256();
+    uint64_t max_tries{1000};
+    BOOST_REQUIRE(MineRandomX(valid, consensus, 1, max_tries, [] { return false; }));
+    CBlockHeader invalid = valid;
+    do {
+        invalid.hashRandomX = InsecureRand256();
+    } while (!CheckProofOfWorkRandomX(invalid, consensus, POW_VERIFY_COMMITMENT_ONLY));
+
+    // A verified header is only hashed once
+    const uint64_t verify_count = GetRandomXVerifyCount();
+    BOOST_CHECK(CheckProofOfWorkRandomX(valid, consensus, POW_VERIFY_FULL));
+    BOOST_CHECK(CheckProofOfWorkRandomX(valid, consensus, POW_VERIFY_FULL));
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 1U);
+
+    // A header failing verification is hashed each time, and not accepted because of the valid one
+    BOOST_CHECK(!CheckProofOfWorkRandomX(invalid, consensus, POW_VERIFY_FULL));
+    BOOST_CHECK(!CheckProofOfWorkRandomX(invalid, consensus, POW_VERIFY_FULL));
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 3U);
+
+    // Mining computes the hash even if it was verified
+    uint256 hash;
+    BOOST_CHECK(CheckProofOfWorkRandomX(valid, consensus, POW_VERIFY_MINING, &hash));
+    BOOST_CHECK_EQUAL(hash, valid.hashRandomX);
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_VMPool)
+{
+    m_node.args->ForceSetArg("-randomxfastmode", "0");
+    // Fewer VMs than hashing threads, so that threads wait for each other's VMs
+    m_node.args->ForceSetArg("-randomxvmpoolsize", "2");
+
+    const auto chainParams = CreateChainParams(*m_node.args, ChainType::SNAILCOINREGTEST);
+    const auto consensus = chainParams->GetConsensus();
+
+    // Headers of an epoch not used by other tests, so that its pool is created with this size
+    std::vector<CBlockHeader> headers(32);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        headers[i].nTime = 6 * consensus.nRandomXEpochDuration + 1;
+        headers[i].nNonce = i;
+    }
+    std::vector<uint256> expected;
+    for (const CBlockHeader& header : headers) {
+        expected.push_back(*Assert(CalculateRandomXHash(header, consensus)));
+    }
+
+    // Hashes computed concurrently are the same as those computed one after another
+    std::vector<std::optional<uint256>> hashes(headers.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < headers.size(); i += 4) {
+                hashes[i] = CalculateRandomXHash(headers[i], consensus);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (size_t i = 0; i < headers.size(); ++i) {
+        BOOST_CHECK(hashes[i] == expected[i]);
+    }
+
+    m_node.args->ForceSetArg("-randomxvmpoolsize", "0");
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_LargePages)
+{
+    m_node.args->ForceSetArg("-randomxfastmode", "0");
+
+    const auto chainParams = CreateChainParams(*m_node.args, ChainType::SNAILCOINREGTEST);
+    const auto consensus = chainParams->GetConsensus();
+    const auto epoch_header = [&](uint32_t epoch) {
+        CBlockHeader header;
+        header.nTime = epoch * consensus.nRandomXEpochDuration + 1;
+        return header;
+    };
+
+    // The cache and VMs of an epoch not used by other tests are allocated with large pages, or with regular
+    // pages if large pages are not available
+    m_node.args->ForceSetArg("-randomxlargepages", "1");
+    const std::optional<uint256> large_pages = CalculateRandomXHash(epoch_header(9), consensus);
+    m_node.args->ForceSetArg("-randomxlargepages", "0");
+    BOOST_REQUIRE(large_pages);
+
+    // Once the epoch has been evicted by two others, it is created again with regular pages, with the same hash
+    BOOST_CHECK(CalculateRandomXHash(epoch_header(10), consensus));
+    BOOST_CHECK(CalculateRandomXHash(epoch_header(11), consensus));
+    BOOST_CHECK(CalculateRandomXHash(epoch_header(9), consensus) == large_pages);
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_NumaCpuList)
+{
+    BOOST_CHECK(ParseNumaCpuList("0") == std::vector<int>({0}));
+    BOOST_CHECK(ParseNumaCpuList("0-3,8,10-11\n") == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    BOOST_CHECK(ParseNumaCpuList("").empty());
+    // Malformed ranges are skipped
+    BOOST_CHECK(ParseNumaCpuList("x,2-3") == std::vector<int>({2, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_PrebuildEpoch)
+{
+    const uint32_t duration{24 * 60 * 60};
+    const int64_t boundary{10 * duration};
+
+    // The next epoch is prebuilt once its start is within the lead time
+    BOOST_CHECK(!GetRandomXPrebuildEpoch(boundary - 61 * 60, 60, duration));
+    BOOST_CHECK(GetRandomXPrebuildEpoch(boundary - 60 * 60, 60, duration) == std::optional<uint32_t>{10});
+    BOOST_CHECK(GetRandomXPrebuildEpoch(boundary - 1, 60, duration) == std::optional<uint32_t>{10});
+
+    // Not once it has started, nor without a lead time
+    BOOST_CHECK(!GetRandomXPrebuildEpoch(boundary, 60, duration));
+    BOOST_CHECK(!GetRandomXPrebuildEpoch(boundary - 1, 0, duration));
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_DatasetInit)
+{
+    // Each item is initialized exactly once, by one thread per range, whatever the number of threads
+    for (const unsigned long items : {1UL, 7UL, 200000UL}) {
+        for (const int threads : {1, 3, 8}) {
+            std::vector<std::atomic<int>> inits(items);
+            Mutex mutex;
+            std::set<std::thread::id> thread_ids;
+            InitRandomXDatasetRanges(items, threads, [&](unsigned long start, unsigned long count) {
+                for (unsigned long i = start; i < start + count; ++i) ++inits[i];
+                LOCK(mutex);
+                thread_ids.insert(std::this_thread::get_id());
+            });
+            BOOST_CHECK(std::all_of(inits.begin(), inits.end(), [](const std::atomic<int>& n) { return n == 1; }));
+            BOOST_CHECK_EQUAL(thread_ids.size(), std::min<unsigned long>(items, threads));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Check_RandomX_DatasetFile)
+{
+    // A small stand-in for the dataset, as the file does not depend on its contents
+    const std::vector<unsigned char> dataset{g_insecure_rand_ctx.randbytes(4096)};
+    std::vector<unsigned char> loaded(dataset.size());
+    const fs::path path = GetRandomXDatasetPath(1);
+
+    BOOST_CHECK(WriteRandomXDataset(1, dataset, 2));
+    BOOST_CHECK(ReadRandomXDataset(1, loaded, 2));
+    BOOST_CHECK(loaded == dataset);
+
+    // A file for another dataset size is rejected and deleted
+    std::vector<unsigned char> larger(dataset.size() + 64);
+    BOOST_CHECK(!ReadRandomXDataset(1, larger, 2));
+    BOOST_CHECK(!fs::exists(path));
+
+    // So is a corrupted file
+    BOOST_CHECK(WriteRandomXDataset(1, dataset, 2));
+    FILE* file = fsbridge::fopen(path, "r+b");
+    BOOST_REQUIRE(file);
+    BOOST_REQUIRE_EQUAL(std::fseek(file, -1, SEEK_END), 0);
+    std::fputc(dataset.back() ^ 1, file);
+    std::fclose(file);
+    BOOST_CHECK(!ReadRandomXDataset(1, loaded, 2));
+    BOOST_CHECK(!fs::exists(path));
+
+    // There is nothing left to read
+    BOOST_CHECK(!ReadRandomXDataset(1, loaded, 2));
+
+    // Writing a dataset removes the dataset files of other epochs than the previous and next ones, but neither
+    // their temporary files nor unrelated files
+    const fs::path far_path{GetRandomXDatasetPath(5)};
+    const fs::path far_tmp_path{fs::PathFromString(fs::PathToString(far_path) + ".new")};
+    const fs::path other_path{far_path.parent_path() / "other.dat"};
+    for (const fs::path& p : {GetRandomXDatasetPath(2), far_path, far_tmp_path, other_path}) {
+        FILE* f{fsbridge::fopen(p, "wb")};
+        BOOST_REQUIRE(f);
+        std::fclose(f);
+    }
+    BOOST_CHECK(WriteRandomXDataset(1, dataset, 2));
+    BOOST_CHECK(fs::exists(path));
+    BOOST_CHECK(fs::exists(GetRandomXDatasetPath(2)));
+    BOOST_CHECK(!fs::exists(far_path));
+    BOOST_CHECK(fs::exists(far_tmp_path));
+    BOOST_CHECK(fs::exists(other_path));
+}
+
 
 // !BITCOINCASH
 
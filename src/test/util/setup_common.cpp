@@ -23,6 +23,7 @@
 #include <net_processing.h>
 #include <node/blockstorage.h>
 #include <node/chainstate.h>
+#include <node/chainstatemanager_args.h>
 #include <node/context.h>
 #include <node/kernel_notifications.h>
 #include <node/mempool_args.h>
@@ -189,6 +190,8 @@ BasicTestingSetup::BasicTestingSetup(const ChainType chainType, TestOpts opts)
     gArgs.ForceSetArg("-datadir", fs::PathToString(m_path_root));
 
     SelectParams(chainType);
+    // As in AppInitMain(), block hashes commit to the RandomX hash on RandomX chains
+    if (Params().GetConsensus().fPowRandomX) g_isRandomX = true;
     if (G_TEST_LOG_FUN) LogInstance().PushBackCallback(G_TEST_LOG_FUN);
     InitLogging(*m_node.args);
     AppInitParameterInteraction(*m_node.args);
@@ -211,6 +214,7 @@ BasicTestingSetup::~BasicTestingSetup()
     m_node.ecc_context.reset();
     m_node.kernel.reset();
     SetMockTime(0s); // Reset mocktime for following tests
+    g_isRandomX = false;
     LogInstance().DisconnectTestLogger();
     if (m_has_custom_datadir) {
         // Only remove the lock file, preserve the data directory.
@@ -253,6 +257,9 @@ ChainTestingSetup::ChainTestingSetup(const ChainType chainType, TestOpts opts)
             .notifications = *m_node.notifications,
             .signals = m_node.validation_signals.get(),
             .worker_threads_num = 2,
+            .coins_prefetch_threads_num = static_cast<int>(m_node.args->GetIntArg("-prefetchthreads", DEFAULT_COINS_PREFETCH_THREADS)),
+            .script_check_pipeline_blocks = static_cast<int>(m_node.args->GetIntArg("-scriptcheckpipeline", DEFAULT_SCRIPT_CHECK_PIPELINE_BLOCKS)),
+            .background_coins_flush = m_node.args->GetBoolArg("-backgroundcoinsflush", DEFAULT_BACKGROUND_COINS_FLUSH),
         };
         if (opts.min_validation_cache) {
             chainman_opts.script_execution_cache_bytes = 0;
@@ -10,6 +10,7 @@
 #include <node/miner.h>
 #include <pow.h>
 #include <random.h>
+#include <test/util/logging.h>
 #include <test/util/random.h>
 #include <test/util/script.h>
 #include <test/util/setup_common.h>
@@ -22,13 +23,19 @@
 using node::BlockAssembler;
 
 namespace validation_block_tests {
-struct MinerTestingSetup : public RegTestingSetup {
+struct MinerTestingSetup : public TestingSetup {
+    explicit MinerTestingSetup(TestOpts opts = {}) : TestingSetup{ChainType::REGTEST, opts} {}
     std::shared_ptr<CBlock> Block(const uint256& prev_hash);
     std::shared_ptr<const CBlock> GoodBlock(const uint256& prev_hash);
     std::shared_ptr<const CBlock> BadBlock(const uint256& prev_hash);
     std::shared_ptr<CBlock> FinalizeBlock(std::shared_ptr<CBlock> pblock);
     void BuildChain(const uint256& root, int height, const unsigned int invalid_rate, const unsigned int branch_rate, const unsigned int max_size, std::vector<std::shared_ptr<const CBlock>>& blocks);
 };
+
+//! Pipelines the script checks of up to four blocks during initial block download
+struct ScriptCheckPipelineTestingSetup : public MinerTestingSetup {
+    ScriptCheckPipelineTestingSetup() : MinerTestingSetup{{.extra_args = {"-scriptcheckpipeline=4"}}} {}
+};
 } // namespace validation_block_tests
 
 BOOST_FIXTURE_TEST_SUITE(validation_block_tests, MinerTestingSetup)
@@ -325,6 +332,75 @@ BOOST_AUTO_TEST_CASE(mempool_locks_reorg)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(deferred_script_checks, ScriptCheckPipelineTestingSetup)
+{
+    ChainstateManager& chainman{*Assert(m_node.chainman)};
+    BOOST_REQUIRE(chainman.IsInitialBlockDownload());
+    bool ignored;
+    auto ProcessBlock = [&](std::shared_ptr<const CBlock> block) -> bool {
+        return chainman.ProcessNewBlock(block, /*force_processing=*/true, /*min_pow_checked=*/true, /*new_block=*/&ignored);
+    };
+    auto Tip = [&]() { return WITH_LOCK(chainman.GetMutex(), return chainman.ActiveChain().Tip()->GetBlockHash()); };
+    auto Index = [&](const CBlock& block) {
+        return WITH_LOCK(chainman.GetMutex(), return chainman.m_blockman.LookupBlockIndex(block.GetHash()));
+    };
+    // Block spending the P2WSH_OP_TRUE output of the given coinbase
+    auto SpendingBlock = [&](const uint256& prev_hash, const CBlock& coinbase_block, bool valid) {
+        CMutableTransaction mtx;
+        mtx.vin.emplace_back(COutPoint{coinbase_block.vtx[0]->GetHash(), 1}, CScript{});
+        mtx.vin[0].scriptWitness.stack.push_back(valid ? WITNESS_STACK_ELEM_OP_TRUE : std::vector<unsigned char>{OP_FALSE});
+        mtx.vout.push_back(coinbase_block.vtx[0]->vout[1]);
+        mtx.vout[0].nValue -= 1000;
+        auto pblock = Block(prev_hash);
+        pblock->vtx.push_back(MakeTransactionRef(mtx));
+        return std::shared_ptr<const CBlock>{FinalizeBlock(pblock)};
+    };
+
+    BOOST_REQUIRE(ProcessBlock(std::make_shared<CBlock>(Params().GenesisBlock())));
+    std::vector<std::shared_ptr<const CBlock>> chain;
+    chain.push_back(GoodBlock(Params().GenesisBlock().GetHash()));
+    BOOST_REQUIRE(ProcessBlock(chain.back()));
+    for (int i = 0; i < COINBASE_MATURITY; ++i) {
+        chain.push_back(GoodBlock(chain.back()->GetHash()));
+        BOOST_REQUIRE(ProcessBlock(chain.back()));
+    }
+    const uint256 fork_hash{chain.back()->GetHash()};
+    BOOST_CHECK_EQUAL(Tip(), fork_hash);
+
+    // An invalid script is followed by valid blocks, which are all connected
+    // in one step and disconnected again when the script checks are joined
+    std::vector<std::shared_ptr<const CBlock>> invalid_chain{SpendingBlock(fork_hash, *chain[0], /*valid=*/false)};
+    for (int i = 0; i < 4; ++i) {
+        invalid_chain.push_back(GoodBlock(invalid_chain.back()->GetHash()));
+    }
+    for (size_t i = 1; i < invalid_chain.size(); ++i) {
+        ProcessBlock(invalid_chain[i]);
+    }
+    BOOST_CHECK_EQUAL(Tip(), fork_hash);
+    {
+        ASSERT_DEBUG_LOG("Deferred script checks of blocks 102 to 105 failed");
+        ProcessBlock(invalid_chain[0]);
+    }
+    BOOST_CHECK_EQUAL(Tip(), fork_hash);
+    const CBlockIndex* invalid_index{Index(*invalid_chain[0])};
+    BOOST_CHECK(WITH_LOCK(chainman.GetMutex(), return invalid_index->nStatus & BLOCK_FAILED_VALID));
+
+    // Valid blocks are connected, and marked as such once their script checks have passed
+    std::vector<std::shared_ptr<const CBlock>> valid_chain{GoodBlock(fork_hash)};
+    for (int i = 0; i < 10; ++i) {
+        valid_chain.push_back(i == 7 ? SpendingBlock(valid_chain.back()->GetHash(), *chain[1], /*valid=*/true) : GoodBlock(valid_chain.back()->GetHash()));
+    }
+    for (size_t i = 1; i < valid_chain.size(); ++i) {
+        ProcessBlock(valid_chain[i]);
+    }
+    ProcessBlock(valid_chain[0]);
+    BOOST_CHECK_EQUAL(Tip(), valid_chain.back()->GetHash());
+    for (const auto& block : valid_chain) {
+        const CBlockIndex* index{Index(*block)};
+        BOOST_CHECK(WITH_LOCK(chainman.GetMutex(), return index->IsValid(BLOCK_VALID_SCRIPTS)));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(witness_commitment_index)
 {
     LOCK(Assert(m_node.chainman)->GetMutex());
@@ -3,9 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 //
 #include <chainparams.h>
+#include <coins.h>
 #include <consensus/validation.h>
+#include <primitives/transaction.h>
 #include <random.h>
 #include <rpc/blockchain.h>
+#include <script/script.h>
 #include <sync.h>
 #include <test/util/chainstate.h>
 #include <test/util/coins.h>
@@ -62,6 +65,89 @@ BOOST_AUTO_TEST_CASE(validation_chainstate_resize_caches)
     }
 }
 
+struct PrefetchTestingSetup : public TestChain100Setup {
+    PrefetchTestingSetup() : TestChain100Setup{ChainType::REGTEST, {.extra_args = {"-prefetchthreads=2"}}} {}
+};
+
+//! Test that the coins spent by a block are read into the coins cache before it is connected.
+BOOST_FIXTURE_TEST_CASE(chainstate_prefetch_coins, PrefetchTestingSetup)
+{
+    Chainstate& chainstate{Assert(m_node.chainman)->ActiveChainstate()};
+    BOOST_REQUIRE(m_node.chainman->GetCoinsPrefetchQueue().HasThreads());
+
+    const COutPoint coinbase_outpoint{m_coinbase_txns[0]->GetHash(), 0};
+    CMutableTransaction spend;
+    spend.vin.emplace_back(coinbase_outpoint);
+    spend.vout.emplace_back(m_coinbase_txns[0]->vout[0].nValue, CScript{} << OP_TRUE);
+    CMutableTransaction child;
+    child.vin.emplace_back(COutPoint{spend.GetHash(), 0});
+    const COutPoint missing_outpoint{Txid::FromUint256(InsecureRand256()), 0};
+    child.vin.emplace_back(missing_outpoint);
+    CBlock block;
+    block.vtx.push_back(m_coinbase_txns[1]);
+    block.vtx.push_back(MakeTransactionRef(spend));
+    block.vtx.push_back(MakeTransactionRef(child));
+
+    LOCK(::cs_main);
+    chainstate.ForceFlushStateToDisk();
+    CCoinsViewCache& cache{chainstate.CoinsTip()};
+    BOOST_CHECK(!cache.HaveCoinInCache(coinbase_outpoint));
+
+    chainstate.PrefetchCoins(block);
+    BOOST_CHECK(cache.HaveCoinInCache(coinbase_outpoint));
+    BOOST_CHECK(cache.AccessCoin(coinbase_outpoint).out == m_coinbase_txns[0]->vout[0]);
+    // Coins created by the block and missing coins are not added
+    BOOST_CHECK(!cache.HaveCoinInCache(COutPoint{spend.GetHash(), 0}));
+    BOOST_CHECK(!cache.HaveCoinInCache(missing_outpoint));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+
+    // The prefetched coin is not modified, so it can be uncached
+    cache.Uncache(coinbase_outpoint);
+    BOOST_CHECK(!cache.HaveCoinInCache(coinbase_outpoint));
+}
+
+//! Test that prefetching fills the coins cache with the coins which fetching them one by one finds.
+BOOST_FIXTURE_TEST_CASE(chainstate_prefetch_coins_serial, PrefetchTestingSetup)
+{
+    Chainstate& chainstate{Assert(m_node.chainman)->ActiveChainstate()};
+
+    // Spend half of the mature coinbase outputs, and some outputs which do not exist, across several transactions
+    CBlock block;
+    block.vtx.push_back(m_coinbase_txns.back());
+    std::vector<COutPoint> outpoints;
+    for (size_t i = 0; i < 50; ++i) {
+        outpoints.emplace_back(m_coinbase_txns[i]->GetHash(), 0);
+        if (i % 10 == 0) outpoints.emplace_back(Txid::FromUint256(InsecureRand256()), 0);
+    }
+    for (size_t i = 0; i < outpoints.size(); i += 8) {
+        CMutableTransaction tx;
+        for (size_t j = i; j < std::min(i + 8, outpoints.size()); ++j) tx.vin.emplace_back(outpoints[j]);
+        tx.vout.emplace_back(COIN, CScript{} << OP_TRUE);
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+
+    LOCK(::cs_main);
+    chainstate.ForceFlushStateToDisk();
+    CCoinsViewCache& cache{chainstate.CoinsTip()};
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    chainstate.PrefetchCoins(block);
+
+    CCoinsViewCache serial{&chainstate.CoinsDB()};
+    size_t num_found{0};
+    for (const COutPoint& outpoint : outpoints) {
+        const Coin& coin{serial.AccessCoin(outpoint)};
+        BOOST_CHECK_EQUAL(cache.HaveCoinInCache(outpoint), !coin.IsSpent());
+        if (coin.IsSpent()) continue;
+        ++num_found;
+        const Coin& prefetched{cache.AccessCoin(outpoint)};
+        BOOST_CHECK(prefetched.out == coin.out);
+        BOOST_CHECK_EQUAL(prefetched.nHeight, coin.nHeight);
+        BOOST_CHECK_EQUAL(prefetched.fCoinBase, coin.fCoinBase);
+    }
+    BOOST_CHECK_EQUAL(num_found, 50U);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), num_found);
+}
+
 //! Test UpdateTip behavior for both active and background chainstates.
 //!
 //! When run on the background chainstate, UpdateTip should do a subset
@@ -154,4 +154,45 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
         CoinsCacheSizeState::OK);
 }
 
+struct SmallMempoolTestingSetup : public TestingSetup {
+    SmallMempoolTestingSetup() : TestingSetup{ChainType::MAIN, {.extra_args = {"-maxmempool=5", "-backgroundcoinsflush=1"}}} {}
+};
+
+//! Test writing the coins cache to disk in the background when it is full.
+BOOST_FIXTURE_TEST_CASE(background_flush, SmallMempoolTestingSetup)
+{
+    Chainstate& chainstate{m_node.chainman->ActiveChainstate()};
+    BlockValidationState state;
+
+    LOCK(::cs_main);
+    // Fill the memory left unused by the mempool.
+    chainstate.m_coinstip_cache_size_bytes = 0;
+    std::vector<COutPoint> outpoints;
+    while (chainstate.GetCoinsCacheSizeState() != CoinsCacheSizeState::CRITICAL) {
+        outpoints.push_back(AddTestCoin(chainstate.CoinsTip()));
+    }
+    BOOST_CHECK(chainstate.FlushStateToDisk(state, FlushStateMode::IF_NEEDED));
+
+    // The coins being written stay visible through an empty cache. They still count towards the size of the
+    // cache until they are written.
+    BOOST_CHECK_EQUAL(chainstate.CoinsTip().GetCacheSize(), 0U);
+    BOOST_CHECK_EQUAL(chainstate.GetCoinsCacheSizeState(), CoinsCacheSizeState::CRITICAL);
+    BOOST_CHECK(chainstate.CoinsTip().SpendCoin(outpoints.front()));
+    const COutPoint added{AddTestCoin(chainstate.CoinsTip())};
+    BOOST_CHECK(chainstate.CoinsTip().HaveCoin(outpoints.back()));
+
+    // Reading the database waits for the coins to be written.
+    BOOST_CHECK(chainstate.CoinsDB().HaveCoin(outpoints.front()));
+    BOOST_CHECK(chainstate.CoinsDB().HaveCoin(outpoints.back()));
+    BOOST_CHECK(!chainstate.CoinsDB().HaveCoin(added));
+
+    // The next flush finishes the background flush before writing the coins modified since.
+    BOOST_CHECK(chainstate.FlushStateToDisk(state, FlushStateMode::ALWAYS));
+    BOOST_CHECK(!chainstate.CoinsDB().HaveCoin(outpoints.front()));
+    BOOST_CHECK(chainstate.CoinsDB().HaveCoin(added));
+    BOOST_CHECK(!chainstate.CoinsTip().HaveCoin(outpoints.front()));
+    BOOST_CHECK(chainstate.CoinsTip().HaveCoin(outpoints.back()));
+    BOOST_CHECK_EQUAL(chainstate.GetCoinsCacheSizeState(), CoinsCacheSizeState::OK);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,410 @@
+// Copyright (c) 2025 The Satoshi Cash-X developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <blockencodings.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/amount.h>
+#include <consensus/merkle.h>
+#include <hash.h>
+#include <node/blockstorage.h>
+#include <node/chainstate.h>
+#include <node/kernel_notifications.h>
+#include <pow.h>
+#include <powverifyqueue.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <sync.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <util/chaintype.h>
+#include <validation.h>
+#include <versionbits.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace {
+//! Chain parameters with the given checkpoints
+class CheckpointedParams : public CChainParams
+{
+public:
+    CheckpointedParams(const CChainParams& params, MapCheckpoints checkpoints) : CChainParams{params}
+    {
+        checkpointData.mapCheckpoints = std::move(checkpoints);
+    }
+};
+
+struct RandomXTestingSetup : public ChainTestingSetup {
+    explicit RandomXTestingSetup(int randomx_verify_threads = 0) : ChainTestingSetup{ChainType::SNAILCOINREGTEST}
+    {
+        // Verified RandomX hashes are cached for the whole process, while every test case seeds the random context
+        // alike. Reseed it with the number of the test case, so that no two test cases build the same headers.
+        static uint64_t test_case_count{0};
+        g_insecure_rand_ctx.Reseed((HashWriter{} << InsecureRand256() << ++test_case_count).GetSHA256());
+        ResetChainman(::Params(), randomx_verify_threads);
+    }
+
+    ~RandomXTestingSetup()
+    {
+        // The chainstate manager may refer to m_checkpointed_params
+        m_node.chainman.reset();
+    }
+
+    std::optional<CheckpointedParams> m_checkpointed_params;
+
+    //! Only headers are processed, so the chainstate is loaded without connecting the genesis block. The block
+    //! index is not consistent without an active chain, so it is not checked.
+    void ResetChainman(const CChainParams& chainparams, int randomx_verify_threads = 0, std::optional<uint256> assumed_valid_block = std::nullopt)
+    {
+        const ChainstateManager::Options chainman_opts{
+            .chainparams = chainparams,
+            .datadir = m_args.GetDataDirNet(),
+            .check_block_index = 0,
+            .assumed_valid_block = assumed_valid_block,
+            .notifications = *m_node.notifications,
+            .signals = m_node.validation_signals.get(),
+            .randomx_verify_threads_num = randomx_verify_threads,
+        };
+        const node::BlockManager::Options blockman_opts{
+            .chainparams = chainman_opts.chainparams,
+            .blocks_dir = m_args.GetBlocksDirPath(),
+            .notifications = chainman_opts.notifications,
+        };
+        m_node.chainman.reset();
+        m_node.chainman = std::make_unique<ChainstateManager>(*Assert(m_node.shutdown), chainman_opts, blockman_opts);
+
+        node::ChainstateLoadOptions options;
+        options.mempool = m_node.mempool.get();
+        options.block_tree_db_in_memory = m_block_tree_db_in_memory;
+        options.coins_db_in_memory = m_coins_db_in_memory;
+        const auto [status, error]{node::LoadChainstate(*m_node.chainman, m_cache_sizes, options)};
+        BOOST_REQUIRE(status == node::ChainstateLoadStatus::SUCCESS);
+    }
+
+    //! A header on top of prev, solved at runtime
+    CBlockHeader MakeHeader(const uint256& prev_hash, uint32_t nBits, uint32_t time, const uint256& merkle_root = InsecureRand256())
+    {
+        CBlockHeader header;
+        header.nVersion = VERSIONBITS_TOP_BITS;
+        header.hashPrevBlock = prev_hash;
+        header.hashMerkleRoot = merkle_root;
+        header.nTime = time;
+        header.nBits = nBits;
+        uint64_t max_tries{1000};
+        BOOST_REQUIRE(MineRandomX(header, ::Params().GetConsensus(), 1, max_tries, [] { return false; }));
+        return header;
+    }
+
+    //! A block with only a coinbase transaction on top of prev, solved at runtime
+    std::shared_ptr<CBlock> MakeBlock(const CBlockIndex& prev, uint32_t time)
+    {
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vin[0].scriptSig = CScript() << (prev.nHeight + 1) << OP_0;
+        coinbase.vout.emplace_back(0, CScript() << OP_TRUE);
+        auto block{std::make_shared<CBlock>()};
+        block->vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+        static_cast<CBlockHeader&>(*block) = MakeHeader(prev.GetBlockHash(), prev.nBits, time, BlockMerkleRoot(*block));
+        return block;
+    }
+};
+
+struct RandomXQueueTestingSetup : public RandomXTestingSetup {
+    RandomXQueueTestingSetup() : RandomXTestingSetup{/*randomx_verify_threads=*/2} {}
+};
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(validation_randomx_tests, RandomXTestingSetup)
+
+BOOST_AUTO_TEST_CASE(header_pow_verified_without_cs_main)
+{
+    ChainstateManager& chainman{*m_node.chainman};
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return chainman.m_blockman.LookupBlockIndex(chainman.GetConsensus().hashGenesisBlock))};
+
+    // Blocks are spaced more than the target spacing apart, so the difficulty stays at the proof of work limit.
+    // The third header is older than the median time past, and the fourth extends it.
+    std::vector<CBlockHeader> headers;
+    headers.push_back(MakeHeader(genesis->GetBlockHash(), genesis->nBits, genesis->nTime + 1200));
+    headers.push_back(MakeHeader(headers[0].GetHash(), genesis->nBits, headers[0].nTime + 1200));
+    headers.push_back(MakeHeader(headers[1].GetHash(), genesis->nBits, genesis->nTime));
+    headers.push_back(MakeHeader(headers[2].GetHash(), genesis->nBits, headers[1].nTime + 1200));
+
+    // Only the headers before the first which fails the contextual checks are verified ahead
+    const uint64_t verify_count{GetRandomXVerifyCount()};
+    BlockValidationState state;
+    BOOST_CHECK(chainman.PreVerifyPow(headers, state));
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 2U);
+
+    // No header is hashed while holding cs_main: the verified ones are found in the cache, and the others are
+    // rejected by the contextual checks before being hashed
+    BOOST_CHECK(!chainman.ProcessNewBlockHeaders(headers, /*min_pow_checked=*/true, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "time-too-old");
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 2U);
+
+    LOCK(cs_main);
+    for (size_t i{0}; i < headers.size(); ++i) {
+        const CBlockIndex* pindex{chainman.m_blockman.LookupBlockIndex(headers[i].GetHash())};
+        BOOST_CHECK_EQUAL(pindex != nullptr, i < 2);
+        if (pindex) BOOST_CHECK(pindex->nStatus & BLOCK_POW_VERIFIED);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(header_bad_diffbits_not_verified)
+{
+    ChainstateManager& chainman{*m_node.chainman};
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return chainman.m_blockman.LookupBlockIndex(chainman.GetConsensus().hashGenesisBlock))};
+
+    // The third header claims half the required target, and the fourth extends it. The difficulty of the
+    // headers connecting to another header of the batch is checked against the headers before them.
+    arith_uint256 bad_target;
+    bad_target.SetCompact(genesis->nBits);
+    bad_target >>= 1;
+    const uint32_t bad_bits{bad_target.GetCompact()};
+    std::vector<CBlockHeader> headers;
+    headers.push_back(MakeHeader(genesis->GetBlockHash(), genesis->nBits, genesis->nTime + 1200));
+    headers.push_back(MakeHeader(headers[0].GetHash(), genesis->nBits, headers[0].nTime + 1200));
+    headers.push_back(MakeHeader(headers[1].GetHash(), bad_bits, headers[1].nTime + 1200));
+    headers.push_back(MakeHeader(headers[2].GetHash(), genesis->nBits, headers[2].nTime + 1200));
+
+    const uint64_t verify_count{GetRandomXVerifyCount()};
+    BlockValidationState state;
+    BOOST_CHECK(chainman.PreVerifyPow(headers, state));
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 2U);
+
+    BOOST_CHECK(!chainman.ProcessNewBlockHeaders(headers, /*min_pow_checked=*/true, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-diffbits");
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 2U);
+}
+
+BOOST_FIXTURE_TEST_CASE(header_batch_verified_by_queue, RandomXQueueTestingSetup)
+{
+    ChainstateManager& chainman{*m_node.chainman};
+    PowVerifyQueue& queue{*Assert(chainman.GetPowVerifyQueue())};
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return chainman.m_blockman.LookupBlockIndex(chainman.GetConsensus().hashGenesisBlock))};
+
+    std::vector<CBlockHeader> headers;
+    uint256 prev_hash{genesis->GetBlockHash()};
+    for (int i{0}; i < 8; ++i) {
+        headers.push_back(MakeHeader(prev_hash, genesis->nBits, genesis->nTime + 1200 * (i + 1)));
+        prev_hash = headers.back().GetHash();
+    }
+
+    // The second header of another batch has a fake RandomX hash whose commitment meets the target. The batch is
+    // rejected, and the headers after it are discarded from the queue instead of being left in it.
+    std::vector<CBlockHeader> bad_headers;
+    prev_hash = genesis->GetBlockHash();
+    for (const CBlockHeader& header : headers) {
+        bad_headers.push_back(MakeHeader(prev_hash, genesis->nBits, header.nTime));
+        if (bad_headers.size() == 2) {
+            do {
+                bad_headers[1].hashRandomX = InsecureRand256();
+            } while (!CheckProofOfWorkRandomX(bad_headers[1], chainman.GetConsensus(), POW_VERIFY_COMMITMENT_ONLY));
+        }
+        prev_hash = bad_headers.back().GetHash();
+    }
+    BlockValidationState state;
+    BOOST_CHECK(!chainman.PreVerifyPow(bad_headers, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+
+    // Every header of a valid batch is verified once, and its result taken
+    const uint64_t verify_count{GetRandomXVerifyCount()};
+    state = BlockValidationState{};
+    BOOST_CHECK(chainman.PreVerifyPow(headers, state));
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, headers.size());
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+
+    // The headers are then accepted as verified without being hashed again
+    BOOST_CHECK(chainman.ProcessNewBlockHeaders(headers, /*min_pow_checked=*/true, state));
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, headers.size());
+    LOCK(cs_main);
+    for (const CBlockHeader& header : headers) {
+        const CBlockIndex* pindex{chainman.m_blockman.LookupBlockIndex(header.GetHash())};
+        BOOST_REQUIRE(pindex);
+        BOOST_CHECK(pindex->nStatus & BLOCK_POW_VERIFIED);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compact_block_not_hashed_before_relay)
+{
+    ChainstateManager& chainman{*m_node.chainman};
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return chainman.m_blockman.LookupBlockIndex(chainman.GetConsensus().hashGenesisBlock))};
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << 1 << OP_0;
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    auto block{std::make_shared<CBlock>()};
+    block->vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+    static_cast<CBlockHeader&>(*block) = MakeHeader(genesis->GetBlockHash(), genesis->nBits, genesis->nTime + 1200, BlockMerkleRoot(*block));
+
+    // With -fastcmpctblockrelay, neither the header nor the reconstructed block is hashed before relaying it
+    const uint64_t verify_count{GetRandomXVerifyCount()};
+    BlockValidationState state;
+    const CBlockIndex* header_index{nullptr};
+    BOOST_CHECK(chainman.ProcessNewBlockHeaders({block->GetBlockHeader()}, /*min_pow_checked=*/true, state, &header_index, /*defer_pow=*/true));
+    BOOST_REQUIRE(header_index);
+    BOOST_CHECK(!(WITH_LOCK(cs_main, return header_index->nStatus) & BLOCK_POW_VERIFIED));
+
+    // A header whose RandomX hash was not verified does not become the best header
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return chainman.m_best_header), genesis);
+
+    PartiallyDownloadedBlock partial_block{m_node.mempool.get()};
+    BOOST_CHECK(partial_block.InitData(CBlockHeaderAndShortTxIDs{*block, /*nonce=*/0}, {}) == READ_STATUS_OK);
+    CBlock reconstructed;
+    BOOST_CHECK(partial_block.FillBlock(reconstructed, {}, /*check_pow=*/false) == READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 0U);
+
+    // The hash is verified once, when the block is accepted
+    LOCK(cs_main);
+    CBlockIndex* pindex{nullptr};
+    BOOST_CHECK(chainman.AcceptBlock(block, state, &pindex, /*fRequested=*/true, /*dbp=*/nullptr, /*fNewBlock=*/nullptr, /*min_pow_checked=*/true));
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 1U);
+    BOOST_CHECK(pindex->nStatus & BLOCK_POW_VERIFIED);
+    BOOST_CHECK_EQUAL(chainman.m_best_header, pindex);
+}
+
+BOOST_AUTO_TEST_CASE(pow_verified_flag_persisted)
+{
+    m_block_tree_db_in_memory = false;
+    ResetChainman(::Params());
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return m_node.chainman->m_blockman.LookupBlockIndex(::Params().GetConsensus().hashGenesisBlock))};
+    const CBlockHeader header{MakeHeader(genesis->GetBlockHash(), genesis->nBits, genesis->nTime + 1200)};
+    BlockValidationState state;
+    BOOST_CHECK(m_node.chainman->ProcessNewBlockHeaders({header}, /*min_pow_checked=*/true, state));
+    BOOST_CHECK(WITH_LOCK(cs_main, return m_node.chainman->m_blockman.WriteBlockIndexDB()));
+
+    // The flag is loaded back from the block tree database
+    ResetChainman(::Params());
+    LOCK(cs_main);
+    const CBlockIndex* pindex{m_node.chainman->m_blockman.LookupBlockIndex(header.GetHash())};
+    BOOST_REQUIRE(pindex);
+    BOOST_CHECK(pindex->nStatus & BLOCK_POW_VERIFIED);
+}
+
+BOOST_AUTO_TEST_CASE(connect_block_skips_verified_pow)
+{
+    ChainstateManager& chainman{*m_node.chainman};
+    Chainstate& chainstate{chainman.ActiveChainstate()};
+    BlockValidationState state;
+    BOOST_REQUIRE(chainstate.ActivateBestChain(state));
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return chainman.ActiveTip())};
+
+    // Store blocks whose RandomX hash was never computed, so that it is not found in the verified hash cache.
+    // Their headers are flagged as verified, as if loaded from the block index, so they are stored unhashed.
+    const uint64_t verify_count{GetRandomXVerifyCount()};
+    const auto accept_unhashed{[&](const std::shared_ptr<CBlock>& block) {
+        const CBlockIndex* header_index{nullptr};
+        BOOST_REQUIRE(chainman.ProcessNewBlockHeaders({block->GetBlockHeader()}, /*min_pow_checked=*/true, state, &header_index, /*defer_pow=*/true));
+        LOCK(cs_main);
+        CBlockIndex* pindex{chainman.m_blockman.LookupBlockIndex(block->GetHash())};
+        pindex->nStatus |= BLOCK_POW_VERIFIED;
+        BOOST_REQUIRE(chainman.AcceptBlock(block, state, &pindex, /*fRequested=*/true, /*dbp=*/nullptr, /*fNewBlock=*/nullptr, /*min_pow_checked=*/true));
+        return pindex;
+    }};
+    const auto block1{MakeBlock(*genesis, genesis->nTime + 1200)};
+    CBlockIndex* pindex1{accept_unhashed(block1)};
+    const auto block2{MakeBlock(*pindex1, block1->nTime + 1200)};
+    CBlockIndex* pindex2{accept_unhashed(block2)};
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 0U);
+
+    // Only the block without the flag is hashed when connected, and it is then flagged
+    WITH_LOCK(cs_main, pindex2->nStatus &= ~BLOCK_POW_VERIFIED);
+    BOOST_REQUIRE(chainstate.ActivateBestChain(state));
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return chainman.ActiveTip()), pindex2);
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 1U);
+
+    LOCK(cs_main);
+    BOOST_CHECK(pindex2->nStatus & BLOCK_POW_VERIFIED);
+
+    // Likewise for VerifyDB
+    CVerifyDB verify_db{chainman.GetNotifications()};
+    BOOST_CHECK(verify_db.VerifyDB(chainstate, chainman.GetConsensus(), chainstate.CoinsTip(), /*nCheckLevel=*/1, /*nCheckDepth=*/2) == VerifyDBResult::SUCCESS);
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 1U);
+    pindex1->nStatus &= ~BLOCK_POW_VERIFIED;
+    BOOST_CHECK(verify_db.VerifyDB(chainstate, chainman.GetConsensus(), chainstate.CoinsTip(), /*nCheckLevel=*/1, /*nCheckDepth=*/2) == VerifyDBResult::SUCCESS);
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 2U);
+}
+
+BOOST_AUTO_TEST_CASE(checkpoint_lock_in)
+{
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return m_node.chainman->m_blockman.LookupBlockIndex(::Params().GetConsensus().hashGenesisBlock))};
+    std::vector<CBlockHeader> headers;
+    headers.push_back(MakeHeader(genesis->GetBlockHash(), genesis->nBits, genesis->nTime + 1200));
+    headers.push_back(MakeHeader(headers[0].GetHash(), genesis->nBits, headers[0].nTime + 1200));
+    headers.push_back(MakeHeader(headers[1].GetHash(), genesis->nBits, headers[1].nTime + 1200));
+
+    m_checkpointed_params.emplace(::Params(), MapCheckpoints{{2, headers[1].GetHash()}});
+    ResetChainman(*m_checkpointed_params);
+    ChainstateManager& chainman{*m_node.chainman};
+    genesis = WITH_LOCK(cs_main, return chainman.m_blockman.LookupBlockIndex(chainman.GetConsensus().hashGenesisBlock));
+
+    // The RandomX hash is only skipped at or below the last checkpoint
+    BOOST_CHECK(chainman.IsPowCheckpointed(1));
+    BOOST_CHECK(chainman.IsPowCheckpointed(2));
+    BOOST_CHECK(!chainman.IsPowCheckpointed(3));
+
+    // A header at the checkpoint height with another hash is rejected
+    const CBlockHeader mismatch{MakeHeader(headers[0].GetHash(), genesis->nBits, headers[1].nTime)};
+    BlockValidationState state;
+    BOOST_CHECK(!chainman.ProcessNewBlockHeaders({headers[0], mismatch}, /*min_pow_checked=*/true, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "checkpoint mismatch");
+
+    // Only the header above the checkpoint is hashed
+    const uint64_t verify_count{GetRandomXVerifyCount()};
+    state = {};
+    BOOST_CHECK(chainman.ProcessNewBlockHeaders(headers, /*min_pow_checked=*/true, state));
+    BOOST_CHECK_EQUAL(GetRandomXVerifyCount() - verify_count, 1U);
+    {
+        LOCK(cs_main);
+        for (size_t i{0}; i < headers.size(); ++i) {
+            const CBlockIndex* pindex{chainman.m_blockman.LookupBlockIndex(headers[i].GetHash())};
+            BOOST_REQUIRE(pindex);
+            BOOST_CHECK_EQUAL(bool(pindex->nStatus & BLOCK_POW_VERIFIED), i == 2);
+            BOOST_CHECK(chainman.IsPowAssumedValid(*pindex) == (i < 2));
+        }
+    }
+
+    // Once the checkpoint is known, a fork below it is rejected
+    const CBlockHeader fork{MakeHeader(genesis->GetBlockHash(), genesis->nBits, genesis->nTime + 1200)};
+    state = {};
+    BOOST_CHECK(!chainman.ProcessNewBlockHeaders({fork}, /*min_pow_checked=*/true, state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-fork-prior-to-checkpoint");
+}
+
+BOOST_AUTO_TEST_CASE(pow_assumed_valid_only_on_assumevalid_chain)
+{
+    const CBlockIndex* genesis{WITH_LOCK(cs_main, return m_node.chainman->m_blockman.LookupBlockIndex(::Params().GetConsensus().hashGenesisBlock))};
+    std::vector<CBlockHeader> headers;
+    headers.push_back(MakeHeader(genesis->GetBlockHash(), genesis->nBits, genesis->nTime + 1200));
+    for (int i{1}; i < 4; ++i) {
+        headers.push_back(MakeHeader(headers.back().GetHash(), genesis->nBits, headers.back().nTime + 1200));
+    }
+    const CBlockHeader fork{MakeHeader(headers[0].GetHash(), genesis->nBits, headers[0].nTime + 1200)};
+
+    ResetChainman(::Params(), /*randomx_verify_threads=*/0, /*assumed_valid_block=*/headers[2].GetHash());
+    ChainstateManager& chainman{*m_node.chainman};
+    BlockValidationState state;
+    BOOST_CHECK(chainman.ProcessNewBlockHeaders(headers, /*min_pow_checked=*/true, state));
+    BOOST_CHECK(chainman.ProcessNewBlockHeaders({fork}, /*min_pow_checked=*/true, state));
+
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(chainman.m_best_header->GetBlockHash(), headers[3].GetHash());
+    const auto assumed_valid{[&](const uint256& hash) {
+        return chainman.IsPowAssumedValid(*Assert(chainman.m_blockman.LookupBlockIndex(hash)));
+    }};
+    // Ancestors of the assumed valid block are assumed valid, but neither its descendants nor forks of it are
+    BOOST_CHECK(assumed_valid(headers[0].GetHash()));
+    BOOST_CHECK(assumed_valid(headers[2].GetHash()));
+    BOOST_CHECK(!assumed_valid(headers[3].GetHash()));
+    BOOST_CHECK(!assumed_valid(fork.GetHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -60,6 +60,7 @@
 #include <util/signalinterrupt.h>
 #include <util/strencodings.h>
 #include <util/string.h>
+#include <util/thread.h>
 #include <util/time.h>
 #include <util/trace.h>
 #include <util/translation.h>
@@ -74,6 +75,7 @@
 #include <ranges>
 #include <string>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 
 #include <common/args.h>
@@ -1945,12 +1947,74 @@ CoinsViews::CoinsViews(DBParams db_params, CoinsViewOptions options)
     : m_dbview{std::move(db_params), std::move(options)},
       m_catcherview(&m_dbview) {}
 
+CoinsViews::~CoinsViews()
+{
+    WaitForFlushWrite();
+}
+
 void CoinsViews::InitCache()
 {
     AssertLockHeld(::cs_main);
     m_cacheview = std::make_unique<CCoinsViewCache>(&m_catcherview);
 }
 
+CCoinsView& CoinsViews::CacheBase()
+{
+    AssertLockHeld(::cs_main);
+    if (m_flushingview) return *m_flushingview;
+    return m_catcherview;
+}
+
+void CoinsViews::StartBackgroundFlush(bool empty_cache)
+{
+    AssertLockHeld(::cs_main);
+    assert(!m_flushingcache);
+    m_flushingcache = std::move(m_cacheview);
+    m_flushingview = std::make_unique<CCoinsViewFrozenCache>(&m_catcherview, *m_flushingcache);
+    m_cacheview = std::make_unique<CCoinsViewCache>(m_flushingview.get());
+    m_flush_empties_cache = empty_cache;
+    m_flush_error.reset();
+    m_flush_written = false;
+    m_flush_thread = std::thread(&util::TraceThread, "coinsflush", [this, &cache = *m_flushingcache] {
+        const auto time_start{SteadyClock::now()};
+        try {
+            if (!cache.WriteFlagged()) m_flush_error = _("Failed to write to coin database.");
+        } catch (const std::runtime_error& e) {
+            m_flush_error = strprintf(_("System error while flushing: %s"), e.what());
+        }
+        LogPrint(BCLog::BENCH, "Wrote coins cache to disk in the background (%d coins): %.2fms\n",
+                 cache.GetCacheSize(), Ticks<MillisecondsDouble>(SteadyClock::now() - time_start));
+        m_flush_written = true;
+    });
+}
+
+void CoinsViews::WaitForFlushWrite()
+{
+    if (m_flush_thread.joinable()) m_flush_thread.join();
+}
+
+util::Result<uint256> CoinsViews::FinishBackgroundFlush()
+{
+    AssertLockHeld(::cs_main);
+    assert(m_flushingcache);
+    WaitForFlushWrite();
+    const uint256 flushed_block{m_flushingcache->GetBestBlock()};
+    if (!m_flush_error && m_flush_empties_cache) {
+        m_cacheview->SetBackend(m_catcherview);
+    } else {
+        // Put the coins modified since the flush started on top of the flushed ones. If the
+        // write failed, the flushed coins keep their flags so that they can be written again.
+        if (!m_flush_error) m_flushingcache->ClearFlagged();
+        m_cacheview->SetBackend(*m_flushingcache);
+        Assert(m_cacheview->Flush());
+        m_cacheview = std::move(m_flushingcache);
+    }
+    m_flushingview.reset();
+    m_flushingcache.reset();
+    if (m_flush_error) return util::Error{*m_flush_error};
+    return flushed_block;
+}
+
 Chainstate::Chainstate(
     CTxMemPool* mempool,
     BlockManager& blockman,
@@ -2413,12 +2477,61 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex& block_index, const Ch
     return flags;
 }
 
+void Chainstate::PrefetchCoins(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    CCheckQueue<CCoinPrefetch>& queue{m_chainman.GetCoinsPrefetchQueue()};
+    if (!queue.HasThreads()) return;
+
+    const auto time_start{SteadyClock::now()};
+    CCoinsViewCache& cache{CoinsTip()};
+    // Coins created by the block itself are not in the database.
+    std::unordered_set<Txid, SaltedTxidHasher> block_txids;
+    block_txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+    }
+    std::vector<COutPoint> outpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (block_txids.count(txin.prevout.hash) || cache.HaveCoinInCache(txin.prevout)) continue;
+            outpoints.push_back(txin.prevout);
+        }
+    }
+    if (outpoints.empty()) return;
+
+    // The view backing the cache is read directly: the coins cache is not thread safe, and the
+    // backing view does not change until the coins are added to the cache below. The coins a
+    // background flush may be writing meanwhile are read from the flushed cache, not the database.
+    std::vector<std::optional<Coin>> coins(outpoints.size());
+    {
+        const CCoinsView& base{m_coins_views->CacheBase()};
+        std::vector<CCoinPrefetch> reads;
+        reads.reserve(outpoints.size());
+        for (size_t i = 0; i < outpoints.size(); ++i) {
+            reads.emplace_back(base, outpoints[i], coins[i]);
+        }
+        CCheckQueueControl<CCoinPrefetch> control(&queue);
+        control.Add(std::move(reads));
+        control.Wait();
+    }
+    size_t num_found{0};
+    for (size_t i = 0; i < outpoints.size(); ++i) {
+        if (!coins[i]) continue;
+        cache.EmplaceBaseCoin(outpoints[i], std::move(*coins[i]));
+        ++num_found;
+    }
+    LogPrint(BCLog::BENCH, "  - Prefetch coins: %.2fms (%u of %u found)\n",
+             Ticks<MillisecondsDouble>(SteadyClock::now() - time_start), num_found, outpoints.size());
+}
+
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
-                               CCoinsViewCache& view, bool fJustCheck)
+                               CCoinsViewCache& view, bool fJustCheck, DeferredScriptChecks* deferred_checks)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -2443,7 +2556,20 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // is enforced in ContextualCheckBlockHeader(); we wouldn't want to
     // re-enforce that rule here (at least until we make it impossible for
     // the clock to go backward).
-    if (!CheckBlock(block, state, params.GetConsensus(), !fJustCheck, !fJustCheck)) {
+    //
+    // The RandomX hash of a block which was already verified (BLOCK_POW_VERIFIED),
+    // or of an ancestor of a checkpoint or of the assumed valid block, is trusted,
+    // so only its commitment is checked.
+    bool fCheckPOW{!fJustCheck};
+    if (fCheckPOW && ((pindex->nStatus & BLOCK_POW_VERIFIED) || m_chainman.IsPowAssumedValid(*pindex))) {
+        if (!CheckProofOfWorkRandomX(block, params.GetConsensus(), POW_VERIFY_COMMITMENT_ONLY)) {
+            state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
+            LogError("%s: Consensus::CheckBlock: %s\n", __func__, state.ToString());
+            return false;
+        }
+        fCheckPOW = false;
+    }
+    if (!CheckBlock(block, state, params.GetConsensus(), fCheckPOW, !fJustCheck)) {
         if (state.GetResult() == BlockValidationResult::BLOCK_MUTATED) {
             // We don't write down blocks to disk if they may have been
             // corrupted, so this should be impossible unless we're having hardware
@@ -2453,6 +2579,10 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         LogError("%s: Consensus::CheckBlock: %s\n", __func__, state.ToString());
         return false;
     }
+    if (fCheckPOW && params.GetConsensus().fPowRandomX) {
+        pindex->nStatus |= BLOCK_POW_VERIFIED;
+        m_blockman.m_dirty_blockindex.insert(pindex);
+    }
 
     // verify that the view's current state corresponds to the previous block
     uint256 hashPrevBlock = pindex->pprev == nullptr ? uint256() : pindex->pprev->GetBlockHash();
@@ -2615,8 +2745,14 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // in multiple threads). Preallocate the vector size so a new allocation
     // doesn't invalidate pointers into the vector, and keep txsdata in scope
     // for as long as `control`.
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && parallel_script_checks ? &m_chainman.GetCheckQueue() : nullptr);
-    std::vector<PrecomputedTransactionData> txsdata(block.vtx.size());
+    // When the script checks are deferred, `deferred_checks` keeps the
+    // precomputed transaction data and joins the checks after later blocks
+    // have been connected.
+    const bool defer_script_checks{deferred_checks && fScriptChecks && parallel_script_checks};
+    CCheckQueueControl<CScriptCheck> local_control(fScriptChecks && parallel_script_checks && !defer_script_checks ? &m_chainman.GetCheckQueue() : nullptr);
+    CCheckQueueControl<CScriptCheck>& control{defer_script_checks ? deferred_checks->control : local_control};
+    std::vector<PrecomputedTransactionData> local_txsdata(defer_script_checks ? 0 : block.vtx.size());
+    std::vector<PrecomputedTransactionData>& txsdata{defer_script_checks ? deferred_checks->txsdata.emplace_back(block.vtx.size()) : local_txsdata};
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -2706,7 +2842,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-cb-amount");
     }
 
-    if (!control.Wait()) {
+    if (!defer_script_checks && !control.Wait()) {
         LogPrintf("ERROR: %s: CheckQueue failed\n", __func__);
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "block-validation-failed");
     }
@@ -2732,7 +2868,10 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
              Ticks<SecondsDouble>(m_chainman.time_undo),
              Ticks<MillisecondsDouble>(m_chainman.time_undo) / m_chainman.num_blocks_total);
 
-    if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
+    if (defer_script_checks) {
+        // The validity is raised once the script checks have passed
+        deferred_checks->indexes.push_back(pindex);
+    } else if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
         m_blockman.m_dirty_blockindex.insert(pindex);
     }
@@ -2773,7 +2912,8 @@ CoinsCacheSizeState Chainstate::GetCoinsCacheSizeState(
 {
     AssertLockHeld(::cs_main);
     const int64_t nMempoolUsage = m_mempool ? m_mempool->DynamicMemoryUsage() : 0;
-    int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
+    // The coins being written by a background flush stay in memory until they are written.
+    int64_t cacheSize = CoinsTip().DynamicMemoryUsage() + m_coins_views->FlushingCacheUsage();
     int64_t nTotalSpace =
         max_coins_cache_size_bytes + std::max<int64_t>(int64_t(max_mempool_size_bytes) - nMempoolUsage, 0);
 
@@ -2798,6 +2938,13 @@ bool Chainstate::FlushStateToDisk(
 {
     LOCK(cs_main);
     assert(this->CanFlushToDisk());
+    if (m_coins_views->IsFlushing() && m_coins_views->IsFlushWritten()) {
+        if (!FinishBackgroundCoinsFlush(state)) return false;
+    }
+    if (m_deferred_script_checks && (mode == FlushStateMode::IF_NEEDED || mode == FlushStateMode::PERIODIC)) {
+        // Don't write a chainstate containing blocks whose script checks have not passed yet
+        return true;
+    }
     std::set<int> setFilesToPrune;
     bool full_flush_completed = false;
 
@@ -2861,7 +3008,8 @@ bool Chainstate::FlushStateToDisk(
             m_last_flush = nNow;
         }
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
-        bool fCacheLarge = mode == FlushStateMode::PERIODIC && cache_state >= CoinsCacheSizeState::LARGE;
+        // A background flush in progress frees its coins when it is finished, so there is no need to wait for it then.
+        bool fCacheLarge = mode == FlushStateMode::PERIODIC && cache_state >= CoinsCacheSizeState::LARGE && !m_coins_views->IsFlushing();
         // The cache is over the limit, we have to write now.
         bool fCacheCritical = mode == FlushStateMode::IF_NEEDED && cache_state >= CoinsCacheSizeState::CRITICAL;
         // It's been a while since we wrote the block index to disk. Do this frequently, so we don't need to redownload after a crash.
@@ -2897,6 +3045,10 @@ bool Chainstate::FlushStateToDisk(
             }
             // Finally remove any pruned files
             if (fFlushForPrune) {
+                // The coins being written in the background may need the pruned blocks to be
+                // replayed after a crash.
+                if (m_coins_views->IsFlushing() && !FinishBackgroundCoinsFlush(state)) return false;
+
                 LOG_TIME_MILLIS_WITH_CATEGORY("unlink pruned files", BCLog::BENCH);
 
                 m_blockman.UnlinkPrunedFiles(setFilesToPrune);
@@ -2905,8 +3057,11 @@ bool Chainstate::FlushStateToDisk(
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
         if (fDoFullFlush && !CoinsTip().GetBestBlock().IsNull()) {
-            LOG_TIME_MILLIS_WITH_CATEGORY(strprintf("write coins cache to disk (%d coins, %.2fkB)",
-                coins_count, coins_mem_usage / 1000), BCLog::BENCH);
+            // Only one flush of the coins cache can be in progress at a time.
+            if (m_coins_views->IsFlushing()) {
+                LOG_TIME_MILLIS_WITH_CATEGORY("wait for background coins flush", BCLog::BENCH);
+                if (!FinishBackgroundCoinsFlush(state)) return false;
+            }
 
             // Typical Coin structures on disk are around 48 bytes in size.
             // Pushing a new one to the database can cause it to be written
@@ -2918,11 +3073,21 @@ bool Chainstate::FlushStateToDisk(
             }
             // Flush the chainstate (which may refer to block index entries).
             const auto empty_cache{(mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical};
-            if (empty_cache ? !CoinsTip().Flush() : !CoinsTip().Sync()) {
-                return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
+            if (m_chainman.m_options.background_coins_flush && mode != FlushStateMode::ALWAYS && !fFlushForPrune) {
+                // Block processing continues while the coins are written, the flush is finished by a later call.
+                LogPrint(BCLog::BENCH, "Writing coins cache to disk in the background (%d coins, %.2fkB)\n",
+                         coins_count, coins_mem_usage / 1000);
+                m_coins_views->StartBackgroundFlush(empty_cache);
+            } else {
+                LOG_TIME_MILLIS_WITH_CATEGORY(strprintf("write coins cache to disk (%d coins, %.2fkB)",
+                    coins_count, coins_mem_usage / 1000), BCLog::BENCH);
+
+                if (empty_cache ? !CoinsTip().Flush() : !CoinsTip().Sync()) {
+                    return FatalError(m_chainman.GetNotifications(), state, _("Failed to write to coin database."));
+                }
+                full_flush_completed = true;
             }
             m_last_flush = nNow;
-            full_flush_completed = true;
             TRACE5(utxocache, flush,
                    int64_t{Ticks<std::chrono::microseconds>(SteadyClock::now() - nNow)},
                    (uint32_t)mode,
@@ -2941,6 +3106,21 @@ bool Chainstate::FlushStateToDisk(
     return true;
 }
 
+bool Chainstate::FinishBackgroundCoinsFlush(BlockValidationState& state)
+{
+    AssertLockHeld(::cs_main);
+    const auto flushed_block{m_coins_views->FinishBackgroundFlush()};
+    if (!flushed_block) {
+        return FatalError(m_chainman.GetNotifications(), state, util::ErrorString(flushed_block));
+    }
+    const CBlockIndex* flushed_index{m_blockman.LookupBlockIndex(*flushed_block)};
+    if (flushed_index && m_chainman.m_options.signals) {
+        // Update best block in wallet (so we can detect restored wallets).
+        m_chainman.m_options.signals->ChainStateFlushed(this->GetRole(), GetLocator(flushed_index));
+    }
+    return true;
+}
+
 void Chainstate::ForceFlushStateToDisk()
 {
     BlockValidationState state;
@@ -3008,6 +3188,11 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
         g_best_block_cv.notify_all();
     }
 
+    // Keep the RandomX VMs of the tip's epoch cached
+    if (params.GetConsensus().fPowRandomX) {
+        SetRandomXTipEpoch(GetEpoch(pindexNew->nTime, params.GetConsensus().nRandomXEpochDuration));
+    }
+
     std::vector<bilingual_str> warning_messages;
     if (!m_chainman.IsInitialBlockDownload()) {
         const CBlockIndex* pindex = pindexNew;
@@ -3037,8 +3222,12 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
   * If disconnectpool is nullptr, then no disconnected transactions are added to
   * disconnectpool (note that the caller is responsible for mempool consistency
   * in any case).
+  *
+  * If notify is false, BlockDisconnected is not signalled, because the block
+  * was connected within the same ActivateBestChainStep call and BlockConnected
+  * was not signalled yet.
   */
-bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool)
+bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool, bool notify)
 {
     AssertLockHeld(cs_main);
     if (m_mempool) AssertLockHeld(m_mempool->cs);
@@ -3097,7 +3286,7 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
     UpdateTip(pindexDelete->pprev);
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
-    if (m_chainman.m_options.signals) {
+    if (notify && m_chainman.m_options.signals) {
         m_chainman.m_options.signals->BlockDisconnected(pblock, pindexDelete);
     }
     return true;
@@ -3131,6 +3320,14 @@ public:
         blocksConnected.emplace_back();
     }
 
+    //! Forget the last connected block, after it was disconnected again
+    void ForgetLastBlock(const CBlockIndex* pindex) {
+        assert(!blocksConnected.back().pindex);
+        blocksConnected.pop_back();
+        assert(!blocksConnected.empty() && blocksConnected.back().pindex == pindex);
+        blocksConnected.back() = PerBlockConnectTrace();
+    }
+
     std::vector<PerBlockConnectTrace>& GetBlocksConnected() {
         // We always keep one extra block at the end of our list because
         // blocks are added after all the conflicted transactions have
@@ -3176,10 +3373,26 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     // num_blocks_total may be zero until the ConnectBlock() call below.
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms\n",
              Ticks<MillisecondsDouble>(time_2 - time_1));
+    PrefetchCoins(blockConnecting);
+    DeferredScriptChecks* deferred_checks{nullptr};
+    if (DeferScriptChecks(*pindexNew)) {
+        if (!m_deferred_script_checks) {
+            m_deferred_script_checks = std::make_unique<DeferredScriptChecks>(m_chainman.GetCheckQueue());
+        }
+        deferred_checks = m_deferred_script_checks.get();
+        // The script checks may refer to the block until they are joined
+        deferred_checks->blocks.push_back(pthisBlock);
+    }
     {
         CCoinsViewCache view(&CoinsTip());
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
-        if (m_chainman.m_options.signals) {
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, /*fJustCheck=*/false, deferred_checks);
+        if (rv && deferred_checks && deferred_checks->indexes.size() < deferred_checks->blocks.size()) {
+            // No script checks were deferred (e.g. they are skipped below the assumed valid block)
+            deferred_checks->blocks.pop_back();
+            deferred_checks = nullptr;
+        }
+        // BlockChecked is signalled for blocks with deferred script checks once they have passed
+        if (m_chainman.m_options.signals && !(rv && deferred_checks)) {
             m_chainman.m_options.signals->BlockChecked(blockConnecting, state);
         }
         if (!rv) {
@@ -3322,6 +3535,80 @@ void Chainstate::PruneBlockIndexCandidates() {
     assert(!setBlockIndexCandidates.empty());
 }
 
+bool Chainstate::DeferScriptChecks(const CBlockIndex& block) const
+{
+    AssertLockHeld(cs_main);
+    if (m_deferred_script_checks) return true;
+    // The background chainstate compares its UTXO set to the snapshot as soon
+    // as it reaches the snapshot base, so its script checks are not deferred.
+    return m_chainman.m_options.script_check_pipeline_blocks > 1 &&
+           block.nHeight > m_immediate_script_checks_height &&
+           this == &m_chainman.ActiveChainstate() &&
+           m_chainman.GetCheckQueue().HasThreads() &&
+           m_chainman.IsInitialBlockDownload();
+}
+
+bool Chainstate::ContinueScriptCheckPipeline()
+{
+    AssertLockHeld(cs_main);
+    if (!m_deferred_script_checks || m_deferred_script_checks->indexes.empty()) return false;
+    if (m_deferred_script_checks->indexes.size() >= size_t(m_chainman.m_options.script_check_pipeline_blocks)) return false;
+    // Stop when the chain state has to be written, which waits for the checks
+    return GetCoinsCacheSizeState() < CoinsCacheSizeState::CRITICAL &&
+           !(m_blockman.IsPruneMode() && m_blockman.m_check_for_pruning);
+}
+
+bool Chainstate::JoinDeferredScriptChecks(BlockValidationState& state, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool, bool& blocks_disconnected)
+{
+    AssertLockHeld(cs_main);
+    if (m_mempool) AssertLockHeld(m_mempool->cs);
+    if (!m_deferred_script_checks) return true;
+    DeferredScriptChecks& deferred{*m_deferred_script_checks};
+
+    const auto time_start{SteadyClock::now()};
+    const bool checks_passed{deferred.control.Wait()};
+    LogPrint(BCLog::BENCH, "- Join deferred script checks of %u blocks: %.2fms\n", (unsigned)deferred.indexes.size(),
+             Ticks<MillisecondsDouble>(SteadyClock::now() - time_start));
+    if (checks_passed) {
+        for (size_t i = 0; i < deferred.indexes.size(); ++i) {
+            CBlockIndex* pindex{deferred.indexes[i]};
+            if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
+                pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+                m_blockman.m_dirty_blockindex.insert(pindex);
+            }
+            if (m_chainman.m_options.signals) {
+                m_chainman.m_options.signals->BlockChecked(*deferred.blocks[i], BlockValidationState{});
+            }
+        }
+        m_deferred_script_checks.reset();
+        return true;
+    }
+
+    // Connect the blocks again with their script checks waited for, so that
+    // the invalid block is found and marked as such.
+    m_immediate_script_checks_height = m_chain.Height() + 1;
+    bool disconnected{true};
+    if (!deferred.indexes.empty()) {
+        const int first_height{deferred.indexes.front()->nHeight};
+        LogPrintf("Deferred script checks of blocks %d to %d failed, connecting them again\n", first_height, m_chain.Height());
+        // The chain state is not written while m_deferred_script_checks is set
+        while (m_chain.Height() >= first_height) {
+            CBlockIndex* pindex{m_chain.Tip()};
+            if (!DisconnectTip(state, &disconnectpool, /*notify=*/false)) {
+                disconnected = false;
+                break;
+            }
+            connectTrace.ForgetLastBlock(pindex);
+            blocks_disconnected = true;
+            // The block was pruned from the candidates when its descendants were connected
+            setBlockIndexCandidates.insert(pindex);
+        }
+        setBlockIndexCandidates.insert(m_chain.Tip());
+    }
+    m_deferred_script_checks.reset();
+    return disconnected;
+}
+
 /**
  * Try to make some progress towards making pindexMostWork the active block.
  * pblock is either nullptr or a pointer to a CBlock corresponding to pindexMostWork.
@@ -3405,12 +3692,13 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
                     // A system error occurred (disk space, database error, ...).
                     // Make the mempool consistent with the current tip, just in case
                     // any observers try to use it before shutdown.
+                    JoinDeferredScriptChecks(state, connectTrace, disconnectpool, fBlocksDisconnected);
                     MaybeUpdateMempoolForReorg(disconnectpool, false);
                     return false;
                 }
             } else {
                 PruneBlockIndexCandidates();
-                if (!pindexOldTip || m_chain.Tip()->nChainWork > pindexOldTip->nChainWork) {
+                if ((!pindexOldTip || m_chain.Tip()->nChainWork > pindexOldTip->nChainWork) && !ContinueScriptCheckPipeline()) {
                     // We're in a better position than we were. Return temporarily to release the lock.
                     fContinue = false;
                     break;
@@ -3419,6 +3707,18 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
         }
     }
 
+    const bool script_checks_deferred{m_deferred_script_checks != nullptr};
+    if (!JoinDeferredScriptChecks(state, connectTrace, disconnectpool, fBlocksDisconnected)) {
+        MaybeUpdateMempoolForReorg(disconnectpool, false);
+        FatalError(m_chainman.GetNotifications(), state, _("Failed to disconnect block."));
+        return false;
+    }
+    // Write the chain state to disk, if necessary, now that the script checks have been joined.
+    if (script_checks_deferred && !FlushStateToDisk(state, FlushStateMode::IF_NEEDED)) {
+        MaybeUpdateMempoolForReorg(disconnectpool, false);
+        return false;
+    }
+
     if (fBlocksDisconnected) {
         // If any blocks were disconnected, disconnectpool may be non empty.  Add
         // any disconnected transactions back to the mempool.
@@ -4209,6 +4509,17 @@ static bool ContextualCheckBlockHeader(const CBlockHeader& block, BlockValidatio
             LogPrintf("ERROR: %s: forked chain older than last checkpoint (height %d)\n", __func__, nHeight);
             return state.Invalid(BlockValidationResult::BLOCK_CHECKPOINT, "bad-fork-prior-to-checkpoint");
         }
+
+        // On RandomX chains, don't accept a block at a checkpoint height other than the checkpoint. This bounds
+        // the length of forks whose full RandomX verification was deferred (see ChainstateManager::IsPowCheckpointed()).
+        if (consensusParams.fPowRandomX) {
+            const MapCheckpoints& checkpoints = chainman.GetParams().Checkpoints().mapCheckpoints;
+            const auto checkpoint{checkpoints.find(nHeight)};
+            if (checkpoint != checkpoints.end() && checkpoint->second != block.GetHash()) {
+                LogPrintf("ERROR: %s: rejected by checkpoint lock-in at %d\n", __func__, nHeight);
+                return state.Invalid(BlockValidationResult::BLOCK_CHECKPOINT, "checkpoint mismatch");
+            }
+        }
     }
 
     // Check timestamp against prev
@@ -4306,13 +4617,50 @@ static bool ContextualCheckBlock(const CBlock& block, BlockValidationState& stat
     return true;
 }
 
-bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationState& state, CBlockIndex** ppindex, bool min_pow_checked)
+bool ChainstateManager::IsPowCheckpointed(int height) const
+{
+    const MapCheckpoints& checkpoints{GetParams().Checkpoints().mapCheckpoints};
+    return GetConsensus().fPowRandomX && m_options.checkpoints_enabled && !checkpoints.empty() && height <= checkpoints.rbegin()->first;
+}
+
+bool ChainstateManager::IsPowAssumedValid(const CBlockIndex& index)
+{
+    AssertLockHeld(cs_main);
+    if (!GetConsensus().fPowRandomX) return false;
+
+    if (m_options.checkpoints_enabled) {
+        const CBlockIndex* pcheckpoint{m_blockman.GetLastCheckpoint(GetParams().Checkpoints())};
+        if (pcheckpoint && pcheckpoint->GetAncestor(index.nHeight) == &index) return true;
+    }
+
+    // Same conditions as for skipping script verification below the assumed valid block, see ConnectBlock().
+    if (!AssumedValidBlock().IsNull() && m_best_header && m_best_header->nChainWork >= MinimumChainWork()) {
+        const CBlockIndex* pindex_assumed_valid{m_blockman.LookupBlockIndex(AssumedValidBlock())};
+        if (pindex_assumed_valid && pindex_assumed_valid->GetAncestor(index.nHeight) == &index &&
+            m_best_header->GetAncestor(index.nHeight) == &index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ChainstateManager::IsPowVerified(const CBlockIndex& index) const
+{
+    AssertLockHeld(cs_main);
+    // Blocks which have been received were fully verified by AcceptBlock(), even if stored before BLOCK_POW_VERIFIED
+    // was recorded.
+    return !GetConsensus().fPowRandomX || (index.nStatus & BLOCK_POW_VERIFIED) ||
+           index.IsValid(BLOCK_VALID_TRANSACTIONS) || IsPowCheckpointed(index.nHeight);
+}
+
+bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationState& state, CBlockIndex** ppindex, bool min_pow_checked, bool defer_pow)
 {
     AssertLockHeld(cs_main);
 
     // Check for duplicate
     uint256 hash = block.GetHash();
     BlockMap::iterator miSelf{m_blockman.m_block_index.find(hash)};
+    bool pow_verified{false};
     if (hash != GetConsensus().hashGenesisBlock) {
         if (miSelf != m_blockman.m_block_index.end()) {
             // Block header is already known.
@@ -4332,7 +4680,8 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
             LogPrint(BCLog::VALIDATION, "%s: Consensus::CheckBlockHeader: %s, %s\n", __func__, hash.ToString(), state.ToString());
             return false;
         }
-        else if (!CheckBlockHeader(block, state, GetConsensus())) {
+        // The RandomX hash is only verified after the contextual checks below, if at all
+        else if (!CheckBlockHeader(block, state, GetConsensus(), /*fCheckPOW=*/!g_isRandomX)) {
             LogPrint(BCLog::VALIDATION, "%s: Consensus::CheckBlockHeader: %s, %s\n", __func__, hash.ToString(), state.ToString());
             return false;
         }
@@ -4356,7 +4705,10 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
 
         // Verify timestamp (and thus the epoch) in contextual check above, before performing full pow verification.
         // This ordering help prevents resource denial when -randomxfastmode=1, as VM creation is based on epoch.
-        if (g_isRandomX && !CheckBlockHeader(block, state, GetConsensus())) {
+        // At or below the last checkpoint, full verification is deferred until the block is connected, and it is
+        // deferred until the block is accepted if the caller asked for it.
+        pow_verified = g_isRandomX && !defer_pow && !IsPowCheckpointed(pindexPrev->nHeight + 1);
+        if (pow_verified && !CheckBlockHeader(block, state, GetConsensus())) {
             LogPrint(BCLog::VALIDATION, "%s: Consensus::CheckBlockHeader: %s, %s\n", __func__, hash.ToString(), state.ToString());
             return false;
         }
@@ -4404,7 +4756,15 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
         LogPrint(BCLog::VALIDATION, "%s: not adding new block header %s, missing anti-dos proof-of-work validation\n", __func__, hash.ToString());
         return state.Invalid(BlockValidationResult::BLOCK_HEADER_LOW_WORK, "too-little-chainwork");
     }
-    CBlockIndex* pindex{m_blockman.AddToBlockIndex(block, m_best_header)};
+    CBlockIndex* best_header{m_best_header};
+    CBlockIndex* pindex{m_blockman.AddToBlockIndex(block, best_header)};
+    if (pow_verified) {
+        pindex->nStatus |= BLOCK_POW_VERIFIED;
+    }
+    // A header whose RandomX hash was not verified becomes the best header once its block is accepted
+    if (IsPowVerified(*pindex)) {
+        m_best_header = best_header;
+    }
 
     if (ppindex)
         *ppindex = pindex;
@@ -4429,15 +4789,85 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
     return true;
 }
 
+bool ChainstateManager::PreVerifyPow(Span<const CBlockHeader> headers, BlockValidationState& state)
+{
+    AssertLockNotHeld(cs_main);
+    if (!GetConsensus().fPowRandomX) return true;
+
+    std::vector<const CBlockHeader*> to_verify;
+    {
+        LOCK(cs_main);
+        // Headers connecting to a previous header of the same message are not in the block index yet. They are
+        // chained with temporary entries, so that their contextual checks can be evaluated.
+        std::deque<uint256> hashes;
+        std::deque<CBlockIndex> chained;
+        CBlockIndex* pindexPrev{nullptr};
+        for (const CBlockHeader& header : headers) {
+            if (!pindexPrev || header.hashPrevBlock != pindexPrev->GetBlockHash()) {
+                pindexPrev = m_blockman.LookupBlockIndex(header.hashPrevBlock);
+                if (!pindexPrev || (pindexPrev->nStatus & BLOCK_FAILED_MASK)) break;
+            }
+            const uint256& hash{hashes.emplace_back(header.GetHash())};
+            if (CBlockIndex* pindex{m_blockman.LookupBlockIndex(hash)}) {
+                if (pindex->nStatus & BLOCK_FAILED_MASK) break;
+                pindexPrev = pindex;
+                continue;
+            }
+            // Stop at the first header which AcceptBlockHeader() rejects before hashing it
+            BlockValidationState dummy_state;
+            if (!CheckProofOfWorkRandomX(header, GetConsensus(), POW_VERIFY_COMMITMENT_ONLY) ||
+                !ContextualCheckBlockHeader(header, dummy_state, m_blockman, *this, pindexPrev)) {
+                break;
+            }
+            if (!IsPowCheckpointed(pindexPrev->nHeight + 1)) to_verify.push_back(&header);
+            CBlockIndex& index{chained.emplace_back(header)};
+            index.phashBlock = &hash;
+            index.pprev = pindexPrev;
+            index.nHeight = pindexPrev->nHeight + 1;
+            index.BuildSkip();
+            pindexPrev = &index;
+        }
+    }
+
+    // Headers arrive in batches of up to 2000 during headers sync. Spread their verification over
+    // the PoW verification queue, while this thread verifies the headers not picked up by a worker yet.
+    const bool use_queue{m_pow_verify_queue && to_verify.size() > 1};
+    if (use_queue) {
+        for (const CBlockHeader* header : to_verify) {
+            if (!m_pow_verify_queue->Add(*header)) break;
+        }
+    }
+    for (size_t i{0}; i < to_verify.size(); ++i) {
+        const CBlockHeader& header{*to_verify[i]};
+        std::optional<bool> valid;
+        if (use_queue) valid = m_pow_verify_queue->Take(header.GetHash());
+        // A header which could not be queued, or whose result was taken by a concurrent caller, is verified here
+        if (!valid) valid = CheckProofOfWorkRandomX(header, GetConsensus(), POW_VERIFY_FULL);
+        if (!*valid) {
+            if (use_queue) {
+                for (size_t j{i + 1}; j < to_verify.size(); ++j) {
+                    m_pow_verify_queue->Discard(to_verify[j]->GetHash());
+                }
+            }
+            return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
+        }
+    }
+    return true;
+}
+
 // Exposed wrapper for AcceptBlockHeader
-bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex)
+bool ChainstateManager::ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex, bool defer_pow)
 {
     AssertLockNotHeld(cs_main);
+    if (!defer_pow && !PreVerifyPow(headers, state)) {
+        LogPrint(BCLog::VALIDATION, "%s: %s\n", __func__, state.ToString());
+        return false;
+    }
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            bool accepted{AcceptBlockHeader(header, state, &pindex, min_pow_checked)};
+            bool accepted{AcceptBlockHeader(header, state, &pindex, min_pow_checked, defer_pow)};
             CheckBlockIndex();
 
             if (!accepted) {
@@ -4538,7 +4968,11 @@ bool ChainstateManager::AcceptBlock(const std::shared_ptr<const CBlock>& pblock,
 
     const CChainParams& params{GetParams()};
 
-    if (!CheckBlock(block, state, params.GetConsensus()) ||
+    // The header's proof of work was verified when it was accepted, or deferred until the block is connected if
+    // it is below the last checkpoint.
+    const bool defer_pow{(pindex->nStatus & BLOCK_POW_VERIFIED) || IsPowCheckpointed(pindex->nHeight)};
+
+    if (!CheckBlock(block, state, params.GetConsensus(), /*fCheckPOW=*/!defer_pow) ||
         !ContextualCheckBlock(block, state, *this, pindex->pprev)) {
         if (state.IsInvalid() && state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -4547,6 +4981,14 @@ bool ChainstateManager::AcceptBlock(const std::shared_ptr<const CBlock>& pblock,
         LogError("%s: %s\n", __func__, state.ToString());
         return false;
     }
+    if (!defer_pow && g_isRandomX) {
+        // The full check of a header accepted with a deferred check was done above
+        pindex->nStatus |= BLOCK_POW_VERIFIED;
+        m_blockman.m_dirty_blockindex.insert(pindex);
+        if (m_best_header == nullptr || m_best_header->nChainWork < pindex->nChainWork) {
+            m_best_header = pindex;
+        }
+    }
 
     // Header is valid/has work, merkle tree and segwit merkle tree are good...RELAY NOW
     // (but if it does not build on our best tip, let the SendMessages loop relay it)
@@ -4596,6 +5038,10 @@ bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& blo
         if (new_block) *new_block = false;
         BlockValidationState state;
 
+        // Verify the RandomX hash of a new header before taking cs_main, see PreVerifyPow()
+        const CBlockHeader header{block->GetBlockHeader()};
+        bool ret = PreVerifyPow({&header, 1}, state);
+
         // CheckBlock() does not support multi-threaded block validation because CBlock::fChecked can cause data race.
         // Therefore, the following critical section must include the CheckBlock() call as well.
         LOCK(cs_main);
@@ -4605,7 +5051,12 @@ bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& blo
         // malleability that cause CheckBlock() to fail; see e.g. CVE-2012-2459 and
         // https://lists.linuxfoundation.org/pipermail/bitcoin-dev/2019-February/016697.html.  Because CheckBlock() is
         // not very expensive, the anti-DoS benefits of caching failure (of a definitely-invalid block) are not substantial.
-        bool ret = CheckBlock(*block, state, GetConsensus());
+        //
+        // The full proof of work check of a block whose header was already accepted is left to AcceptBlock(), which
+        // skips it if it was verified then, or defers it to when the block is connected below the last checkpoint.
+        // Otherwise the header was accepted with a deferred check, and AcceptBlock() marks the block invalid if it fails.
+        const bool defer_pow{m_blockman.LookupBlockIndex(block->GetHash()) != nullptr};
+        ret = ret && CheckBlock(*block, state, GetConsensus(), /*fCheckPOW=*/!defer_pow);
         if (ret) {
             // Store to disk
             ret = AcceptBlock(block, state, &pindex, force_processing, nullptr, new_block, min_pow_checked);
@@ -4793,7 +5244,7 @@ VerifyDBResult CVerifyDB::VerifyDB(
             return VerifyDBResult::CORRUPTED_BLOCK_DB;
         }
         // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, consensus_params)) {
+        if (nCheckLevel >= 1 && !CheckBlock(block, state, consensus_params, /*fCheckPOW=*/!(pindex->nStatus & BLOCK_POW_VERIFIED))) {
             LogPrintf("Verification error: found bad block at %d, hash=%s (%s)\n",
                       pindex->nHeight, pindex->GetBlockHash().ToString(), state.ToString());
             return VerifyDBResult::CORRUPTED_BLOCK_DB;
@@ -5031,7 +5482,7 @@ bool ChainstateManager::LoadBlockIndex()
             if (pindex->nStatus & BLOCK_FAILED_MASK && (!m_best_invalid || pindex->nChainWork > m_best_invalid->nChainWork)) {
                 m_best_invalid = pindex;
             }
-            if (pindex->IsValid(BLOCK_VALID_TREE) && (m_best_header == nullptr || CBlockIndexWorkComparator()(m_best_header, pindex)))
+            if (pindex->IsValid(BLOCK_VALID_TREE) && IsPowVerified(*pindex) && (m_best_header == nullptr || CBlockIndexWorkComparator()(m_best_header, pindex)))
                 m_best_header = pindex;
         }
     }
@@ -6298,11 +6749,15 @@ static ChainstateManager::Options&& Flatten(ChainstateManager::Options&& opts)
 
 ChainstateManager::ChainstateManager(const util::SignalInterrupt& interrupt, Options options, node::BlockManager::Options blockman_options)
     : m_script_check_queue{/*batch_size=*/128, options.worker_threads_num},
+      m_coins_prefetch_queue{/*batch_size=*/16, options.coins_prefetch_threads_num, "coinsfetch"},
       m_interrupt{interrupt},
       m_options{Flatten(std::move(options))},
       m_blockman{interrupt, std::move(blockman_options)},
       m_validation_cache{m_options.script_execution_cache_bytes, m_options.signature_cache_bytes}
 {
+    if (m_options.chainparams.GetConsensus().fPowRandomX && m_options.randomx_verify_threads_num > 0) {
+        m_pow_verify_queue = std::make_unique<PowVerifyQueue>(m_options.chainparams.GetConsensus(), m_options.randomx_verify_threads_num);
+    }
 }
 
 ChainstateManager::~ChainstateManager()
@@ -21,6 +21,7 @@
 #include <policy/feerate.h>
 #include <policy/packages.h>
 #include <policy/policy.h>
+#include <powverifyqueue.h>
 #include <script/script_error.h>
 #include <script/sigcache.h>
 #include <sync.h>
@@ -363,6 +364,29 @@ static_assert(std::is_nothrow_move_assignable_v<CScriptCheck>);
 static_assert(std::is_nothrow_move_constructible_v<CScriptCheck>);
 static_assert(std::is_nothrow_destructible_v<CScriptCheck>);
 
+/**
+ * Closure reading one coin from the coins database ahead of connecting a block.
+ * Note that this stores references to the outpoint and to the slot receiving the coin
+ */
+class CCoinPrefetch
+{
+private:
+    const CCoinsView* m_view;
+    const COutPoint* m_outpoint;
+    std::optional<Coin>* m_coin;
+
+public:
+    CCoinPrefetch(const CCoinsView& view, const COutPoint& outpoint, std::optional<Coin>& coin) :
+        m_view(&view), m_outpoint(&outpoint), m_coin(&coin) { }
+
+    bool operator()()
+    {
+        Coin coin;
+        if (m_view->GetCoin(*m_outpoint, coin)) *m_coin = std::move(coin);
+        return true;
+    }
+};
+
 /**
  * Convenience class for initializing and passing the script execution cache
  * and signature cache.
@@ -474,6 +498,11 @@ public:
     //! can fit per the dbcache setting.
     std::unique_ptr<CCoinsViewCache> m_cacheview GUARDED_BY(cs_main);
 
+    //! A previous m_cacheview whose modified coins are being written to m_dbview by a background
+    //! flush. While it is set, m_cacheview reads the coins it does not have through m_flushingview.
+    std::unique_ptr<CCoinsViewCache> m_flushingcache GUARDED_BY(cs_main);
+    std::unique_ptr<CCoinsViewFrozenCache> m_flushingview GUARDED_BY(cs_main);
+
     //! This constructor initializes CCoinsViewDB and CCoinsViewErrorCatcher instances, but it
     //! *does not* create a CCoinsViewCache instance by default. This is done separately because the
     //! presence of the cache has implications on whether or not we're allowed to flush the cache's
@@ -482,8 +511,52 @@ public:
     //! All arguments forwarded onto CCoinsViewDB.
     CoinsViews(DBParams db_params, CoinsViewOptions options);
 
+    //! Waits for a background flush to finish writing before destroying the views.
+    ~CoinsViews();
+
     //! Initialize the CCoinsViewCache member.
     void InitCache() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    //! The view m_cacheview reads the coins it does not have from.
+    CCoinsView& CacheBase() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    /**
+     * Start writing the modified coins of m_cacheview to m_dbview from a background thread.
+     * m_cacheview is replaced by an empty cache on top of the coins being written, so that
+     * they can keep being read and spent while the write is in progress.
+     *
+     * @param[in] empty_cache  Whether to drop the written coins from memory once the
+     *                         flush is finished, instead of keeping them cached.
+     */
+    void StartBackgroundFlush(bool empty_cache) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    //! Whether a background flush was started and not finished yet.
+    bool IsFlushing() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main) { return m_flushingcache != nullptr; }
+
+    //! Memory used by the coins of the background flush, if any.
+    size_t FlushingCacheUsage() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main) { return m_flushingcache ? m_flushingcache->DynamicMemoryUsage() : 0; }
+
+    //! Whether the coins of the background flush have been written, so that finishing it does not block.
+    bool IsFlushWritten() const { return m_flush_written; }
+
+    //! Wait for the coins of the background flush, if any, to be written to m_dbview.
+    void WaitForFlushWrite();
+
+    /**
+     * Wait for the coins of the background flush to be written and put them back under
+     * m_cacheview, or drop them if the cache was to be emptied.
+     *
+     * @returns the best block of the coins written, or the error which occurred while
+     *          writing them. On error, the coins are kept in m_cacheview.
+     */
+    util::Result<uint256> FinishBackgroundFlush() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+private:
+    std::thread m_flush_thread;
+    std::atomic<bool> m_flush_written{false};
+    //! Set by m_flush_thread when the write fails, read after joining it.
+    std::optional<bilingual_str> m_flush_error;
+    bool m_flush_empties_cache{false};
 };
 
 enum class CoinsCacheSizeState
@@ -495,6 +568,23 @@ enum class CoinsCacheSizeState
     OK = 0
 };
 
+/**
+ * Script checks of blocks connected during initial block download which have
+ * not been waited for yet, so that they run while the following blocks are
+ * connected. The checks point into the blocks and their precomputed
+ * transaction data, which are kept here until the checks are done.
+ */
+struct DeferredScriptChecks {
+    //! Blocks whose script checks were deferred, in the order they were connected
+    std::vector<CBlockIndex*> indexes;
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    std::vector<std::vector<PrecomputedTransactionData>> txsdata;
+    //! Declared last, so that it waits for the checks before the data they use is destroyed
+    CCheckQueueControl<CScriptCheck> control;
+
+    explicit DeferredScriptChecks(CCheckQueue<CScriptCheck>& queue) : control{&queue} {}
+};
+
 /**
  * Chainstate stores and provides an API to update our local knowledge of the
  * current best chain.
@@ -624,10 +714,12 @@ public:
     }
 
     //! @returns A reference to the on-disk UTXO set database.
+    //! Waits for a background flush of the coins cache to be written, so that the database is consistent.
     CCoinsViewDB& CoinsDB() EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
     {
         AssertLockHeld(::cs_main);
-        return Assert(m_coins_views)->m_dbview;
+        Assert(m_coins_views)->WaitForFlushWrite();
+        return m_coins_views->m_dbview;
     }
 
     //! @returns A pointer to the mempool.
@@ -711,14 +803,21 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(!m_chainstate_mutex)
         LOCKS_EXCLUDED(::cs_main);
 
+    /**
+     * Read the coins spent by a block which are missing from the coins cache from
+     * the coins database, on the coins prefetch threads, and add them to the cache.
+     * Does nothing without prefetch threads.
+     */
+    void PrefetchCoins(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
-                      CCoinsViewCache& view, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+                      CCoinsViewCache& view, bool fJustCheck = false, DeferredScriptChecks* deferred_checks = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Apply the effects of a block disconnection on the UTXO set.
-    bool DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    bool DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool, bool notify = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
 
     // Manual block validity manipulation:
     /** Mark a block as precious and reorganize.
@@ -810,6 +909,32 @@ private:
     SteadyClock::time_point m_last_write{};
     SteadyClock::time_point m_last_flush{};
 
+    //! Script checks deferred by ConnectTip() within the current ActivateBestChainStep() call
+    std::unique_ptr<DeferredScriptChecks> m_deferred_script_checks GUARDED_BY(::cs_main);
+    //! Height up to which script checks are not deferred, after deferred checks failed
+    int m_immediate_script_checks_height GUARDED_BY(::cs_main){-1};
+
+    /** Whether the script checks of a block connected by ConnectTip() are deferred. */
+    bool DeferScriptChecks(const CBlockIndex& block) const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    /** Whether ActivateBestChainStep() can connect another block before waiting for the deferred script checks. */
+    bool ContinueScriptCheckPipeline() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    /**
+     * Wait for the deferred script checks. If any of them failed, the blocks
+     * whose checks were deferred are disconnected, to be connected again with
+     * their script checks waited for.
+     *
+     * @returns false if a block could not be disconnected
+     */
+    bool JoinDeferredScriptChecks(BlockValidationState& state, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool, bool& blocks_disconnected) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+
+    /**
+     * Finish the background flush of the coins cache started by FlushStateToDisk(),
+     * waiting for its coins to be written if needed.
+     *
+     * @returns false if the coins could not be written
+     */
+    bool FinishBackgroundCoinsFlush(BlockValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     /**
      * In case of an invalid snapshot, rename the coins leveldb directory so
      * that it can be examined for issue diagnosis.
@@ -929,12 +1054,15 @@ private:
      * Caller must set min_pow_checked=true in order to add a new header to the
      * block index (permanent memory storage), indicating that the header is
      * known to be part of a sufficiently high-work chain (anti-dos check).
+     * If defer_pow is set, only the RandomX commitment of a new header is
+     * checked, and the full check is left to AcceptBlock().
      */
     bool AcceptBlockHeader(
         const CBlockHeader& block,
         BlockValidationState& state,
         CBlockIndex** ppindex,
-        bool min_pow_checked) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+        bool min_pow_checked,
+        bool defer_pow = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     friend Chainstate;
 
     /** Most recent headers presync progress update, for rate-limiting. */
@@ -954,6 +1082,13 @@ private:
     //! A queue for script verifications that have to be performed by worker threads.
     CCheckQueue<CScriptCheck> m_script_check_queue;
 
+    //! A queue for reads of the coins spent by a block, performed by worker threads before it is connected.
+    CCheckQueue<CCoinPrefetch> m_coins_prefetch_queue;
+
+    //! A queue for RandomX verifications of batches of new headers, see PreVerifyPow().
+    //! Only set on RandomX chains with verification threads.
+    std::unique_ptr<PowVerifyQueue> m_pow_verify_queue;
+
     //! Timers and counters used for benchmarking validation in both background
     //! and active chainstates.
     SteadyClock::duration GUARDED_BY(::cs_main) time_check{};
@@ -985,6 +1120,34 @@ public:
     const uint256& AssumedValidBlock() const { return *Assert(m_options.assumed_valid_block); }
     kernel::Notifications& GetNotifications() const { return m_options.notifications; };
 
+    /**
+     * Return whether full RandomX verification of a header at the given height
+     * is deferred, because the height is at or below the last checkpoint.
+     * Deferred headers only have their RandomX commitment checked when they are
+     * accepted, and are fully verified when connected unless by then they are
+     * known to be ancestors of a checkpoint (see IsPowAssumedValid()).
+     */
+    bool IsPowCheckpointed(int height) const;
+
+    /**
+     * Return whether a block's RandomX hash is trusted without recomputing it,
+     * so that only its RandomX commitment needs to be checked. This is the case
+     * for ancestors of a checkpoint in the block index, and for ancestors of the
+     * assumed valid block when it is on the best header chain with at least the
+     * minimum chain work.
+     */
+    bool IsPowAssumedValid(const CBlockIndex& index) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    /**
+     * Return whether a header may become the best header. On RandomX chains,
+     * a header accepted with a deferred check of its RandomX hash (see
+     * ProcessNewBlockHeaders()) may not until the hash is verified, when its
+     * block is accepted. Only its commitment was checked, which can be ground
+     * cheaply. Headers at or below the last checkpoint are bounded by the
+     * checkpoint lock-in instead.
+     */
+    bool IsPowVerified(const CBlockIndex& index) const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     /**
      * Make various assertions about the state of the block index.
      *
@@ -1211,6 +1374,22 @@ public:
      */
     bool ProcessNewBlock(const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked, bool* new_block) LOCKS_EXCLUDED(cs_main);
 
+    /**
+     * Fully verify the RandomX hashes of new headers without holding cs_main, so
+     * that AcceptBlockHeader() finds them in the cache of verified hashes instead
+     * of computing them while holding it. Only headers which AcceptBlockHeader()
+     * would hash are verified: those above the last checkpoint, connecting to a
+     * valid block, and passing the contextual checks for it (difficulty,
+     * checkpoints and timestamp). Headers connecting to a previous header of the
+     * same batch are checked against it. This prevents creating RandomX VMs for
+     * arbitrary epochs. AcceptBlockHeader() does not hash the other headers, or
+     * rejects them before hashing them. The headers of a batch are verified in
+     * parallel by the PoW verification queue, if there is one.
+     *
+     * @returns false, with state set to invalid, if a RandomX hash is wrong
+     */
+    bool PreVerifyPow(Span<const CBlockHeader> headers, BlockValidationState& state) LOCKS_EXCLUDED(cs_main);
+
     /**
      * Process incoming block headers.
      *
@@ -1221,8 +1400,10 @@ public:
      * @param[in]  min_pow_checked  True if proof-of-work anti-DoS checks have been done by caller for headers chain
      * @param[out] state This may be set to an Error state if any error occurred processing them
      * @param[out] ppindex If set, the pointer will be set to point to the last new block index object for the given headers
+     * @param[in]  defer_pow  Only check the RandomX commitment of new headers, leaving the full check to when the block
+     *                        itself is accepted. Used to relay compact blocks without waiting for the RandomX hash.
      */
-    bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex = nullptr) LOCKS_EXCLUDED(cs_main);
+    bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, bool min_pow_checked, BlockValidationState& state, const CBlockIndex** ppindex = nullptr, bool defer_pow = false) LOCKS_EXCLUDED(cs_main);
 
     /**
      * Sufficiently validate a block for disk storage (and store on disk).
@@ -1321,6 +1502,8 @@ public:
     std::optional<int> GetSnapshotBaseHeight() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     CCheckQueue<CScriptCheck>& GetCheckQueue() { return m_script_check_queue; }
+    CCheckQueue<CCoinPrefetch>& GetCoinsPrefetchQueue() { return m_coins_prefetch_queue; }
+    PowVerifyQueue* GetPowVerifyQueue() { return m_pow_verify_queue.get(); }
 
     ~ChainstateManager();
 };
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# Copyright (c) 2025 The Satoshi Cash-X developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the RandomX fields of getblocktemplate, and longpolling on epoch boundaries."""
+
+import threading
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    get_rpc_proxy,
+)
+
+
+class LongpollThread(threading.Thread):
+    def __init__(self, node, longpollid):
+        threading.Thread.__init__(self)
+        self.longpollid = longpollid
+        # create a new connection to the node, we can't use the same
+        # connection from two threads
+        self.node = get_rpc_proxy(node.url, 1, timeout=600, coveragedir=node.coverage_dir)
+
+    def run(self):
+        self.template = self.node.getblocktemplate({'longpollid': self.longpollid, 'rules': ['segwit']})
+
+
+class GetBlockTemplateRandomXTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.chain = "scashxregtest"
+        self.supports_cli = False
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.generate(node, 1)
+
+        self.log.info("Test the RandomX fields of the template")
+        template = node.getblocktemplate({'rules': ['segwit']})
+        duration = template['rx_epoch_duration']
+        epoch = template['curtime'] // duration
+        assert_equal(template['rx_epoch'], epoch)
+        epoch_end = (epoch + 1) * duration
+        assert_equal(template['rx_epoch_end'], epoch_end)
+        assert_equal(len(template['rx_seed_hash']), 64)
+        assert template['rx_next_seed_hash'] != template['rx_seed_hash']
+
+        self.log.info("Test that longpoll returns a template with the next key when the next epoch starts")
+        node.setmocktime(epoch_end - 5)
+        thr = LongpollThread(node, template['longpollid'])
+        with node.assert_debug_log(["ThreadRPCServer method=getblocktemplate"], timeout=3):
+            thr.start()
+        thr.join(1)
+        assert thr.is_alive()
+        node.setmocktime(epoch_end)
+        thr.join(10)
+        assert not thr.is_alive()
+        assert_equal(thr.template['rx_epoch'], epoch + 1)
+        assert_equal(thr.template['rx_seed_hash'], template['rx_next_seed_hash'])
+
+        self.log.info("Test that longpoll still returns when the tip changes")
+        template = node.getblocktemplate({'rules': ['segwit']})
+        thr = LongpollThread(node, template['longpollid'])
+        with node.assert_debug_log(["ThreadRPCServer method=getblocktemplate"], timeout=3):
+            thr.start()
+        self.generate(node, 1)
+        thr.join(5)
+        assert not thr.is_alive()
+        assert_equal(thr.template['previousblockhash'], node.getbestblockhash())
+
+
+if __name__ == '__main__':
+    GetBlockTemplateRandomXTest(__file__).main()
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+# Copyright (c) 2025 The Satoshi Cash-X developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the Stratum mining job server enabled by -stratum.
+
+With --randomx, the test runs on scashxregtest, where jobs carry the RandomX seed hash and shares carry the RandomX
+hash, which the node checks on its worker threads.
+"""
+
+import hashlib
+import json
+import socket
+import struct
+import subprocess
+
+from test_framework.messages import hash256
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    PORT_RANGE,
+    assert_equal,
+    p2p_port,
+)
+
+
+class StratumClient:
+    def __init__(self, port):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=60)
+        self.file = self.sock.makefile("r", encoding="utf8")
+        self.next_id = 1
+        self.notifications = []
+
+    def send_line(self, line):
+        self.sock.sendall((line + "\n").encode())
+
+    def recv(self):
+        return json.loads(self.file.readline())
+
+    def request(self, method, params=None):
+        req_id = self.next_id
+        self.next_id += 1
+        self.send_line(json.dumps({"id": req_id, "method": method, "params": params or {}}))
+        while True:
+            msg = self.recv()
+            if msg.get("id") == req_id:
+                return msg
+            self.notifications.append(msg)
+
+    def wait_for_job(self):
+        msg = self.notifications.pop(0) if self.notifications else self.recv()
+        assert_equal(msg["method"], "job")
+        return msg["params"]
+
+    def close(self):
+        self.sock.close()
+
+
+def solve(job, solved=True):
+    """Return the header and nonce of the first nonce whose block hash meets (or misses) the job target."""
+    header = bytearray.fromhex(job["blob"])
+    target = int(job["target"], 16)
+    for nonce in range(2**32):
+        header[76:80] = struct.pack("<I", nonce)
+        if (int.from_bytes(hash256(header), "little") <= target) == solved:
+            return bytes(header), header[76:80].hex()
+
+
+def randomx_commitment(header, rx_hash):
+    """Return the RandomX commitment of a header, whose hashRandomX field is null, to a RandomX hash."""
+    return int.from_bytes(hashlib.blake2b(header + rx_hash, digest_size=32).digest(), "little")
+
+
+class StratumTest(BitcoinTestFramework):
+    def add_options(self, parser):
+        parser.add_argument("--randomx", action="store_true", help="Test on a RandomX chain")
+
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        if self.options.randomx:
+            self.chain = "scashxregtest"
+
+    def skip_test_if_missing_module(self):
+        if self.options.randomx:
+            # Used to compute RandomX hashes
+            self.skip_if_no_bitcoin_util()
+
+    def assert_error(self, reply, message):
+        assert_equal(reply["result"], None)
+        assert_equal(reply["error"]["message"], message)
+
+    def run_test(self):
+        node = self.nodes[0]
+        address = node.get_deterministic_priv_key().address
+        port = p2p_port(0) + 3 * PORT_RANGE
+
+        self.log.info("Test -stratum argument checks")
+        node.stop_node()
+        node.assert_start_raises_init_error(["-stratum"], "Error: -stratum requires a valid -stratumaddress.")
+        node.assert_start_raises_init_error(["-stratum", f"-stratumaddress={address}", "-stratumsharediff=-1"], "Error: stratumsharediff must be 0 or a positive integer.")
+        self.start_node(0, ["-stratum", f"-stratumaddress={address}", f"-stratumport={port}"])
+        self.generate(node, 1)
+
+        client = StratumClient(port)
+        self.log.info("Test requests before login")
+        assert_equal(client.request("keepalived")["result"], {"status": "KEEPALIVED"})
+        self.assert_error(client.request("getjob"), "Unauthenticated")
+        self.assert_error(client.request("submit"), "Unauthenticated")
+        client.send_line("not json")
+        self.assert_error(client.recv(), "Parse error")
+
+        self.log.info("Test login")
+        reply = client.request("login", {"login": "x", "pass": "x", "agent": "test"})
+        assert_equal(reply["error"], None)
+        assert_equal(reply["result"]["status"], "OK")
+        job = reply["result"]["job"]
+        # The header includes the null RandomX hash on RandomX chains
+        assert_equal(len(job["blob"]), 224 if self.options.randomx else 160)
+        assert_equal("seed_hash" in job, self.options.randomx)
+        assert_equal(bytes.fromhex(job["blob"])[4:36][::-1].hex(), node.getbestblockhash())
+        assert_equal(client.request("getjob")["result"], job)
+        self.assert_error(client.request("unknown"), "Method not found")
+
+        self.log.info("Test that each connection mines its own extranonce")
+        client2 = StratumClient(port)
+        job2 = client2.request("login")["result"]["job"]
+        assert_equal(job2["job_id"], job["job_id"])
+        assert job2["blob"][72:136] != job["blob"][72:136]
+
+        if self.options.randomx:
+            self.test_randomx_shares(node, client, job)
+        else:
+            self.test_shares(node, address, client, client2, job)
+
+        client.close()
+        client2.close()
+
+    def test_randomx_shares(self, node, client, job):
+        self.log.info("Test the RandomX seed hash of the job")
+        header = bytes.fromhex(job["blob"])
+        template = node.getblocktemplate({"rules": ["segwit"]})
+        n_time = struct.unpack("<I", header[68:72])[0]
+        if n_time // template["rx_epoch_duration"] == template["rx_epoch"]:
+            assert_equal(job["seed_hash"], template["rx_seed_hash"])
+
+        self.log.info("Test that a share with a wrong RandomX hash is rejected by a worker thread")
+        # A nonce which the grinding below does not reach, as a share can only be submitted once
+        bad_header = header[:76] + struct.pack("<I", 0xffffffff) + header[80:]
+        nonce = bad_header[76:80].hex()
+        target = int(job["target"], 16)
+        rx_hash = bytes(32)
+        while randomx_commitment(bad_header, rx_hash) > target:
+            rx_hash = hashlib.sha256(rx_hash).digest()
+        with node.assert_debug_log(["submitted an invalid RandomX hash"]):
+            self.assert_error(client.request("submit", {"job_id": job["job_id"], "nonce": nonce, "result": rx_hash.hex()}), "Invalid result")
+        self.assert_error(client.request("submit", {"job_id": job["job_id"], "nonce": nonce, "result": "00"}), "Invalid result")
+
+        self.log.info("Test that a share with the RandomX hash computed by bitcoin-util is submitted as a block")
+        tip = node.getbestblockhash()
+        solved = bytes.fromhex(subprocess.run([self.options.bitcoinutil, f"-chain={self.chain}", "grind", header.hex()],
+                                              stdout=subprocess.PIPE, check=True, text=True).stdout.strip())
+        reply = client.request("submit", {"job_id": job["job_id"], "nonce": solved[76:80].hex(), "result": solved[80:112].hex()})
+        assert_equal(reply["error"], None)
+        assert_equal(reply["result"], {"status": "OK"})
+        block = node.getblockheader(node.getbestblockhash())
+        assert_equal(block["previousblockhash"], tip)
+        assert_equal(block["rx_hash"], solved[80:112][::-1].hex())
+        new_job = client.wait_for_job()
+        assert_equal(bytes.fromhex(new_job["blob"])[4:36][::-1].hex(), block["hash"])
+
+    def test_shares(self, node, address, client, client2, job):
+        self.log.info("Test invalid shares")
+        self.assert_error(client.request("submit", {"job_id": "0", "nonce": "00000000"}), "Stale job")
+        self.assert_error(client.request("submit", {"job_id": job["job_id"], "nonce": "zz"}), "Invalid nonce")
+        self.assert_error(client.request("submit", {"job_id": job["job_id"], "nonce": "0000"}), "Invalid nonce")
+        _, nonce = solve(job, solved=False)
+        self.assert_error(client.request("submit", {"job_id": job["job_id"], "nonce": nonce}), "Low difficulty share")
+
+        self.log.info("Test that a solution is submitted as a block, and new jobs are pushed")
+        header, nonce = solve(job)
+        # The duplicate is rejected before the first share has been processed
+        submit = {"job_id": job["job_id"], "nonce": nonce, "result": hash256(header).hex()}
+        client.send_line(json.dumps({"id": "a", "method": "submit", "params": submit}) + "\n" + json.dumps({"id": "b", "method": "submit", "params": submit}))
+        replies = {}
+        while len(replies) < 2:
+            msg = client.recv()
+            if "id" in msg:
+                replies[msg["id"]] = msg
+            else:
+                client.notifications.append(msg)
+        self.assert_error(replies["b"], "Duplicate share")
+        reply = replies["a"]
+        assert_equal(reply["error"], None)
+        assert_equal(reply["result"], {"status": "OK"})
+        block_hash = hash256(header)[::-1].hex()
+        assert_equal(node.getbestblockhash(), block_hash)
+        coinbase = node.getblock(block_hash, 2)["tx"][0]
+        assert_equal(coinbase["vout"][0]["scriptPubKey"]["address"], address)
+        for c in [client, client2]:
+            new_job = c.wait_for_job()
+            assert_equal(bytes.fromhex(new_job["blob"])[4:36][::-1].hex(), block_hash)
+        self.assert_error(client.request("submit", {"job_id": job["job_id"], "nonce": nonce}), "Stale job")
+
+        self.log.info("Test that a new job is pushed when the tip changes")
+        tip = self.generate(node, 1)[0]
+        new_job = client2.wait_for_job()
+        assert_equal(bytes.fromhex(new_job["blob"])[4:36][::-1].hex(), tip)
+
+        self.log.info("Test that the shares of a connection are rate limited")
+        requests = [json.dumps({"id": i, "method": "submit", "params": {"job_id": "0", "nonce": "00000000"}}) for i in range(30)]
+        client2.send_line("\n".join(requests))
+        replies = [client2.recv() for _ in requests]
+        for reply in replies[:20]:
+            self.assert_error(reply, "Stale job")
+        self.assert_error(replies[-1], "Too many shares")
+
+
+if __name__ == '__main__':
+    StratumTest(__file__).main()
@@ -312,6 +312,9 @@ BASE_SCRIPTS = [
     'wallet_upgradewallet.py --legacy-wallet',
     'wallet_crosschain.py',
     'mining_basic.py',
+    'mining_stratum.py',
+    'mining_stratum.py --randomx',
+    'mining_getblocktemplate_randomx.py',
     'feature_signet.py',
     'p2p_mutated_blocks.py',
     'wallet_implicitsegwit.py --legacy-wallet',
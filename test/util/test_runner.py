@@ -16,6 +16,7 @@ import json
 import logging
 import os
 import pprint
+import re
 import subprocess
 import sys
 
@@ -148,6 +149,12 @@ def bctest(testDir, testObj, buildenv):
 
         assert not data_mismatch and not formatting_mismatch
 
+    # Match the output against a regular expression, for output which is not deterministic
+    if "output_regex" in testObj:
+        if not re.fullmatch(testObj["output_regex"], outs[0]):
+            logging.error("Output mismatch:\n" + "Expected: " + testObj["output_regex"] + "\nReceived: " + outs[0].rstrip())
+            raise Exception
+
     # Compare the return code to the expected return code
     wantRC = 0
     if "return_code" in testObj: